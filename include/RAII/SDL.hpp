@@ -8,8 +8,8 @@
 
 class SDL {
     public:
-        SDL() {
-            if (!SDL_Init(SDL_INIT_VIDEO)) {
+        explicit SDL(SDL_InitFlags flags = SDL_INIT_VIDEO) {
+            if (!SDL_Init(flags)) {
                 std::cerr << "[ERROR] World::World -> SDL_Init: " << SDL_GetError() << std::endl;
                 throw std::runtime_error("Failed to initialiaze SDL");
             }
@@ -74,6 +74,14 @@ class SDLRenderer {
             }
         }
 
+        /* Software rendering into surface, for offscreen use */
+        explicit SDLRenderer(SDL_Surface* surface) {
+            if ((m_renderer = SDL_CreateSoftwareRenderer(surface)) == nullptr) {
+                std::cerr << "[ERROR] SDLRenderer::SDLRenderer -> SDL_CreateSoftwareRenderer: " << SDL_GetError() << std::endl;
+                throw std::runtime_error("Failed to initialiaze SDL");
+            }
+        }
+
         ~SDLRenderer() {
             if (m_renderer != nullptr) {
                 SDL_DestroyRenderer(m_renderer);
@@ -104,4 +112,94 @@ class SDLRenderer {
         SDL_Renderer* m_renderer;
 };
 
+/* Takes ownership of a surface SDL already created */
+class SDLSurface {
+    public:
+        explicit SDLSurface(SDL_Surface* surface) : m_surface (surface) {}
+
+        ~SDLSurface() {
+            if (m_surface != nullptr) {
+                SDL_DestroySurface(m_surface);
+            }
+        }
+
+        SDLSurface(const SDLSurface&) = delete;
+        SDLSurface& operator=(const SDLSurface&) = delete;
+
+        SDLSurface(SDLSurface&& other) noexcept {
+            m_surface = other.m_surface;
+            other.m_surface = nullptr;
+        }
+
+        SDLSurface& operator=(SDLSurface&& other) noexcept {
+            if (this != &other) {
+                if (m_surface != nullptr) SDL_DestroySurface(m_surface);
+                m_surface = other.m_surface;
+                other.m_surface = nullptr;
+            }
+            return *this;
+        }
+
+        SDL_Surface* get() {
+            return m_surface;
+        }
+
+        /* Ownership goes to the caller */
+        SDL_Surface* release() {
+            SDL_Surface* surface = m_surface;
+            m_surface = nullptr;
+            return surface;
+        }
+
+    private:
+        SDL_Surface* m_surface;
+};
+
+class SDLTexture {
+    public:
+        explicit SDLTexture(SDL_Renderer* renderer, SDL_Surface* surface) {
+            if ((m_texture = SDL_CreateTextureFromSurface(renderer, surface)) == nullptr) {
+                std::cerr << "[ERROR] SDLTexture::SDLTexture -> SDL_CreateTextureFromSurface: " << SDL_GetError() << std::endl;
+                throw std::runtime_error("Failed to create texture");
+            }
+        }
+
+        explicit SDLTexture(SDL_Renderer* renderer, SDL_PixelFormat format, SDL_TextureAccess access, int w, int h) {
+            if ((m_texture = SDL_CreateTexture(renderer, format, access, w, h)) == nullptr) {
+                std::cerr << "[ERROR] SDLTexture::SDLTexture -> SDL_CreateTexture: " << SDL_GetError() << std::endl;
+                throw std::runtime_error("Failed to create texture");
+            }
+        }
+
+        ~SDLTexture() {
+            if (m_texture != nullptr) {
+                SDL_DestroyTexture(m_texture);
+            }
+        }
+
+        SDLTexture(const SDLTexture&) = delete;
+        SDLTexture& operator=(const SDLTexture&) = delete;
+
+        SDLTexture(SDLTexture&& other) noexcept {
+            m_texture = other.m_texture;
+            other.m_texture = nullptr;
+        }
+
+        SDLTexture& operator=(SDLTexture&& other) noexcept {
+            if (this != &other) {
+                if (m_texture != nullptr) SDL_DestroyTexture(m_texture);
+                m_texture = other.m_texture;
+                other.m_texture = nullptr;
+            }
+            return *this;
+        }
+
+        SDL_Texture* get() {
+            return m_texture;
+        }
+
+    private:
+        SDL_Texture* m_texture;
+};
+
 #endif
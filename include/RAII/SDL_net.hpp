@@ -194,6 +194,7 @@ class NETAddress {
         }
         NETAddress& operator=(const NETAddress& other) {
             if (this != &other) {
+                if (m_addr != nullptr) NET_UnrefAddress(m_addr);
                 m_addr = other.m_addr;
                 NET_RefAddress(m_addr);
             }
@@ -206,6 +207,7 @@ class NETAddress {
         }
         NETAddress& operator=(NETAddress&& other) noexcept {
             if (this != &other) {
+                if (m_addr != nullptr) NET_UnrefAddress(m_addr);
                 m_addr = other.m_addr;
                 other.m_addr = nullptr;
             }
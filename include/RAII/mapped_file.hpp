@@ -0,0 +1,121 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Read only mapping of a whole file, the pages are only faulted in as they are touched */
+class MappedFile {
+    public:
+        /* How the file will be read, only a hint to the OS for read ahead */
+        enum class Access {
+            SEQUENTIAL,     // Front to back, all of it, soon
+            RANDOM,         // Small pieces on demand, nothing read ahead
+        };
+
+        explicit MappedFile(const char* path, Access access = Access::SEQUENTIAL) {
+#ifdef _WIN32
+            m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                    (access == Access::SEQUENTIAL) ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+            if (m_file == INVALID_HANDLE_VALUE) fail(path, "CreateFile");
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(m_file, &size)) fail(path, "GetFileSizeEx");
+            m_size = static_cast<std::size_t>(size.QuadPart);
+            if (m_size == 0) return;
+
+            m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (m_mapping == nullptr) fail(path, "CreateFileMapping");
+
+            m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+            if (m_data == nullptr) fail(path, "MapViewOfFile");
+#else
+            m_fd = open(path, O_RDONLY);
+            if (m_fd < 0) fail(path, "open");
+
+            struct stat st;
+            if (fstat(m_fd, &st) != 0) fail(path, "fstat");
+            m_size = static_cast<std::size_t>(st.st_size);
+            if (m_size == 0) return;
+
+            void* addr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+            if (addr == MAP_FAILED) fail(path, "mmap");
+            m_data = static_cast<const uint8_t*>(addr);
+
+            if (access == Access::SEQUENTIAL) {
+                /* Loads read every block front to back exactly once */
+                madvise(addr, m_size, MADV_SEQUENTIAL);
+                madvise(addr, m_size, MADV_WILLNEED);
+            } else {
+                madvise(addr, m_size, MADV_RANDOM);
+            }
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        MappedFile(MappedFile&&) = delete;
+        MappedFile& operator=(MappedFile&&) = delete;
+
+        ~MappedFile() {
+            close_all();
+        }
+
+        const uint8_t* data() const {
+            return m_data;
+        }
+
+        std::size_t size() const {
+            return m_size;
+        }
+
+    private:
+        [[noreturn]] void fail(const char* path, const char* what) {
+            std::cerr << "[ERROR] MappedFile::MappedFile -> " << what << " failed for " << path << std::endl;
+            close_all();
+            throw std::runtime_error("Failed to map file");
+        }
+
+        void close_all() {
+#ifdef _WIN32
+            if (m_data != nullptr) UnmapViewOfFile(m_data);
+            if (m_mapping != nullptr) CloseHandle(m_mapping);
+            if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+            m_mapping = nullptr;
+            m_file = INVALID_HANDLE_VALUE;
+#else
+            if (m_data != nullptr) munmap(const_cast<uint8_t*>(m_data), m_size);
+            if (m_fd >= 0) close(m_fd);
+            m_fd = -1;
+#endif
+            m_data = nullptr;
+        }
+
+    private:
+        const uint8_t*  m_data{nullptr};
+        std::size_t     m_size{0};
+
+#ifdef _WIN32
+        HANDLE  m_file{INVALID_HANDLE_VALUE};
+        HANDLE  m_mapping{nullptr};
+#else
+        int     m_fd{-1};
+#endif
+};
+
+#endif
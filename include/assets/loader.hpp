@@ -0,0 +1,246 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <assert.h>
+
+#include "SDL3/SDL_iostream.h"
+#include "SDL3/SDL_surface.h"
+
+#include "assets/pack.hpp"
+#include "RAII/SDL.hpp"
+#include "atlas.hpp"
+#include "renderer.hpp"
+
+namespace assets {
+    /* Served highest first, in request order within a priority */
+    enum class Priority : uint8_t {
+        LOW,
+        NORMAL,
+        HIGH,
+    };
+
+    /* What the loader fills in for one asset, shared with its handles */
+    struct Slot {
+        enum State : uint8_t {
+            PENDING,
+            LOADING,
+            READY,
+            FAILED,
+        };
+
+        std::atomic<uint8_t>        state{PENDING};
+        Priority                    priority{Priority::LOW};    // Highest requested, under the loader's lock
+        uint32_t                    entry{0};
+        Kind                        kind{BLOB};
+        Sprite                      sprite{};   // IMAGE
+        std::span<const uint8_t>    data;       // BLOB, in place in the pack
+    };
+
+    /* Becomes ready once the loader is done with the asset, the result is read only after that */
+    class Handle {
+        public:
+            Handle() = default;
+
+            bool ready() const {
+                return m_slot && m_slot->state.load(std::memory_order_acquire) == Slot::READY;
+            }
+            bool failed() const {
+                return !m_slot || m_slot->state.load(std::memory_order_acquire) == Slot::FAILED;
+            }
+
+            /* An IMAGE, drawn by a SpriteDrawable like any atlas sprite */
+            const Sprite& sprite() const {
+                assert(ready() && m_slot->kind == IMAGE);
+                return m_slot->sprite;
+            }
+
+            /* A BLOB, valid as long as the loader */
+            std::span<const uint8_t> data() const {
+                assert(ready() && m_slot->kind == BLOB);
+                return m_slot->data;
+            }
+
+        private:
+            friend class Loader;
+            explicit Handle(std::shared_ptr<const Slot> slot) : m_slot (std::move(slot)) {}
+
+        private:
+            std::shared_ptr<const Slot>     m_slot;
+    };
+
+    /*
+     * Streams assets out of a pack on a thread of its own. load() only queues
+     * the request and returns a handle at once, the loader thread faults the
+     * asset in from the mapping and decodes it, images go to the renderer as
+     * textures. Nothing is loaded that was not asked for, so opening a pack
+     * costs the same whatever its size.
+     */
+    class Loader {
+        public:
+            /* Images fail to load without a renderer to upload them to */
+            explicit Loader(const char* path, Renderer* renderer)
+            : m_pack (path)
+            , m_renderer (renderer)
+            {
+                m_thread = std::thread(&Loader::loop, this);
+            }
+
+            ~Loader() {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_running = false;
+                }
+                m_wake.notify_one();
+                m_thread.join();
+            }
+
+            Loader(const Loader&) = delete;
+            Loader& operator=(const Loader&) = delete;
+
+            /*
+             * Thread safe and never waits on a load. Asking for the same asset
+             * again returns a handle to the same load, with a higher priority it
+             * moves up the queue if it has not started yet.
+             */
+            Handle load(std::string_view name, Priority priority = Priority::NORMAL) {
+                auto entry = m_pack.find(name);
+                if (!entry.has_value()) {
+                    std::cerr << "[ERROR] assets::Loader::load -> No asset named " << name << std::endl;
+                    return Handle();
+                }
+
+                std::shared_ptr<Slot> slot;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    auto& existing = m_slots[entry.value()];
+                    if (existing && (existing->state.load(std::memory_order_relaxed) != Slot::PENDING || existing->priority >= priority)) {
+                        return Handle(existing);
+                    }
+
+                    if (!existing) {
+                        existing = std::make_shared<Slot>();
+                        existing->entry = entry.value();
+                        existing->kind = m_pack.asset(entry.value()).kind;
+                    }
+                    existing->priority = priority;
+                    slot = existing;
+
+                    /* A request left behind by a bump finds the slot taken and is dropped */
+                    m_queue.push(Request{priority, m_seq++, slot});
+                }
+                m_wake.notify_one();
+                return Handle(slot);
+            }
+
+            /* Requests not started yet */
+            std::size_t pending() const {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                return m_queue.size();
+            }
+
+            const Pack& pack() const {
+                return m_pack;
+            }
+
+        private:
+            struct Request {
+                Priority                priority;
+                uint64_t                seq;
+                std::shared_ptr<Slot>   slot;
+
+                /* Top of the priority_queue is the highest priority, then the oldest */
+                bool operator<(const Request& other) const {
+                    if (priority != other.priority) return priority < other.priority;
+                    return seq > other.seq;
+                }
+            };
+
+            void loop() {
+                while (true) {
+                    std::shared_ptr<Slot> slot;
+                    {
+                        std::unique_lock<std::mutex> lock(m_mutex);
+                        m_wake.wait(lock, [this] { return !m_running || !m_queue.empty(); });
+                        if (!m_running) return;
+
+                        slot = m_queue.top().slot;
+                        m_queue.pop();
+                        if (slot->state.load(std::memory_order_relaxed) != Slot::PENDING) continue;
+                        slot->state.store(Slot::LOADING, std::memory_order_relaxed);
+                    }
+
+                    bool loaded = decode(*slot);
+                    slot->state.store(loaded ? Slot::READY : Slot::FAILED, std::memory_order_release);
+                }
+            }
+
+            bool decode(Slot& slot) {
+                Asset asset = m_pack.asset(slot.entry);
+                switch (asset.kind) {
+                    case BLOB: {
+                        /* Fault the pages in here rather than on the thread that reads them */
+                        volatile uint8_t touched = 0;
+                        for (std::size_t i = 0; i < asset.data.size(); i += TOUCH_STRIDE) touched = asset.data[i];
+                        (void)touched;
+                        slot.data = asset.data;
+                        return true;
+                    }
+                    case IMAGE: {
+                        if (m_renderer == nullptr) {
+                            std::cerr << "[ERROR] assets::Loader::decode -> No renderer for " << m_pack.name(slot.entry) << std::endl;
+                            return false;
+                        }
+
+                        SDL_IOStream* io = SDL_IOFromConstMem(asset.data.data(), asset.data.size());
+                        SDLSurface loaded((io != nullptr) ? SDL_LoadBMP_IO(io, true) : nullptr);
+                        if (loaded.get() == nullptr) {
+                            std::cerr << "[ERROR] assets::Loader::decode -> SDL_LoadBMP_IO " << m_pack.name(slot.entry) << ": " << SDL_GetError() << std::endl;
+                            return false;
+                        }
+
+                        SDLSurface rgba(SDL_ConvertSurface(loaded.get(), SDL_PIXELFORMAT_RGBA32));
+                        if (rgba.get() == nullptr) {
+                            std::cerr << "[ERROR] assets::Loader::decode -> SDL_ConvertSurface " << m_pack.name(slot.entry) << ": " << SDL_GetError() << std::endl;
+                            return false;
+                        }
+                        slot.sprite = m_renderer->add_texture(std::move(rgba));
+                        return true;
+                    }
+                }
+
+                std::cerr << "[ERROR] assets::Loader::decode -> Unknown kind for " << m_pack.name(slot.entry) << std::endl;
+                return false;
+            }
+
+        private:
+            static constexpr std::size_t TOUCH_STRIDE = 4096;     // A page
+
+            Pack        m_pack;
+            Renderer*   m_renderer;
+
+            mutable std::mutex              m_mutex;
+            std::condition_variable         m_wake;
+            std::priority_queue<Request>    m_queue;
+            std::unordered_map<uint32_t, std::shared_ptr<Slot>>     m_slots;    // By pack entry, loaded or not
+            uint64_t                        m_seq{0};
+            bool                            m_running{true};
+
+            std::thread     m_thread;
+    };
+}
+
+#endif
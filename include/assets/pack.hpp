@@ -0,0 +1,231 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "RAII/mapped_file.hpp"
+
+/*
+ * Asset pack: every asset of the game in one file, mapped at startup. Opening
+ * a pack only reads its header and index, the assets themselves are faulted in
+ * from the mapping when a loader touches them, so startup does not depend on
+ * how large the pack is.
+ *
+ *   PackHeader | EntryDesc[num_entries] | names | pad | asset 0 | pad | asset 1 ...
+ *
+ * The index is sorted by the hash of the names for a binary search, the names
+ * are kept to tell apart the hashes that collide. Assets start on an ALIGNMENT
+ * boundary and are stored as their source files were, BMP for images.
+ */
+namespace assets {
+    static constexpr uint32_t MAGIC = 0x50414547;     // "GEAP"
+    static constexpr uint16_t VERSION = 1;
+    static constexpr uint16_t ENDIAN_MARK = 0x0102;
+    static constexpr std::size_t ALIGNMENT = 64;
+
+    enum Kind : uint16_t {
+        BLOB = 1,       // Raw bytes, used in place
+        IMAGE,          // BMP, decoded to a texture
+    };
+
+    struct PackHeader {
+        uint32_t    magic;
+        uint16_t    version;
+        uint16_t    byte_order;
+        uint32_t    num_entries;
+        uint32_t    names_size;
+        uint64_t    file_size;
+    };
+
+    struct EntryDesc {
+        uint64_t    hash;
+        uint64_t    offset;
+        uint64_t    size;
+        uint32_t    name_offset;        // In the names, right after the index
+        uint16_t    name_size;
+        uint16_t    kind;
+    };
+
+    /* FNV-1a, stable across builds and platforms */
+    inline uint64_t hash(std::string_view name) noexcept {
+        uint64_t h = 0xcbf29ce484222325ull;
+        for (char c : name) {
+            h ^= static_cast<uint8_t>(c);
+            h *= 0x100000001b3ull;
+        }
+        return h;
+    }
+
+    inline uint64_t align(uint64_t offset) noexcept {
+        return (offset + ALIGNMENT - 1) & ~static_cast<uint64_t>(ALIGNMENT - 1);
+    }
+
+    /* Builds a pack, the assets are copied in until write() */
+    class Writer {
+        public:
+            bool add(std::string name, Kind kind, std::vector<uint8_t> data) {
+                if (name.size() > UINT16_MAX) {
+                    std::cerr << "[ERROR] assets::Writer::add -> Name too long: " << name << std::endl;
+                    return false;
+                }
+                for (const auto& a : m_assets) {
+                    if (a.name == name) {
+                        std::cerr << "[ERROR] assets::Writer::add -> Duplicate asset " << name << std::endl;
+                        return false;
+                    }
+                }
+                m_assets.push_back(Pending{std::move(name), kind, std::move(data)});
+                return true;
+            }
+
+            bool write(const char* path) {
+                std::sort(m_assets.begin(), m_assets.end(), [](const Pending& a, const Pending& b) {
+                    uint64_t ha = hash(a.name), hb = hash(b.name);
+                    return (ha != hb) ? ha < hb : a.name < b.name;
+                });
+
+                std::vector<EntryDesc> index;
+                std::string names;
+                for (const auto& a : m_assets) {
+                    index.push_back(EntryDesc{hash(a.name), 0, a.data.size(),
+                            static_cast<uint32_t>(names.size()), static_cast<uint16_t>(a.name.size()), a.kind});
+                    names += a.name;
+                }
+
+                PackHeader header{MAGIC, VERSION, ENDIAN_MARK, static_cast<uint32_t>(index.size()), static_cast<uint32_t>(names.size()), 0};
+                uint64_t offset = align(sizeof(PackHeader) + index.size() * sizeof(EntryDesc) + names.size());
+                for (auto& e : index) {
+                    e.offset = offset;
+                    offset = align(offset + e.size);
+                }
+                header.file_size = offset;
+
+                std::ofstream out(path, std::ios::binary | std::ios::trunc);
+                if (!out) {
+                    std::cerr << "[ERROR] assets::Writer::write -> Could not open " << path << std::endl;
+                    return false;
+                }
+
+                out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                out.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(EntryDesc)));
+                out.write(names.data(), static_cast<std::streamsize>(names.size()));
+                for (std::size_t i = 0; i < m_assets.size(); ++i) {
+                    pad_to(out, index[i].offset);
+                    out.write(reinterpret_cast<const char*>(m_assets[i].data.data()), static_cast<std::streamsize>(m_assets[i].data.size()));
+                }
+                pad_to(out, header.file_size);
+
+                if (!out) {
+                    std::cerr << "[ERROR] assets::Writer::write -> Write to " << path << " failed" << std::endl;
+                    return false;
+                }
+                return true;
+            }
+
+        private:
+            struct Pending {
+                std::string             name;
+                Kind                    kind;
+                std::vector<uint8_t>    data;
+            };
+
+            static void pad_to(std::ofstream& out, uint64_t offset) {
+                static const char zeros[ALIGNMENT] = {};
+                uint64_t pos = static_cast<uint64_t>(out.tellp());
+                if (offset > pos) out.write(zeros, static_cast<std::streamsize>(offset - pos));
+            }
+
+        private:
+            std::vector<Pending>    m_assets;
+    };
+
+    /* An asset in place inside the mapping */
+    struct Asset {
+        Kind                        kind;
+        std::span<const uint8_t>    data;
+    };
+
+    /* Maps a pack and validates its header and index up front, nothing else is read */
+    class Pack {
+        public:
+            explicit Pack(const char* path) : m_file (path, MappedFile::Access::RANDOM) {
+                if (m_file.size() < sizeof(PackHeader)) fail("File too small");
+
+                std::memcpy(&m_header, m_file.data(), sizeof(PackHeader));
+                if (m_header.magic != MAGIC) fail("Not an asset pack");
+                if (m_header.byte_order != ENDIAN_MARK) fail("Packed with a different byte order");
+                if (m_header.version != VERSION) fail("Unsupported version");
+                if (m_header.file_size != m_file.size()) fail("Truncated file");
+
+                uint64_t index_end = sizeof(PackHeader) + static_cast<uint64_t>(m_header.num_entries) * sizeof(EntryDesc);
+                if (index_end + m_header.names_size > m_file.size()) fail("Truncated index");
+
+                m_index.resize(m_header.num_entries);
+                std::memcpy(m_index.data(), m_file.data() + sizeof(PackHeader), m_index.size() * sizeof(EntryDesc));
+                m_names = std::string_view(reinterpret_cast<const char*>(m_file.data() + index_end), m_header.names_size);
+                for (std::size_t i = 0; i < m_index.size(); ++i) {
+                    const EntryDesc& e = m_index[i];
+                    /* Compared without adding, a hostile offset cannot wrap around and pass */
+                    if (e.offset % ALIGNMENT != 0 || e.size > m_file.size() || e.offset > m_file.size() - e.size) fail("Asset out of bounds");
+                    if (static_cast<uint64_t>(e.name_offset) + e.name_size > m_names.size()) fail("Name out of bounds");
+                    if (i > 0 && m_index[i - 1].hash > e.hash) fail("Index not sorted");
+                }
+            }
+
+            Pack(const Pack&) = delete;
+            Pack& operator=(const Pack&) = delete;
+
+            /* Entry of name in the index */
+            std::optional<uint32_t> find(std::string_view name) const {
+                uint64_t h = hash(name);
+                auto it = std::lower_bound(m_index.begin(), m_index.end(), h, [](const EntryDesc& e, uint64_t h) {
+                    return e.hash < h;
+                });
+                for (; it != m_index.end() && it->hash == h; ++it) {
+                    if (m_names.substr(it->name_offset, it->name_size) == name) {
+                        return static_cast<uint32_t>(it - m_index.begin());
+                    }
+                }
+                return std::nullopt;
+            }
+
+            /* Touching the data faults it in from the file */
+            Asset asset(uint32_t entry) const {
+                const EntryDesc& e = m_index[entry];
+                return Asset{static_cast<Kind>(e.kind), std::span<const uint8_t>(m_file.data() + e.offset, e.size)};
+            }
+
+            std::string_view name(uint32_t entry) const {
+                return m_names.substr(m_index[entry].name_offset, m_index[entry].name_size);
+            }
+
+            std::size_t size() const {
+                return m_index.size();
+            }
+
+        private:
+            [[noreturn]] static void fail(const char* what) {
+                std::cerr << "[ERROR] assets::Pack -> " << what << std::endl;
+                throw std::runtime_error("Failed to open asset pack");
+            }
+
+        private:
+            MappedFile              m_file;
+            PackHeader              m_header{};
+            std::vector<EntryDesc>  m_index;
+            std::string_view        m_names;        // In the mapping
+    };
+}
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "SDL3/SDL_rect.h"
+#include "SDL3/SDL_render.h"
+#include "SDL3/SDL_surface.h"
+
+#include "RAII/SDL.hpp"
+#include "vector.hpp"
+
+/* A region of an atlas, what a SpriteDrawable draws */
+struct Sprite {
+    uint32_t            atlas;
+    SDL_FRect           uv;         // Normalized texture coordinates in the atlas
+    Vector2D<double>    size;       // In pixels
+};
+
+/*
+ * Packs loose images into a few large surfaces at startup, so that everything
+ * drawn from the same atlas shares one texture and can go out in one draw
+ * call. Images are placed on shelves, tallest first, and a new atlas is
+ * started when one is full.
+ *
+ * Surfaces are only CPU side until upload(), which must run on the thread that
+ * owns the renderer. Lookups are read only once packed, and size() can be read
+ * from any thread.
+ */
+class Atlases {
+    public:
+        static constexpr int ATLAS_SIZE = 2048;     // Supported by about every GPU
+        static constexpr int PADDING = 1;           // Between images, so filtering never samples a neighbour
+
+        /* Adds every .bmp directly in dir, named after the file without its extension */
+        bool load_directory(const std::filesystem::path& dir) {
+            std::error_code ec;
+            std::filesystem::directory_iterator it(dir, ec);
+            if (ec) return false;
+
+            std::vector<std::filesystem::path> files;
+            for (const auto& entry : it) {
+                if (entry.is_regular_file(ec) && entry.path().extension() == ".bmp") files.push_back(entry.path());
+            }
+            /* Directory order is not stable, packing must be */
+            std::sort(files.begin(), files.end());
+            for (const auto& file : files) add_image(file.stem().string(), file.string().c_str());
+            return true;
+        }
+
+        bool add_image(std::string name, const char* path) {
+            SDLSurface loaded(SDL_LoadBMP(path));
+            if (loaded.get() == nullptr) {
+                std::cerr << "[ERROR] Atlases::add_image -> SDL_LoadBMP " << path << ": " << SDL_GetError() << std::endl;
+                return false;
+            }
+
+            return add_surface(std::move(name), std::move(loaded));
+        }
+
+        /* An image made or loaded by the caller, in any pixel format */
+        bool add_surface(std::string name, SDLSurface surface) {
+            SDLSurface rgba(SDL_ConvertSurface(surface.get(), SDL_PIXELFORMAT_RGBA32));
+            if (rgba.get() == nullptr) {
+                std::cerr << "[ERROR] Atlases::add_surface -> SDL_ConvertSurface " << name << ": " << SDL_GetError() << std::endl;
+                return false;
+            }
+            if (rgba.get()->w + PADDING > ATLAS_SIZE || rgba.get()->h + PADDING > ATLAS_SIZE) {
+                std::cerr << "[ERROR] Atlases::add_surface -> " << name << " does not fit in an atlas" << std::endl;
+                return false;
+            }
+
+            /* Copied as is into the atlas, not blended onto it */
+            SDL_SetSurfaceBlendMode(rgba.get(), SDL_BLENDMODE_NONE);
+            m_images.push_back(Image{std::move(name), std::move(rgba)});
+            return true;
+        }
+
+        /* Packs the images added since the last pack into new atlases */
+        void pack() {
+            std::vector<std::size_t> order(m_images.size());
+            for (std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+            std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) {
+                return m_images[a].surface.get()->h > m_images[b].surface.get()->h;
+            });
+
+            /* Placement first, atlases are only as tall as their last shelf */
+            struct Placement {
+                std::size_t image;
+                uint32_t    atlas;
+                int         x, y;
+            };
+            std::vector<Placement> placements;
+            std::vector<int> heights;
+            int x = 0, y = 0, shelf = 0;
+            for (std::size_t i : order) {
+                int w = m_images[i].surface.get()->w + PADDING;
+                int h = m_images[i].surface.get()->h + PADDING;
+                if (heights.empty() || (x + w > ATLAS_SIZE && y + shelf + h > ATLAS_SIZE) || y + h > ATLAS_SIZE) {
+                    heights.push_back(0);
+                    x = 0, y = 0, shelf = 0;
+                } else if (x + w > ATLAS_SIZE) {
+                    x = 0, y += shelf, shelf = 0;
+                }
+
+                placements.push_back(Placement{i, static_cast<uint32_t>(size() + heights.size() - 1), x, y});
+                shelf = std::max(shelf, h);
+                heights.back() = std::max(heights.back(), y + h);
+                x += w;
+            }
+
+            for (int h : heights) {
+                m_surfaces.emplace_back(SDL_CreateSurface(ATLAS_SIZE, h, SDL_PIXELFORMAT_RGBA32));
+                if (m_surfaces.back().get() == nullptr) {
+                    std::cerr << "[ERROR] Atlases::pack -> SDL_CreateSurface: " << SDL_GetError() << std::endl;
+                    throw std::runtime_error("Failed to create atlas surface");
+                }
+            }
+
+            for (const Placement& p : placements) {
+                SDL_Surface* image = m_images[p.image].surface.get();
+                SDL_Surface* atlas = m_surfaces[p.atlas - m_uploaded].get();
+                SDL_Rect dst{p.x, p.y, image->w, image->h};
+                SDL_BlitSurface(image, nullptr, atlas, &dst);
+
+                SDL_FRect uv{
+                    static_cast<float>(p.x) / atlas->w,
+                    static_cast<float>(p.y) / atlas->h,
+                    static_cast<float>(image->w) / atlas->w,
+                    static_cast<float>(image->h) / atlas->h
+                };
+                m_sprites[m_images[p.image].name] = Sprite{p.atlas, uv, Vector2D<double>{
+                    static_cast<double>(image->w), static_cast<double>(image->h)}};
+            }
+            m_images.clear();
+            m_packed.store(m_packed.load(std::memory_order_relaxed) + heights.size(), std::memory_order_release);
+        }
+
+        std::optional<Sprite> find(std::string_view name) const {
+            auto it = m_sprites.find(std::string(name));
+            if (it == m_sprites.end()) return std::nullopt;
+            return it->second;
+        }
+
+        /* Thread safe, atlases packed so far, uploaded or not */
+        std::size_t size() const {
+            return m_packed.load(std::memory_order_acquire);
+        }
+
+        /* One texture per atlas packed since the last upload, in Sprite::atlas order. The surfaces are released */
+        std::vector<SDLTexture> upload(SDL_Renderer* renderer) {
+            std::vector<SDLTexture> textures;
+            textures.reserve(m_surfaces.size());
+            for (auto& surface : m_surfaces) {
+                textures.emplace_back(renderer, surface.get());
+                SDL_SetTextureBlendMode(textures.back().get(), SDL_BLENDMODE_BLEND);
+                SDL_SetTextureScaleMode(textures.back().get(), SDL_SCALEMODE_NEAREST);
+            }
+            m_uploaded += m_surfaces.size();
+            m_surfaces.clear();
+            return textures;
+        }
+
+    private:
+        struct Image {
+            std::string name;
+            SDLSurface  surface;
+        };
+
+    private:
+        std::vector<Image>                          m_images;       // Added, not packed yet
+        std::vector<SDLSurface>                     m_surfaces;     // Until uploaded
+        std::size_t                                 m_uploaded{0};
+        std::atomic<std::size_t>                    m_packed{0};    // Only changed by pack(), upload() moves them to the GPU
+        std::unordered_map<std::string, Sprite>     m_sprites;
+};
+
+#endif
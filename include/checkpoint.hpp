@@ -0,0 +1,552 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "RAII/mapped_file.hpp"
+#include "physics.hpp"
+#include "save.hpp"
+
+/*
+ * Incremental checkpoints of a live world. The file is a header followed by
+ * records appended one per checkpoint, each carrying the size of every block
+ * and only the pages that changed since the previous record:
+ *
+ *   FileHeader | Record 0 | Record 1 | ...
+ *   Record = RecordHeader | BlockInfo[num_blocks] | (PageHeader | bytes | pad)[num_pages] | RecordFooter
+ *
+ * A record only counts once its footer is on disk, so a crash halfway through
+ * an append loses that checkpoint and not the file. Every COMPACT_EVERY
+ * records the file is rewritten as a single full record.
+ *
+ * Blocks use the save.hpp kinds and layouts, except the physics bodies which
+ * are kept as the published PhysicsSnapshot and only split into the save.hpp
+ * arrays when read back.
+ */
+namespace checkpoint {
+    static constexpr uint32_t MAGIC = 0x4b434547;           // "GECK"
+    static constexpr uint32_t RECORD_MAGIC = 0x54504b43;    // "CKPT"
+    static constexpr uint32_t FOOTER_MAGIC = 0x454e4f44;    // "DONE"
+    static constexpr uint16_t VERSION = 2;
+
+    /* Changes are found and written at this granularity, rounded to whole elements */
+    static constexpr std::size_t DIFF_BYTES = 4096;
+    static constexpr uint64_t COMPACT_EVERY = 64;
+
+    static constexpr uint32_t PHYSICS_SNAPSHOT = save::RENDER_REGISTRY + 1;
+
+    struct FileHeader {
+        uint32_t    magic;
+        uint16_t    version;
+        uint16_t    endian_mark;
+        uint32_t    reserved[2];
+    };
+
+    struct RecordHeader {
+        uint32_t    magic;
+        uint32_t    num_blocks;
+        uint32_t    num_pages;
+        uint32_t    reserved;
+        uint64_t    seq;
+        uint64_t    size;       // Whole record, footer included
+    };
+
+    struct BlockInfo {
+        uint32_t    kind;
+        uint32_t    elem_size;
+        uint64_t    count;
+    };
+
+    struct PageHeader {
+        uint32_t    kind;
+        uint32_t    reserved;
+        uint64_t    first;
+        uint64_t    count;
+    };
+
+    struct RecordFooter {
+        uint32_t    magic;
+        uint32_t    reserved;
+        uint64_t    seq;
+    };
+
+    inline uint64_t pad8(uint64_t n) noexcept {
+        return (n + 7) & ~uint64_t{7};
+    }
+
+    /* What the world thread hands over: block sizes, copies of its dirty pages and the pinned physics */
+    struct Capture {
+        std::vector<BlockInfo>      blocks;
+        std::vector<PageHeader>     pages;
+        std::vector<uint8_t>        bytes;      // Page payloads back to back, in page order
+        std::span<const PhysicsSnapshot>    physics;
+
+        void clear() {
+            blocks.clear();
+            pages.clear();
+            bytes.clear();
+            physics = {};
+        }
+
+        template<typename T>
+        void block(uint32_t kind, uint64_t count) {
+            blocks.push_back(BlockInfo{kind, sizeof(T), count});
+        }
+
+        template<typename T>
+        void page(uint32_t kind, uint64_t first, std::span<const T> elems) {
+            static_assert(std::is_trivially_copyable_v<T>, "Pages are copied as raw memory");
+            pages.push_back(PageHeader{kind, 0, first, elems.size()});
+            const uint8_t* src = reinterpret_cast<const uint8_t*>(elems.data());
+            bytes.insert(bytes.end(), src, src + elems.size_bytes());
+        }
+    };
+
+    /* Every block as raw bytes, the writer's view of the file and the result of reading one back */
+    class Image {
+        public:
+            Image() = default;
+
+            /* Replays every complete record of the file at path, throws if there is none */
+            explicit Image(const char* path) {
+                MappedFile file(path);
+                const uint8_t* data = file.data();
+                uint64_t size = file.size();
+
+                FileHeader header{};
+                if (size < sizeof(header)) fail("File too small");
+                std::memcpy(&header, data, sizeof(header));
+                if (header.magic != MAGIC) fail("Not a checkpoint file");
+                if (header.endian_mark != save::ENDIAN_MARK) fail("Written with a different byte order");
+                if (header.version != VERSION) fail("Unsupported version");
+
+                uint64_t offset = sizeof(header);
+                uint64_t records = 0;
+                while (offset + sizeof(RecordHeader) + sizeof(RecordFooter) <= size) {
+                    RecordHeader rec{};
+                    std::memcpy(&rec, data + offset, sizeof(rec));
+                    if (rec.magic != RECORD_MAGIC || rec.size > size - offset) break;
+                    if (rec.size < sizeof(RecordHeader) + sizeof(RecordFooter)) fail("Record too small");
+
+                    RecordFooter footer{};
+                    std::memcpy(&footer, data + offset + rec.size - sizeof(footer), sizeof(footer));
+                    if (footer.magic != FOOTER_MAGIC || footer.seq != rec.seq) break;     // Torn append
+
+                    /* Complete on disk, anything wrong inside is corruption rather than a crash mid append */
+                    apply_record(data + offset, rec, size);
+                    offset += rec.size;
+                    ++records;
+                }
+                if (records == 0) fail("No complete checkpoint");
+
+                split_physics();
+            }
+
+            void resize(const BlockInfo& info) {
+                Block& b = m_blocks[info.kind];
+                b.elem_size = info.elem_size;
+                b.count = info.count;
+                b.bytes.resize(info.elem_size * info.count);
+            }
+
+            /* Copies the page in, returns false if it was identical */
+            bool update(uint32_t kind, uint64_t first, uint64_t count, const uint8_t* src) {
+                Block& b = m_blocks[kind];
+                uint8_t* dst = b.bytes.data() + first * b.elem_size;
+                std::size_t len = count * b.elem_size;
+                if (std::memcmp(dst, src, len) == 0) return false;
+                std::memcpy(dst, src, len);
+                return true;
+            }
+
+            bool contains(uint32_t kind, uint64_t first, uint64_t count) const {
+                auto it = m_blocks.find(kind);
+                return it != m_blocks.end() && first <= it->second.count && count <= it->second.count - first;
+            }
+
+            uint32_t elem_size(uint32_t kind) const {
+                auto it = m_blocks.find(kind);
+                return (it == m_blocks.end()) ? 0 : it->second.elem_size;
+            }
+
+            /* Same contract as save::Reader::block */
+            template<typename T>
+            std::span<const T> block(uint32_t kind) const {
+                static_assert(std::is_trivially_copyable_v<T>, "Blocks are read as raw memory");
+                auto it = m_blocks.find(kind);
+                if (it == m_blocks.end()) fail("Missing block");
+                if (it->second.elem_size != sizeof(T)) fail("Block element size mismatch");
+                return {reinterpret_cast<const T*>(it->second.bytes.data()), it->second.count};
+            }
+
+            /* The whole image as one record, each block a single page */
+            void write_full(std::ofstream& out, uint64_t seq) const {
+                RecordHeader rec{RECORD_MAGIC, static_cast<uint32_t>(m_blocks.size()),
+                    static_cast<uint32_t>(m_blocks.size()), 0, seq, 0};
+                rec.size = sizeof(RecordHeader) + m_blocks.size() * (sizeof(BlockInfo) + sizeof(PageHeader)) + sizeof(RecordFooter);
+                for (const auto& [kind, b] : m_blocks) rec.size += pad8(b.bytes.size());
+
+                out.write(reinterpret_cast<const char*>(&rec), sizeof(rec));
+                for (const auto& [kind, b] : m_blocks) {
+                    BlockInfo info{kind, b.elem_size, b.count};
+                    out.write(reinterpret_cast<const char*>(&info), sizeof(info));
+                }
+                for (const auto& [kind, b] : m_blocks) {
+                    PageHeader page{kind, 0, 0, b.count};
+                    out.write(reinterpret_cast<const char*>(&page), sizeof(page));
+                    out.write(reinterpret_cast<const char*>(b.bytes.data()), static_cast<std::streamsize>(b.bytes.size()));
+                    write_padding(out, b.bytes.size());
+                }
+                RecordFooter footer{FOOTER_MAGIC, 0, seq};
+                out.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+            }
+
+            static void write_padding(std::ofstream& out, std::size_t len) {
+                static const char zeros[8] = {};
+                out.write(zeros, static_cast<std::streamsize>(pad8(len) - len));
+            }
+
+        private:
+            struct Block {
+                uint32_t    elem_size{0};
+                uint64_t    count{0};
+                std::vector<uint8_t>    bytes;
+            };
+
+            struct PendingPage {
+                PageHeader  page;
+                uint64_t    offset;     // Of the payload in the record
+            };
+
+        private:
+            [[noreturn]] static void fail(const char* what) {
+                std::cerr << "[ERROR] checkpoint::Image -> " << what << std::endl;
+                throw std::runtime_error("Failed to read checkpoint");
+            }
+
+            /*
+             * Every block size and page of the record is checked before the image
+             * is touched, so a bad record leaves nothing half applied. A block
+             * holds at most as many bytes as the whole file, every block was
+             * written in full by some record of it.
+             */
+            void apply_record(const uint8_t* rec_data, const RecordHeader& rec, uint64_t file_size) {
+                uint64_t offset = sizeof(RecordHeader);
+                uint64_t end = rec.size - sizeof(RecordFooter);
+                if (rec.num_blocks > (end - offset) / sizeof(BlockInfo)) fail("Block table out of bounds");
+
+                m_record_blocks.resize(rec.num_blocks);
+                for (BlockInfo& info : m_record_blocks) {
+                    std::memcpy(&info, rec_data + offset, sizeof(info));
+                    offset += sizeof(info);
+
+                    if (info.elem_size == 0 || info.count > file_size / info.elem_size) fail("Block too large");
+                    auto it = m_blocks.find(info.kind);
+                    if (it != m_blocks.end() && it->second.elem_size != info.elem_size) fail("Block element size changed");
+                }
+
+                /* The size a block has once this record is applied, the last BlockInfo of a kind wins */
+                auto block_info = [this](uint32_t kind) -> std::optional<BlockInfo> {
+                    for (auto it = m_record_blocks.rbegin(); it != m_record_blocks.rend(); ++it) {
+                        if (it->kind == kind) return *it;
+                    }
+                    auto it = m_blocks.find(kind);
+                    if (it == m_blocks.end()) return std::nullopt;
+                    return BlockInfo{kind, it->second.elem_size, it->second.count};
+                };
+
+                m_record_pages.clear();
+                for (uint32_t i = 0; i < rec.num_pages; ++i) {
+                    if (offset > end || end - offset < sizeof(PageHeader)) fail("Page out of bounds");
+                    PageHeader page{};
+                    std::memcpy(&page, rec_data + offset, sizeof(page));
+                    offset += sizeof(page);
+
+                    auto info = block_info(page.kind);
+                    if (!info.has_value() || page.first > info->count || page.count > info->count - page.first) fail("Page outside its block");
+                    if (page.count > (end - offset) / info->elem_size) fail("Page out of bounds");
+
+                    m_record_pages.push_back(PendingPage{page, offset});
+                    offset += pad8(page.count * info->elem_size);
+                }
+
+                for (const BlockInfo& info : m_record_blocks) resize(info);
+                for (const PendingPage& p : m_record_pages) update(p.page.kind, p.page.first, p.page.count, rec_data + p.offset);
+            }
+
+            /* Turns the PhysicsSnapshot block into the arrays save::Reader hands to PhysicsCore::restore */
+            void split_physics() {
+                std::span<const PhysicsSnapshot> snap = block<PhysicsSnapshot>(PHYSICS_SNAPSHOT);
+
+                std::vector<PhysicsCore::PhysicsData> data(snap.size());
+                std::vector<std::size_t> transforms(snap.size());
+                std::vector<uint32_t> input_seqs(snap.size());
+                std::vector<EntityID> ids(snap.size());
+                for (std::size_t i = 0; i < snap.size(); ++i) {
+                    data[i] = PhysicsCore::PhysicsData{snap[i].pos, snap[i].speed, snap[i].acc, snap[i].collider};
+                    transforms[i] = snap[i].transform_idx;
+                    input_seqs[i] = snap[i].input_seq;
+                    ids[i] = snap[i].id;
+                }
+
+                adopt(save::PHYSICS_DATA, data);
+                adopt(save::PHYSICS_TRANSFORMS, transforms);
+                adopt(save::PHYSICS_INPUT_SEQS, input_seqs);
+                adopt(save::PHYSICS_IDS, ids);
+                m_blocks.erase(PHYSICS_SNAPSHOT);
+            }
+
+            template<typename T>
+            void adopt(uint32_t kind, const std::vector<T>& elems) {
+                resize(BlockInfo{kind, sizeof(T), elems.size()});
+                if (!elems.empty()) std::memcpy(m_blocks[kind].bytes.data(), elems.data(), elems.size() * sizeof(T));
+            }
+
+        private:
+            std::map<uint32_t, Block>   m_blocks;
+
+            /* Scratch of apply_record, the record being validated */
+            std::vector<BlockInfo>      m_record_blocks;
+            std::vector<PendingPage>    m_record_pages;
+    };
+}
+
+/*
+ * Background writer of incremental checkpoints. The world thread fills a
+ * Capture, cheap since it only copies dirty pool pages and pins the physics
+ * snapshot in place, and hands it over; finding what really changed against
+ * the previous checkpoint and writing it happens here. If the writer is still
+ * busy when the next checkpoint is due that checkpoint is skipped, the dirty
+ * pages simply carry over to the next one.
+ */
+class Checkpointer {
+    public:
+        Checkpointer(const char* path, PhysicsCore& physics, double interval)
+            : m_path (path)
+            , m_physics (physics)
+            , m_interval (std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>{interval}))
+            , m_next_due (std::chrono::steady_clock::now() + m_interval)
+        {
+            m_running.store(true, std::memory_order_relaxed);
+            m_thread = std::thread(&Checkpointer::loop, this);
+        }
+
+        ~Checkpointer() {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_running.store(false, std::memory_order_relaxed);
+            }
+            m_wake.notify_one();
+            if (m_thread.joinable()) m_thread.join();
+        }
+
+        Checkpointer(const Checkpointer&) = delete;
+        Checkpointer& operator=(const Checkpointer&) = delete;
+
+        bool due(std::chrono::steady_clock::time_point now) const {
+            return now >= m_next_due;
+        }
+
+        /* World thread. The capture to fill, nullptr if the previous one is still being written */
+        checkpoint::Capture* begin(std::chrono::steady_clock::time_point now) {
+            m_next_due = now + m_interval;
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_pending) {
+                ++m_skipped;
+                return nullptr;
+            }
+            m_capture.clear();
+            return &m_capture;
+        }
+
+        /* World thread, instead of submit when the state could not be captured, begins again on the next tick */
+        void retry(std::chrono::steady_clock::time_point now) {
+            m_next_due = now;
+        }
+
+        /* World thread, capture_time is what the capture cost the tick */
+        void submit(std::chrono::steady_clock::duration capture_time) {
+            m_last_capture = capture_time;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pending = true;
+            }
+            m_wake.notify_one();
+        }
+
+        std::chrono::steady_clock::duration last_capture_time() const {
+            return m_last_capture;
+        }
+        uint64_t checkpoints_written() const {
+            return m_written.load(std::memory_order_relaxed);
+        }
+        uint64_t checkpoints_skipped() const {
+            return m_skipped;
+        }
+
+    private:
+        void loop() {
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_wake.wait(lock, [this] { return m_pending || !m_running.load(std::memory_order_relaxed); });
+                    if (!m_pending) return;
+                }
+
+                write(m_capture);
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pending = false;
+            }
+        }
+
+        void write(const checkpoint::Capture& capture) {
+            uint64_t seq = ++m_seq;
+
+            m_record.clear();
+            m_record.resize(sizeof(checkpoint::RecordHeader));
+            uint32_t num_pages = 0;
+
+            for (const auto& info : capture.blocks) {
+                m_image.resize(info);
+                append(&info, sizeof(info));
+            }
+            checkpoint::BlockInfo physics{checkpoint::PHYSICS_SNAPSHOT, sizeof(PhysicsSnapshot), capture.physics.size()};
+            m_image.resize(physics);
+            append(&physics, sizeof(physics));
+
+            const uint8_t* src = capture.bytes.data();
+            for (const auto& page : capture.pages) {
+                uint32_t elem = m_image.elem_size(page.kind);
+                num_pages += diff(page.kind, page.first, page.count, src);
+                src += page.count * elem;
+            }
+
+            /* The pinned snapshot is only read here, on this thread, and released as soon as it is diffed */
+            num_pages += diff(checkpoint::PHYSICS_SNAPSHOT, 0, capture.physics.size(),
+                    reinterpret_cast<const uint8_t*>(capture.physics.data()));
+            m_physics.unpin();
+
+            checkpoint::RecordFooter footer{checkpoint::FOOTER_MAGIC, 0, seq};
+            append(&footer, sizeof(footer));
+
+            checkpoint::RecordHeader header{checkpoint::RECORD_MAGIC,
+                static_cast<uint32_t>(capture.blocks.size() + 1), num_pages, 0, seq, m_record.size()};
+            std::memcpy(m_record.data(), &header, sizeof(header));
+
+            if (m_records_in_file == 0 || m_records_in_file >= checkpoint::COMPACT_EVERY) {
+                compact(seq);
+            } else {
+                m_out.write(reinterpret_cast<const char*>(m_record.data()), static_cast<std::streamsize>(m_record.size()));
+                m_out.flush();
+                ++m_records_in_file;
+            }
+
+            if (!m_out) {
+                std::cerr << "[ERROR] Checkpointer::write -> Could not write " << m_path << std::endl;
+                m_records_in_file = 0;      // Start over with a fresh file next time
+            }
+            m_written.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /* Appends a page record for every DIFF_BYTES chunk that differs from the image */
+        uint32_t diff(uint32_t kind, uint64_t first, uint64_t count, const uint8_t* src) {
+            uint32_t elem = m_image.elem_size(kind);
+            if (elem == 0 || !m_image.contains(kind, first, count)) return 0;
+
+            uint64_t chunk = std::max<uint64_t>(1, checkpoint::DIFF_BYTES / elem);
+            uint32_t written = 0;
+            for (uint64_t off = 0; off < count; off += chunk) {
+                uint64_t n = std::min(chunk, count - off);
+                const uint8_t* data = src + off * elem;
+                if (!m_image.update(kind, first + off, n, data)) continue;
+
+                checkpoint::PageHeader page{kind, 0, first + off, n};
+                append(&page, sizeof(page));
+                append(data, n * elem);
+                m_record.resize(checkpoint::pad8(m_record.size()), 0);
+                ++written;
+            }
+            return written;
+        }
+
+        /* Rewrites the file as one full record, through a temporary so a crash leaves the old file intact */
+        void compact(uint64_t seq) {
+            std::string tmp = m_path + ".tmp";
+
+            m_out.close();
+            {
+                std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+                checkpoint::FileHeader header{checkpoint::MAGIC, checkpoint::VERSION, save::ENDIAN_MARK, {0, 0}};
+                out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                m_image.write_full(out, seq);
+                out.flush();
+                if (!out) {
+                    std::cerr << "[ERROR] Checkpointer::compact -> Could not write " << tmp << std::endl;
+                    return;
+                }
+            }
+
+            std::error_code ec;
+            std::filesystem::rename(tmp, m_path, ec);
+            if (ec) {
+                std::cerr << "[ERROR] Checkpointer::compact -> " << ec.message() << std::endl;
+                return;
+            }
+
+            m_out.clear();
+            m_out.open(m_path, std::ios::binary | std::ios::app);
+            m_records_in_file = 1;
+        }
+
+        void append(const void* data, std::size_t len) {
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            m_record.insert(m_record.end(), bytes, bytes + len);
+        }
+
+    private:
+        std::string     m_path;
+        PhysicsCore&    m_physics;
+
+        std::chrono::steady_clock::duration     m_interval;
+        std::chrono::steady_clock::time_point   m_next_due;
+        std::chrono::steady_clock::duration     m_last_capture{0};
+        uint64_t        m_skipped{0};
+
+        std::mutex                  m_mutex;
+        std::condition_variable     m_wake;
+        bool                        m_pending{false};
+        checkpoint::Capture         m_capture;
+
+        /* Writer thread only */
+        checkpoint::Image       m_image;
+        std::vector<uint8_t>    m_record;
+        std::ofstream           m_out;
+        uint64_t                m_seq{0};
+        uint64_t                m_records_in_file{0};
+
+        std::atomic<uint64_t>   m_written{0};
+        std::atomic<bool>       m_running;
+        std::thread             m_thread;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef COMMAND_BUFFER_H
+#define COMMAND_BUFFER_H
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "containers/component_pool.hpp"
+#include "containers/typemap.hpp"
+
+#include "entity.hpp"
+
+template<typename Pools>
+class CommandBuffer;
+
+/*
+ * Structural changes recorded while the pools are being iterated, and applied
+ * later at a sync point by World::apply. Nothing in a buffer is shared, each
+ * thread records into its own. Ids are reserved as soon as create() is called
+ * so later commands can refer to the new entity.
+ *
+ * Commands are kept per pool rather than in order. At apply, every removal
+ * and destroyed entity goes first, as one batched cascade per pool, then the
+ * adds. The parent index of an added child component is resolved then, the
+ * one it was built with does not matter.
+ */
+template<typename... Ts, typename... Rs>
+class CommandBuffer<TypeMap<ComponentPool<Ts, Rs>...>> {
+    public:
+        EntityID create() {
+            EntityID eid = m_entity_manager.create();
+            m_created.push_back(eid);
+            return eid;
+        }
+
+        /* Removes every component of eid */
+        void destroy(EntityID eid) {
+            m_destroyed.push_back(eid);
+        }
+
+        template<typename T>
+        void add(EntityID owner, T comp) {
+            std::get<index_of<T>()>(m_adds).emplace_back(owner, std::move(comp));
+        }
+
+        template<typename T>
+        void remove(EntityID owner) {
+            m_removes[index_of<T>()].push_back(owner);
+        }
+
+        bool empty() const {
+            bool none = m_created.empty() && m_destroyed.empty();
+            std::apply([&none](const auto&... adds) { ((none = none && adds.empty()), ...); }, m_adds);
+            for (const auto& removes : m_removes) none = none && removes.empty();
+            return none;
+        }
+
+        /* Components added but never applied are destroyed with the buffer's contents */
+        void clear() {
+            m_created.clear();
+            m_destroyed.clear();
+            std::apply([](auto&... adds) { (adds.clear(), ...); }, m_adds);
+            for (auto& removes : m_removes) removes.clear();
+        }
+
+        std::span<const EntityID> created() const {
+            return m_created;
+        }
+        std::span<const EntityID> destroyed() const {
+            return m_destroyed;
+        }
+
+        /* The pending adds of T, the components are moved out when applied */
+        template<typename T>
+        std::vector<ComponentEntry<T>>& adds() {
+            return std::get<index_of<T>()>(m_adds);
+        }
+
+        template<typename T>
+        std::span<const EntityID> removes() const {
+            return m_removes[index_of<T>()];
+        }
+
+    private:
+        /* Same position as the pool of T in the TypeMap */
+        template<typename T>
+        static constexpr std::size_t index_of() {
+            constexpr bool matches[] = {std::is_same_v<T, Ts>...};
+            std::size_t idx = 0;
+            while (idx < sizeof... (Ts) && !matches[idx]) ++idx;
+            static_assert(((std::is_same_v<T, Ts> ? 1 : 0) + ...) == 1, "Type not found in CommandBuffer");
+            return idx;
+        }
+
+    private:
+        EntityManager   m_entity_manager;
+        std::vector<EntityID>   m_created;
+        std::vector<EntityID>   m_destroyed;
+
+        std::tuple<std::vector<ComponentEntry<Ts>>...>          m_adds;
+        std::array<std::vector<EntityID>, sizeof... (Ts)>       m_removes;
+};
+
+#endif
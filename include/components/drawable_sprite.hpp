@@ -0,0 +1,34 @@
+#ifndef DRAWABLE_SPRITE_H
+#define DRAWABLE_SPRITE_H
+
+#include <cstddef>
+
+#include "containers/registry.hpp"
+
+#include "components/transform.hpp"
+
+#include "atlas.hpp"
+#include "renderer.hpp"
+
+/* Draws a region of an atlas, see Renderer::sprite to look one up by name */
+class SpriteDrawable {
+    public:
+        explicit SpriteDrawable (size_t transform_idx, const Sprite& sprite) : transform_idx (transform_idx), sprite (sprite) {}
+
+        RenderCommand render_cmd(const Transform& t) const {
+            return RenderCommand{t.value, sprite.size, Vector3D<double>{255, 255, 255}, sprite.atlas, sprite.uv};
+        }
+
+    public:
+        std::size_t transform_idx;
+        Sprite      sprite;
+};
+
+/* Removed along with the Transform of its owner */
+template<>
+struct ComponentPoolTraits<SpriteDrawable, RenderRegistry> {
+    using parent = Transform;
+    static constexpr auto parent_idx = &SpriteDrawable::transform_idx;
+};
+
+#endif
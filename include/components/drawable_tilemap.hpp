@@ -0,0 +1,32 @@
+#ifndef DRAWABLE_TILEMAP_H
+#define DRAWABLE_TILEMAP_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "containers/registry.hpp"
+
+#include "components/transform.hpp"
+
+/*
+ * Draws a TileMap added with World::add_tilemap, its top left corner at the
+ * Transform. It emits one command per visible chunk instead of one per tile,
+ * built by the World rather than through render_cmd.
+ */
+class TileMapDrawable {
+    public:
+        explicit TileMapDrawable (size_t transform_idx, uint32_t map) : transform_idx (transform_idx), map (map) {}
+
+    public:
+        std::size_t transform_idx;
+        uint32_t    map;
+};
+
+/* Removed along with the Transform of its owner */
+template<>
+struct ComponentPoolTraits<TileMapDrawable, RenderRegistry> {
+    using parent = Transform;
+    static constexpr auto parent_idx = &TileMapDrawable::transform_idx;
+};
+
+#endif
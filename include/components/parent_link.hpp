@@ -0,0 +1,32 @@
+#ifndef PARENT_LINK_H
+#define PARENT_LINK_H
+
+#include <cstddef>
+
+#include "containers/component_pool.hpp"
+
+#include "components/transform.hpp"
+
+#include "entity.hpp"
+#include "vector.hpp"
+
+/*
+ * Attaches its owner to another entity. The Transform of the owner is then a
+ * cache of its world position, the parent's plus offset, kept up to date by
+ * the World's hierarchy pass. The offset can be written in place, moving to
+ * another parent is a remove and a new add.
+ */
+struct ParentLink {
+    EntityID            entity;
+    Vector2D<double>    offset;
+    std::size_t         transform_idx;      // Of the owner
+};
+
+/* Removed along with the Transform of its owner */
+template<>
+struct ComponentPoolTraits<ParentLink, void> {
+    using parent = Transform;
+    static constexpr auto parent_idx = &ParentLink::transform_idx;
+};
+
+#endif
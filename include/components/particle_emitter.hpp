@@ -0,0 +1,37 @@
+#ifndef PARTICLE_EMITTER_H
+#define PARTICLE_EMITTER_H
+
+#include <cstddef>
+
+#include "containers/component_pool.hpp"
+
+#include "components/transform.hpp"
+
+#include "particles.hpp"
+
+/*
+ * Spawns particles at the position of its Transform. The particles live on
+ * the render thread, see ParticleSystem, the component only says how they are
+ * spawned. Editing params takes effect from the next frame.
+ */
+class ParticleEmitter {
+    public:
+        explicit ParticleEmitter (size_t transform_idx, const ParticleParams& params) : transform_idx (transform_idx), params (params) {}
+
+    public:
+        std::size_t     transform_idx;
+        ParticleParams  params;
+};
+
+/*
+ * Removed along with the Transform of its owner. Not in the RenderRegistry,
+ * emitters are sent to the renderer on their own and an entity can have one
+ * on top of its drawable.
+ */
+template<>
+struct ComponentPoolTraits<ParticleEmitter, void> {
+    using parent = Transform;
+    static constexpr auto parent_idx = &ParticleEmitter::transform_idx;
+};
+
+#endif
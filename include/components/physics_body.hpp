@@ -2,6 +2,7 @@
 #define PHYSICS_BODY_H
 
 #include <cstddef>
+#include <optional>
 
 #include "containers/typemap.hpp"
 #include "containers/component_pool.hpp"
@@ -16,16 +17,25 @@ struct PhysicsRegistry;
 
 class PhysicsBody {
     public:
-        explicit PhysicsBody(PhysicsCore& physics, EntityID eid, size_t transform_idx)
+        /* What a save keeps of the component, the body itself is saved with the PhysicsCore arrays */
+        struct Persistent {
+            EntityID            eid;
+            std::size_t         transform_idx;
+            Vector2D<double>    speed;
+        };
+
+    public:
+        /* The body is only added to physics once the component enters its pool, see attach() */
+        explicit PhysicsBody(PhysicsCore& physics, EntityID eid, size_t transform_idx,
+                Vector2D<double> pos = {0,0}, Vector2D<double> speed = {0,0}, Vector2D<double> acc = {0,0},
+                Collider collider = {})
             : m_physics (physics)
-            , m_valid (true)
+            , m_valid (false)
             , m_eid (eid)
+            , m_spawn (PhysicsCore::PhysicsData{pos, speed, acc, collider})
             , transform_idx (transform_idx)        
-        {
-            m_physics.add_physics_entity(
-                    eid, transform_idx, Vector2D<double>{0,0}, speed, Vector2D<double>{0,0}
-            );
-        }
+            , speed (speed)
+        {}
 
         ~PhysicsBody() {
             if (m_valid) 
@@ -34,42 +44,77 @@ class PhysicsBody {
 
         PhysicsBody(PhysicsBody&& other) noexcept
             : m_physics (other.m_physics) 
-            , m_valid (true)
+            , m_valid (other.m_valid)
             , m_eid (std::move(other.m_eid))
+            , m_spawn (std::move(other.m_spawn))
             , transform_idx (std::move(other.transform_idx))
             , speed (std::move(other.speed))
         {
             other.m_valid = false;
+            other.m_spawn.reset();
         }
         PhysicsBody& operator=(PhysicsBody&& other) noexcept = delete;
 
+        /* Follows the Transform to its new index, physics is told as well */
+        void follow_transform(std::size_t idx) {
+            transform_idx = idx;
+            m_physics.move_transform(m_eid, idx);
+        }
+
+        /*
+         * Sends the ADD, once. Deferred from the constructor so that a buffered
+         * component only reaches physics after the removals of the same apply,
+         * and a dropped or duplicate one never does
+         */
+        void attach() {
+            if (!m_spawn) return;
+            const auto& d = *m_spawn;
+            m_physics.add_physics_entity(m_eid, transform_idx, d.pos, d.speed, d.acc, d.collider);
+            m_spawn.reset();
+            m_valid = true;
+        }
+
+        Persistent persist() const {
+            return Persistent{m_eid, transform_idx, speed};
+        }
+
+        /* Binds to a body restored into physics along with the component, no ADD is sent */
+        static PhysicsBody restore(PhysicsCore& physics, const Persistent& p) {
+            return PhysicsBody(physics, p);
+        }
+
+    private:
+        PhysicsBody(PhysicsCore& physics, const Persistent& p)
+            : m_physics (physics)
+            , m_valid (true)
+            , m_eid (p.eid)
+            , transform_idx (p.transform_idx)
+            , speed (p.speed)
+        {}
+
     private:
         PhysicsCore&    m_physics;
-        bool        m_valid;
+        bool        m_valid;        // Owns a body in physics
         EntityID    m_eid;
+        std::optional<PhysicsCore::PhysicsData> m_spawn;    // Until attached
 
     public:
         size_t      transform_idx;
         Vector2D<double>    speed{0,0};
 };
 
+/* Removed along with the Transform of its owner */
 template<>
 struct ComponentPoolTraits<PhysicsBody, PhysicsRegistry> {
-    template<typename... Ts>
-    static void init(ComponentPool<PhysicsBody, PhysicsRegistry>& self, TypeMap<Ts...>& pools) {
-        pools.template get<Transform>().subscribe_remove_listener(
-            [&](EntityID owner) {
-                self.remove(owner);
-            }
-        );
-        pools.template get<Transform>().subscribe_swap_listener(
-            [&](EntityID owner, size_t new_idx) {
-                auto idx = self.find(owner);
-                if (idx.has_value()) {
-                    self.entry_at(idx.value()).data.transform_idx = new_idx;
-                }
-            }
-        );
+    using parent = Transform;
+    static constexpr auto parent_idx = &PhysicsBody::transform_idx;
+
+    static void parent_moved(PhysicsBody& body, std::size_t idx) {
+        body.follow_transform(idx);
+    }
+
+    static void added(PhysicsBody& body) {
+        body.attach();
     }
 };
 
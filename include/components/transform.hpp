@@ -9,12 +9,4 @@ struct Transform {
     Vector2D<double> value;
 };
 
-template<>
-struct ComponentPoolTraits<Transform, void> {
-    template<typename... Ts>
-    static void init(ComponentPool<Transform, void>&, TypeMap<Ts...>&) {
-        return;
-    }
-};
-
 #endif
@@ -0,0 +1,363 @@
+#ifndef CONTACT_SOLVER_H
+#define CONTACT_SOLVER_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "vector.hpp"
+#include "worker_pool.hpp"
+
+/* The circle a body collides as, a radius of 0 never collides */
+struct Collider {
+    double  radius{0};
+    double  inv_mass{1};        // 0 is immovable
+    double  restitution{0};     // 0 stops along the contact normal, 1 bounces back at the same speed
+};
+
+/*
+ * Sequential impulse contact solver, run once per physics tick between the
+ * velocity and the position halves of the integration.
+ *
+ * Overlapping circles are found on a uniform grid as wide as the largest one,
+ * and split into islands: bodies linked by a chain of contacts through movable
+ * bodies. Immovable bodies do not join islands, so a floor touched by every
+ * pile does not merge them all. Islands share no movable body and are solved
+ * in parallel, a few small ones per task. An island of more than
+ * LARGE_ISLAND contacts is graph colored instead: contacts of the same color
+ * share no movable body, so each color is solved in parallel and the colors
+ * one after the other.
+ *
+ * Contacts are sorted by body pair and the order they are solved in only
+ * depends on the contacts themselves, never on the number of threads or on
+ * which one picked what, so a tick gives the same result bit for bit anywhere.
+ */
+class ContactSolver {
+    public:
+        static constexpr uint32_t ITERATIONS = 8;
+        static constexpr std::size_t LARGE_ISLAND = 256;    // Contacts
+        static constexpr std::size_t BATCH = 64;            // Contacts per parallel task
+
+        static constexpr double FRICTION = 0.4;
+        static constexpr double SLOP = 0.5;                 // Penetration left alone, keeps resting contacts from jittering
+        static constexpr double BAUMGARTE = 0.2;            // Share of the remaining penetration pushed out each tick
+        static constexpr double BOUNCE_THRESHOLD = 30.0;    // Closing speed under which bodies do not bounce
+
+        /* Replaces the pool of worker threads, one is started with the default size on the first contact otherwise */
+        void set_workers(std::size_t num_workers) {
+            m_workers.emplace(num_workers);
+        }
+
+        /* Of the last solve */
+        std::size_t num_contacts() const {
+            return m_contacts.size();
+        }
+        std::size_t num_islands() const {
+            return m_island_offsets.empty() ? 0 : m_island_offsets.size() - 1;
+        }
+
+        /* Body needs pos, speed and collider, speeds are corrected in place */
+        template<typename Body>
+        void solve(std::span<Body> bodies, double dt) {
+            find_contacts(std::span<const Body>(bodies));
+            build_islands(std::span<const Body>(bodies));
+            if (m_contacts.empty()) return;
+
+            if (!m_workers.has_value()) m_workers.emplace();
+            WorkerPool& pool = *m_workers;
+
+            /* Small islands are grouped into tasks of about BATCH contacts, each island stays on one thread */
+            m_tasks.clear();
+            std::size_t batched = 0;
+            for (std::size_t i = 0; i + 1 < m_island_offsets.size(); ++i) {
+                std::size_t size = m_island_offsets[i + 1] - m_island_offsets[i];
+                if (size > LARGE_ISLAND) continue;
+
+                if (batched == 0) m_tasks.push_back(Range{static_cast<uint32_t>(i), static_cast<uint32_t>(i)});
+                m_tasks.back().end = static_cast<uint32_t>(i + 1);
+                batched += size;
+                if (batched >= BATCH) batched = 0;
+            }
+            pool.parallel_for(m_tasks.size(), [this, bodies, dt](std::size_t t) {
+                for (uint32_t i = m_tasks[t].begin; i < m_tasks[t].end; ++i) {
+                    std::size_t size = m_island_offsets[i + 1] - m_island_offsets[i];
+                    if (size <= LARGE_ISLAND) solve_island(bodies, island(i), dt);
+                }
+            });
+
+            for (std::size_t i = 0; i + 1 < m_island_offsets.size(); ++i) {
+                if (m_island_offsets[i + 1] - m_island_offsets[i] > LARGE_ISLAND) {
+                    solve_colored(bodies, island(i), dt, pool);
+                }
+            }
+        }
+
+    private:
+        struct Contact {
+            uint32_t            a;
+            uint32_t            b;
+            Vector2D<double>    normal;         // From a to b
+            double              penetration;
+
+            double              mass{0};
+            double              bias{0};        // Separating speed the contact aims for
+            double              normal_impulse{0};
+            double              tangent_impulse{0};
+        };
+
+        struct Cell {
+            uint64_t    key;        // Row in the high half, column in the low one
+            uint32_t    body;
+        };
+
+        struct Range {
+            uint32_t    begin;
+            uint32_t    end;
+        };
+
+        static constexpr uint32_t NONE = UINT32_MAX;
+        static constexpr double MAX_CELL = 1u << 30;        // Bodies further out share the last row or column
+        static constexpr std::size_t NUM_COLORS = 64;       // A bit each in m_body_colors, contacts left over are solved alone
+
+        static double dot(const Vector2D<double>& a, const Vector2D<double>& b) noexcept {
+            return a.x * b.x + a.y * b.y;
+        }
+
+        template<typename Body>
+        static bool movable(const Body& body) noexcept {
+            return body.collider.inv_mass != 0;
+        }
+
+        template<typename Body>
+        void find_contacts(std::span<const Body> bodies) {
+            m_contacts.clear();
+            m_cells.clear();
+            double lo_x = INFINITY, lo_y = INFINITY, cell = 0;
+            for (const Body& body : bodies) {
+                if (body.collider.radius <= 0) continue;
+                lo_x = std::min(lo_x, body.pos.x);
+                lo_y = std::min(lo_y, body.pos.y);
+                cell = std::max(cell, 2 * body.collider.radius);
+            }
+            if (cell == 0) return;
+
+            /* Cells as wide as the largest circle, so only the neighbouring cells can hold an overlap */
+            for (uint32_t i = 0; i < bodies.size(); ++i) {
+                if (bodies[i].collider.radius <= 0) continue;
+                uint64_t x = static_cast<uint64_t>(std::min((bodies[i].pos.x - lo_x) / cell, MAX_CELL));
+                uint64_t y = static_cast<uint64_t>(std::min((bodies[i].pos.y - lo_y) / cell, MAX_CELL));
+                m_cells.push_back(Cell{(y << 32) | x, i});
+            }
+            std::sort(m_cells.begin(), m_cells.end(), [](const Cell& a, const Cell& b) {
+                return (a.key != b.key) ? a.key < b.key : a.body < b.body;
+            });
+
+            auto overlap = [this, bodies](uint32_t i, uint32_t j) {
+                uint32_t a = std::min(i, j), b = std::max(i, j);
+                if (!movable(bodies[a]) && !movable(bodies[b])) return;
+
+                Vector2D<double> d = bodies[b].pos - bodies[a].pos;
+                double r = bodies[a].collider.radius + bodies[b].collider.radius;
+                double dist2 = dot(d, d);
+                if (dist2 >= r * r) return;
+
+                double dist = std::sqrt(dist2);
+                /* Bodies right on top of each other are pushed apart along x */
+                Vector2D<double> normal = (dist > 0) ? d * (1.0 / dist) : Vector2D<double>{1, 0};
+                m_contacts.push_back(Contact{a, b, normal, r - dist});
+            };
+
+            /* Each pair of cells once: the rest of the own cell, then the one to the right and three below */
+            for (std::size_t i = 0; i < m_cells.size(); ++i) {
+                uint64_t key = m_cells[i].key;
+                for (std::size_t j = i + 1; j < m_cells.size() && m_cells[j].key == key; ++j) overlap(m_cells[i].body, m_cells[j].body);
+
+                uint64_t below = key + (uint64_t{1} << 32);
+                uint64_t neighbours[4] = {key + 1, below - 1, below, below + 1};
+                for (std::size_t n = 0; n < 4; ++n) {
+                    if (n == 1 && (key & UINT32_MAX) == 0) continue;     // No column to the left
+                    auto it = std::lower_bound(m_cells.begin() + i, m_cells.end(), neighbours[n], [](const Cell& c, uint64_t k) {
+                        return c.key < k;
+                    });
+                    for (; it != m_cells.end() && it->key == neighbours[n]; ++it) overlap(m_cells[i].body, it->body);
+                }
+            }
+
+            std::sort(m_contacts.begin(), m_contacts.end(), [](const Contact& x, const Contact& y) {
+                return (x.a != y.a) ? x.a < y.a : x.b < y.b;
+            });
+        }
+
+        uint32_t find_root(uint32_t i) {
+            while (m_parent[i] != i) {
+                m_parent[i] = m_parent[m_parent[i]];
+                i = m_parent[i];
+            }
+            return i;
+        }
+
+        /* Contact indexes grouped by island in m_island_contacts, islands numbered in order of their first contact */
+        template<typename Body>
+        void build_islands(std::span<const Body> bodies) {
+            m_island_offsets.clear();
+            m_island_contacts.clear();
+            if (m_contacts.empty()) return;
+
+            m_parent.resize(bodies.size());
+            std::iota(m_parent.begin(), m_parent.end(), 0u);
+            for (const Contact& c : m_contacts) {
+                if (!movable(bodies[c.a]) || !movable(bodies[c.b])) continue;
+
+                uint32_t ra = find_root(c.a), rb = find_root(c.b);
+                if (ra != rb) m_parent[std::max(ra, rb)] = std::min(ra, rb);
+            }
+
+            m_island_of.assign(bodies.size(), NONE);
+            m_contact_island.resize(m_contacts.size());
+            uint32_t num_islands = 0;
+            for (std::size_t i = 0; i < m_contacts.size(); ++i) {
+                const Contact& c = m_contacts[i];
+                uint32_t root = find_root(movable(bodies[c.a]) ? c.a : c.b);
+                if (m_island_of[root] == NONE) m_island_of[root] = num_islands++;
+                m_contact_island[i] = m_island_of[root];
+            }
+
+            /* Counting sort, contacts keep their order within an island */
+            m_island_offsets.assign(num_islands + 1, 0);
+            for (uint32_t island : m_contact_island) ++m_island_offsets[island + 1];
+            for (uint32_t i = 0; i < num_islands; ++i) m_island_offsets[i + 1] += m_island_offsets[i];
+
+            m_island_contacts.resize(m_contacts.size());
+            m_fill.assign(m_island_offsets.begin(), m_island_offsets.end() - 1);
+            for (uint32_t i = 0; i < m_contacts.size(); ++i) {
+                m_island_contacts[m_fill[m_contact_island[i]]++] = i;
+            }
+        }
+
+        std::span<const uint32_t> island(std::size_t i) const {
+            return std::span<const uint32_t>(m_island_contacts).subspan(m_island_offsets[i], m_island_offsets[i + 1] - m_island_offsets[i]);
+        }
+
+        template<typename Body>
+        void prepare(std::span<const Body> bodies, Contact& c, double dt) const {
+            const Body& a = bodies[c.a];
+            const Body& b = bodies[c.b];
+            c.mass = 1.0 / (a.collider.inv_mass + b.collider.inv_mass);
+
+            double closing = dot(b.speed - a.speed, c.normal);
+            double restitution = std::max(a.collider.restitution, b.collider.restitution);
+            double bounce = (closing < -BOUNCE_THRESHOLD) ? -restitution * closing : 0;
+            double push = BAUMGARTE / dt * std::max(c.penetration - SLOP, 0.0);
+            c.bias = std::max(bounce, push);
+            c.normal_impulse = 0;
+            c.tangent_impulse = 0;
+        }
+
+        /* Immovable bodies are only read, they can be shared by contacts solved at the same time */
+        template<typename Body>
+        static void apply_impulse(Body& a, Body& b, const Vector2D<double>& impulse) noexcept {
+            if (movable(a)) a.speed -= impulse * a.collider.inv_mass;
+            if (movable(b)) b.speed += impulse * b.collider.inv_mass;
+        }
+
+        template<typename Body>
+        static void apply(std::span<Body> bodies, Contact& c) noexcept {
+            Body& a = bodies[c.a];
+            Body& b = bodies[c.b];
+
+            /* Accumulated impulses are clamped rather than each one, so an iteration can take back what an earlier one overdid */
+            double closing = dot(b.speed - a.speed, c.normal);
+            double normal_impulse = std::max(c.normal_impulse + c.mass * (c.bias - closing), 0.0);
+            apply_impulse(a, b, c.normal * (normal_impulse - c.normal_impulse));
+            c.normal_impulse = normal_impulse;
+
+            Vector2D<double> tangent{-c.normal.y, c.normal.x};
+            double sliding = dot(b.speed - a.speed, tangent);
+            double max_friction = FRICTION * c.normal_impulse;
+            double tangent_impulse = std::clamp(c.tangent_impulse - c.mass * sliding, -max_friction, max_friction);
+            apply_impulse(a, b, tangent * (tangent_impulse - c.tangent_impulse));
+            c.tangent_impulse = tangent_impulse;
+        }
+
+        template<typename Body>
+        void solve_island(std::span<Body> bodies, std::span<const uint32_t> contacts, double dt) {
+            for (uint32_t c : contacts) prepare(std::span<const Body>(bodies), m_contacts[c], dt);
+            for (uint32_t it = 0; it < ITERATIONS; ++it) {
+                for (uint32_t c : contacts) apply(bodies, m_contacts[c]);
+            }
+        }
+
+        /*
+         * Greedy coloring in contact order, each contact takes the lowest color
+         * none of the other contacts of its movable bodies has. Contacts that
+         * find all NUM_COLORS taken are solved alone after the colors.
+         */
+        template<typename Body>
+        void solve_colored(std::span<Body> bodies, std::span<const uint32_t> contacts, double dt, WorkerPool& pool) {
+            m_body_colors.resize(bodies.size(), 0);
+            for (auto& color : m_colors) color.clear();
+            m_leftover.clear();
+
+            for (uint32_t c : contacts) {
+                const Contact& contact = m_contacts[c];
+                bool move_a = movable(bodies[contact.a]);
+                bool move_b = movable(bodies[contact.b]);
+                uint64_t taken = (move_a ? m_body_colors[contact.a] : 0) | (move_b ? m_body_colors[contact.b] : 0);
+                if (taken == UINT64_MAX) {
+                    m_leftover.push_back(c);
+                    continue;
+                }
+
+                int color = std::countr_one(taken);
+                m_colors[color].push_back(c);
+                if (move_a) m_body_colors[contact.a] |= uint64_t{1} << color;
+                if (move_b) m_body_colors[contact.b] |= uint64_t{1} << color;
+            }
+            for (uint32_t c : contacts) {
+                m_body_colors[m_contacts[c].a] = 0;
+                m_body_colors[m_contacts[c].b] = 0;
+            }
+
+            pool.parallel_for((contacts.size() + BATCH - 1) / BATCH, [this, bodies, contacts, dt](std::size_t t) {
+                std::size_t end = std::min(contacts.size(), (t + 1) * BATCH);
+                for (std::size_t i = t * BATCH; i < end; ++i) prepare(std::span<const Body>(bodies), m_contacts[contacts[i]], dt);
+            });
+
+            for (uint32_t it = 0; it < ITERATIONS; ++it) {
+                for (const auto& color : m_colors) {
+                    pool.parallel_for((color.size() + BATCH - 1) / BATCH, [this, bodies, &color](std::size_t t) {
+                        std::size_t end = std::min(color.size(), (t + 1) * BATCH);
+                        for (std::size_t i = t * BATCH; i < end; ++i) apply(bodies, m_contacts[color[i]]);
+                    });
+                }
+                for (uint32_t c : m_leftover) apply(bodies, m_contacts[c]);
+            }
+        }
+
+    private:
+        std::optional<WorkerPool>   m_workers;
+
+        std::vector<Cell>       m_cells;            // Colliding bodies by cell
+        std::vector<Contact>    m_contacts;         // By body pair
+
+        std::vector<uint32_t>   m_parent;           // Union find over the bodies
+        std::vector<uint32_t>   m_island_of;        // By root body
+        std::vector<uint32_t>   m_contact_island;
+        std::vector<uint32_t>   m_island_offsets;   // Into m_island_contacts, one past the last island at the end
+        std::vector<uint32_t>   m_island_contacts;
+        std::vector<uint32_t>   m_fill;
+        std::vector<Range>      m_tasks;            // Of small islands
+
+        std::vector<uint64_t>   m_body_colors;      // Colors taken by the contacts of each body, all 0 between islands
+        std::array<std::vector<uint32_t>, NUM_COLORS>   m_colors;
+        std::vector<uint32_t>   m_leftover;
+};
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef ARCHETYPE_H
+#define ARCHETYPE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <assert.h>
+
+#include "containers/chunked_vector.hpp"
+
+#include "entity.hpp"
+
+/*
+ * Alternative to one ComponentPool per type: entities with the same set of
+ * components (an archetype) share a table, with one column per component and
+ * one row per entity. A query over several components is a linear walk of the
+ * tables that have all of them, with every column read in step, instead of an
+ * index lookup into another pool per entity. The cost moves to structural
+ * changes: adding or removing a component moves the whole entity to the table
+ * of its new set.
+ *
+ * Columns are ChunkedVectors with the same number of rows per block, so the
+ * columns of a table are walked one block of spans at a time.
+ */
+template<typename... Ts>
+class ArchetypeStorage {
+    static_assert(sizeof... (Ts) <= 64, "An archetype is a 64 bit mask of component types");
+
+    public:
+        using Mask = uint64_t;
+
+        static constexpr std::size_t ROWS_PER_CHUNK = 256;
+
+        template<typename T>
+        static constexpr Mask bit() {
+            constexpr bool matches[] = {std::is_same_v<T, Ts>...};
+            std::size_t idx = 0;
+            while (idx < sizeof... (Ts) && !matches[idx]) ++idx;
+            static_assert(((std::is_same_v<T, Ts> ? 1 : 0) + ...) == 1, "Type not found in ArchetypeStorage");
+            return Mask{1} << idx;
+        }
+
+    public:
+        template<typename T>
+        void add_component(EntityID owner, T comp) {
+            Location loc = location(owner);
+            if (loc.table == NONE) {
+                Table& dst = table_for(bit<T>());
+                place(owner, dst, dst.owners.size());
+                dst.owners.emplace_back(owner);
+                dst.template column<T>().emplace_back(std::move(comp));
+                return;
+            }
+
+            assert(!(m_tables[loc.table]->mask & bit<T>()) && "Entity already has a component of this type");
+            Table& dst = move_entity(owner, loc, m_tables[loc.table]->mask | bit<T>());
+            dst.template column<T>().emplace_back(std::move(comp));
+        }
+
+        template<typename T>
+        bool remove_component(EntityID owner) {
+            Location loc = location(owner);
+            if (loc.table == NONE || !(m_tables[loc.table]->mask & bit<T>())) return false;
+
+            Mask mask = m_tables[loc.table]->mask & ~bit<T>();
+            if (mask == 0) {
+                destroy(owner);
+            } else {
+                move_entity(owner, loc, mask);
+            }
+            return true;
+        }
+
+        /* Removes every component of owner */
+        void destroy(EntityID owner) {
+            Location loc = location(owner);
+            if (loc.table == NONE) return;
+
+            swap_remove(*m_tables[loc.table], loc.row);
+            m_locations[owner] = Location{};
+        }
+
+        /* Valid until the next structural change, rows move */
+        template<typename T>
+        T* get_component(EntityID owner) {
+            Location loc = location(owner);
+            if (loc.table == NONE || !(m_tables[loc.table]->mask & bit<T>())) return nullptr;
+            return &m_tables[loc.table]->template column<T>()[loc.row];
+        }
+
+        template<typename T>
+        bool has_component(EntityID owner) const {
+            Location loc = location(owner);
+            return loc.table != NONE && (m_tables[loc.table]->mask & bit<T>());
+        }
+
+        /* fn(owner, Qs&...) for every entity that has all of Qs, table by table */
+        template<typename... Qs, typename F>
+        void query(F&& fn) {
+            constexpr Mask required = (bit<Qs>() | ...);
+            for (auto& table : m_tables) {
+                if ((table->mask & required) != required) continue;
+
+                for (std::size_t c = 0; c < table->owners.num_chunks(); ++c) {
+                    auto owners = table->owners.chunk(c);
+                    auto columns = std::make_tuple(table->template column<Qs>().chunk(c)...);
+                    for (std::size_t i = 0; i < owners.size(); ++i) {
+                        std::apply([&](auto&... spans) { fn(owners[i], spans[i]...); }, columns);
+                    }
+                }
+            }
+        }
+
+        /* Entities stored, whatever their components */
+        std::size_t size() const {
+            std::size_t count = 0;
+            for (const auto& table : m_tables) count += table->owners.size();
+            return count;
+        }
+
+        std::size_t num_archetypes() const {
+            return m_tables.size();
+        }
+
+    private:
+        static constexpr uint32_t NONE = UINT32_MAX;
+
+        struct Location {
+            uint32_t    table{NONE};
+            uint32_t    row{0};
+        };
+
+        struct Table {
+            Mask        mask{0};
+            uint32_t    index{0};       // In m_tables
+            ChunkedVector<EntityID, ROWS_PER_CHUNK>             owners;
+            std::tuple<ChunkedVector<Ts, ROWS_PER_CHUNK>...>    columns;    // Only the ones in mask hold rows
+
+            template<typename T>
+            ChunkedVector<T, ROWS_PER_CHUNK>& column() {
+                return std::get<ChunkedVector<T, ROWS_PER_CHUNK>>(columns);
+            }
+
+            /* fn(column) for each column whose type is in which */
+            template<typename F>
+            void for_each_column(Mask which, F&& fn) {
+                ((which & bit<Ts>() ? fn(column<Ts>()) : void()), ...);
+            }
+        };
+
+        Location location(EntityID owner) const {
+            return owner < m_locations.size() ? m_locations[owner] : Location{};
+        }
+
+        void place(EntityID owner, Table& table, std::size_t row) {
+            while (m_locations.size() <= owner) m_locations.emplace_back();
+            m_locations[owner] = Location{table.index, static_cast<uint32_t>(row)};
+        }
+
+        Table& table_for(Mask mask) {
+            auto it = m_by_mask.find(mask);
+            if (it != m_by_mask.end()) return *m_tables[it->second];
+
+            auto table = std::make_unique<Table>();
+            table->mask = mask;
+            table->index = static_cast<uint32_t>(m_tables.size());
+            m_by_mask.emplace(mask, table->index);
+            m_tables.push_back(std::move(table));
+            return *m_tables.back();
+        }
+
+        /* Appends the row of owner to the table of mask with the components both sets share, then drops the old row */
+        Table& move_entity(EntityID owner, Location loc, Mask mask) {
+            Table& src = *m_tables[loc.table];
+            Table& dst = table_for(mask);
+
+            place(owner, dst, dst.owners.size());
+            dst.owners.emplace_back(owner);
+            src.for_each_column(src.mask & mask, [&dst, &loc]<typename T>(ChunkedVector<T, ROWS_PER_CHUNK>& col) {
+                dst.template column<T>().emplace_back(std::move(col[loc.row]));
+            });
+
+            swap_remove(src, loc.row);
+            return dst;
+        }
+
+        /* The last row fills the hole, like a pool's swap-remove */
+        void swap_remove(Table& table, std::size_t row) {
+            std::size_t last = table.owners.size() - 1;
+            table.for_each_column(table.mask, [row, last]<typename T>(ChunkedVector<T, ROWS_PER_CHUNK>& col) {
+                if (row != last) {
+                    std::destroy_at(&col[row]);
+                    new (&col[row]) T(std::move(col[last]));
+                }
+                col.pop_back();
+            });
+
+            if (row != last) {
+                EntityID moved = table.owners[last];
+                table.owners[row] = moved;
+                m_locations[moved].row = static_cast<uint32_t>(row);
+            }
+            table.owners.pop_back();
+        }
+
+    private:
+        std::vector<std::unique_ptr<Table>>         m_tables;
+        std::unordered_map<Mask, uint32_t>          m_by_mask;
+        ChunkedVector<Location, 4096>               m_locations;    // Indexed by EntityID, ids are dense
+};
+
+#endif
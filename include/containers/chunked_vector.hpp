@@ -0,0 +1,194 @@
+#ifndef CHUNKED_VECTOR_H
+#define CHUNKED_VECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <assert.h>
+
+/*
+ * Dense array stored in fixed size blocks of N elements, each aligned on a
+ * cache line. Growing only allocates a new block, elements already there never
+ * move, and a block emptied by shrinking is kept for reuse instead of freed.
+ * Indexing is a shift and a mask, iteration goes block by block.
+ */
+template<typename T, std::size_t N>
+class ChunkedVector {
+    static_assert((N & (N - 1)) == 0, "ChunkedVector block size must be a power of two");
+
+    public:
+        static constexpr std::size_t CHUNK_SIZE = N;
+        static constexpr std::size_t ALIGNMENT = std::max<std::size_t>(64, alignof(T));
+
+        template<typename V>
+        class Iterator {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = std::remove_const_t<V>;
+                using difference_type = std::ptrdiff_t;
+                using pointer = V*;
+                using reference = V&;
+
+                Iterator() = default;
+                Iterator(T* const* chunks, std::size_t idx) : m_chunks (chunks), m_idx (idx) {}
+
+                reference operator*() const {
+                    return m_chunks[m_idx / N][m_idx % N];
+                }
+                pointer operator->() const {
+                    return &**this;
+                }
+                Iterator& operator++() {
+                    ++m_idx;
+                    return *this;
+                }
+                Iterator operator++(int) {
+                    Iterator it = *this;
+                    ++m_idx;
+                    return it;
+                }
+                bool operator==(const Iterator& o) const {
+                    return m_idx == o.m_idx;
+                }
+
+            private:
+                T* const*   m_chunks{nullptr};
+                std::size_t m_idx{0};
+        };
+
+        using iterator = Iterator<T>;
+        using const_iterator = Iterator<const T>;
+
+    public:
+        ChunkedVector() = default;
+        ~ChunkedVector() {
+            clear();
+            for (T* chunk : m_chunks) ::operator delete(chunk, std::align_val_t{ALIGNMENT});
+        }
+
+        ChunkedVector(ChunkedVector&& o) noexcept
+            : m_chunks (std::move(o.m_chunks)), m_size (std::exchange(o.m_size, 0)) {}
+        ChunkedVector& operator=(ChunkedVector&& o) noexcept {
+            std::swap(m_chunks, o.m_chunks);
+            std::swap(m_size, o.m_size);
+            return *this;
+        }
+
+        ChunkedVector(const ChunkedVector&) = delete;
+        ChunkedVector& operator=(const ChunkedVector&) = delete;
+
+        std::size_t size() const {
+            return m_size;
+        }
+        bool empty() const {
+            return m_size == 0;
+        }
+
+        T& operator[](std::size_t idx) {
+            return m_chunks[idx / N][idx % N];
+        }
+        const T& operator[](std::size_t idx) const {
+            return m_chunks[idx / N][idx % N];
+        }
+
+        T& back() {
+            return (*this)[m_size - 1];
+        }
+
+        /* Allocates blocks up front, nothing already stored moves */
+        void reserve(std::size_t count) {
+            while (m_chunks.size() * N < count) {
+                m_chunks.push_back(static_cast<T*>(::operator new(N * sizeof(T), std::align_val_t{ALIGNMENT})));
+            }
+        }
+
+        template<typename... Args>
+        T& emplace_back(Args&&... args) {
+            reserve(m_size + 1);
+            T* slot = &m_chunks[m_size / N][m_size % N];
+            new (slot) T(std::forward<Args>(args)...);
+            ++m_size;
+            return *slot;
+        }
+
+        void pop_back() {
+            assert(m_size > 0);
+            --m_size;
+            std::destroy_at(&(*this)[m_size]);
+        }
+
+        void clear() {
+            for (std::size_t i = 0; i < num_chunks(); ++i) {
+                auto c = chunk(i);
+                std::destroy(c.begin(), c.end());
+            }
+            m_size = 0;
+        }
+
+        /* Replaces the contents with count copies of value */
+        void assign(std::size_t count, const T& value) {
+            clear();
+            reserve(count);
+            for (std::size_t i = 0; i * N < count; ++i) {
+                std::uninitialized_fill_n(m_chunks[i], std::min(N, count - i * N), value);
+            }
+            m_size = count;
+        }
+
+        /* Replaces the contents with a copy of [first, last), block by block */
+        void assign(const T* first, const T* last) {
+            clear();
+            std::size_t count = static_cast<std::size_t>(last - first);
+            reserve(count);
+            for (std::size_t i = 0; i * N < count; ++i) {
+                std::size_t len = std::min(N, count - i * N);
+                std::uninitialized_copy(first + i * N, first + i * N + len, m_chunks[i]);
+            }
+            m_size = count;
+        }
+
+        /* Blocks holding at least one element, the last one may be partial */
+        std::size_t num_chunks() const {
+            return (m_size + N - 1) / N;
+        }
+        std::span<T> chunk(std::size_t i) {
+            return {m_chunks[i], std::min(N, m_size - i * N)};
+        }
+        std::span<const T> chunk(std::size_t i) const {
+            return {m_chunks[i], std::min(N, m_size - i * N)};
+        }
+
+        /* Every block in order, for writers that gather rather than copy */
+        std::vector<std::span<const T>> chunks() const {
+            std::vector<std::span<const T>> out;
+            out.reserve(num_chunks());
+            for (std::size_t i = 0; i < num_chunks(); ++i) out.push_back(chunk(i));
+            return out;
+        }
+
+        iterator begin() {
+            return iterator(m_chunks.data(), 0);
+        }
+        iterator end() {
+            return iterator(m_chunks.data(), m_size);
+        }
+        const_iterator begin() const {
+            return const_iterator(m_chunks.data(), 0);
+        }
+        const_iterator end() const {
+            return const_iterator(m_chunks.data(), m_size);
+        }
+
+    private:
+        std::vector<T*> m_chunks;       // Allocated blocks, only the first num_chunks() hold elements
+        std::size_t     m_size{0};
+};
+
+#endif
@@ -1,17 +1,21 @@
 #ifndef COMPONENT_POOL_H
 #define COMPONENT_POOL_H
 
+#include <algorithm>
+#include <bit>
 #include <cstddef>
+#include <cstdint>
 #include <type_traits>
 #include <variant>
 #include <vector>
-#include <unordered_map>
 #include <cstddef>
-#include <functional>
 #include <optional>
+#include <span>
 
 #include <assert.h>
 
+#include "containers/chunked_vector.hpp"
+#include "containers/sparse_index.hpp"
 #include "containers/typemap.hpp"
 
 #include "entity.hpp"
@@ -22,38 +26,61 @@ struct ComponentEntry {
     T           data;
 
     ComponentEntry(EntityID eid, const T& d) : owner (eid), data (d) {}
+    ComponentEntry(EntityID eid, T&& d) : owner (eid), data (std::move(d)) {}
 
-    ComponentEntry(ComponentEntry&& other) noexcept 
-        : owner (std::move(other.owner))
-        , data (std::move(other.data))
-    {}
-
-    ComponentEntry& operator=(ComponentEntry&& other) noexcept {
-        if (this != &other ) {
-            owner = other.owner;
-            data = std::move(other.data);
-        }
-        return *this;
-    }
+    /* Defaulted so an entry of a trivially copyable T is itself trivially copyable, and can be bulk copied */
+    ComponentEntry(const ComponentEntry&) = default;
+    ComponentEntry(ComponentEntry&&) noexcept = default;
+    ComponentEntry& operator=(const ComponentEntry&) = default;
+    ComponentEntry& operator=(ComponentEntry&&) noexcept = default;
 };
 
 template<typename T, typename R>
 class ComponentPool;
 
+/*
+ * Relations between pools, declared at compile time. A pool whose traits name
+ * a parent component type is a child of that pool: its component is removed
+ * along with the parent component of the same owner, and its parent_idx
+ * member follows the parent entry when a removal moves it, through an
+ * optional parent_moved(comp, idx) hook. See remove_cascade. An optional
+ * added(comp) hook runs when a component enters its pool.
+ */
 template<typename T, typename R>
 struct ComponentPoolTraits {
-    template<typename... Ts>
-    static void init(ComponentPool<T, R>&, TypeMap<Ts...>&);
+    using parent = void;
 };
 
 template<typename T, typename R = void>
 class ComponentPool {
     public:
         using value_type = T;
-        using iterator = typename std::vector<ComponentEntry<T>>::iterator;
-
-        using RemoveNotifyFn = std::function<void(EntityID owner)>;
-        using SwapNotifyFn = std::function<void(EntityID owner, size_t new_idx)>;
+        using registry_type = R;
+        using traits = ComponentPoolTraits<T, R>;
+
+        /* Granularity of the dirty tracking used by checkpoints, about one memory page of entries */
+        static constexpr std::size_t PAGE_ENTRIES = std::bit_floor(std::max<std::size_t>(1, 4096 / sizeof(ComponentEntry<T>)));
+
+        /* One storage block per dirty page, a growing pool never moves the entries it has */
+        using Storage = ChunkedVector<ComponentEntry<T>, PAGE_ENTRIES>;
+        using iterator = typename Storage::iterator;
+
+        /* What a swap-remove did, moved is the owner of the last entry if it was moved into the freed slot */
+        struct Removal {
+            bool        removed{false};
+            EntityID    moved{INVALID_ENTITY};
+            std::size_t moved_to{0};
+        };
+
+        /*
+         * Every entry carries the change tick it was added at and the one it was
+         * last written at, so readers can skip what did not change since they
+         * last ran. Writes are stamped with the pool's current change tick, which
+         * the owner advances. Ticks are compared with wraparound.
+         */
+        static bool newer(uint32_t tick, uint32_t since) {
+            return static_cast<int32_t>(tick - since) > 0;
+        }
 
     public:
         ComponentPool() {
@@ -66,7 +93,6 @@ class ComponentPool {
 
         template<typename... Ts>
         void init(TypeMap<Ts...>& pools) {
-            ComponentPoolTraits<T, R>::init(*this, pools);
             m_pool_id = pools.template find<ComponentPool<T, R>>();
         }
 
@@ -75,10 +101,7 @@ class ComponentPool {
         }
 
         std::optional<std::size_t> find(EntityID owner) {
-            auto it = m_lookup.find(owner);
-            if (it == m_lookup.end()) return std::nullopt;
-
-            return it->second;
+            return m_lookup.find(owner);
         }
 
         const ComponentEntry<T>& entry_at(size_t idx) const {
@@ -87,39 +110,80 @@ class ComponentPool {
         }
         ComponentEntry<T>& entry_at(size_t idx) {
             assert(idx < m_data.size());
+            mark_dirty(idx);
+            m_changed_ticks[idx] = m_change_tick;
             return m_data[idx];
         }
 
         size_t add(EntityID owner, const T& data) {
-            size_t idx = m_data.size();
+            size_t idx = register_entry(owner);
+            m_data.emplace_back(ComponentEntry<T>(owner, data));
+            mark_added(idx);
+            if constexpr (requires { traits::added(m_data.back().data); }) traits::added(m_data.back().data);
+            return idx;
+        }
+        size_t add(EntityID owner, T&& data) {
+            size_t idx = register_entry(owner);
+            m_data.emplace_back(ComponentEntry<T>(owner, std::move(data)));
+            mark_added(idx);
+            if constexpr (requires { traits::added(m_data.back().data); }) traits::added(m_data.back().data);
+            return idx;
+        }
 
-            if constexpr (!std::is_same_v<R, void>) {
-                assert(m_reg->data.find(owner) == std::nullopt && "Registry already has an entry for this component type");
-                m_reg->data.add(owner, {owner, m_pool_id, idx});
+        uint32_t change_tick() const {
+            return m_change_tick;
+        }
+        void set_change_tick(uint32_t tick) {
+            m_change_tick = tick;
+        }
+
+        bool added_since(std::size_t idx, uint32_t since) const {
+            return newer(m_added_ticks[idx], since);
+        }
+        /* Added counts as changed, and so does a slot another entry was moved into */
+        bool changed_since(std::size_t idx, uint32_t since) const {
+            return newer(m_changed_ticks[idx], since);
+        }
+
+        /* fn(idx, entry) for the entries added after tick since */
+        template<typename F>
+        void for_each_added(uint32_t since, F&& fn) const {
+            for (std::size_t i = 0; i < m_data.size(); ++i) {
+                if (newer(m_added_ticks[i], since)) fn(i, m_data[i]);
             }
+        }
 
-            m_data.emplace_back(ComponentEntry<T>(owner, data));
-            m_lookup.emplace(owner, idx);
-            return idx;
+        /* fn(idx, entry) for the entries written after tick since */
+        template<typename F>
+        void for_each_changed(uint32_t since, F&& fn) const {
+            for (std::size_t i = 0; i < m_data.size(); ++i) {
+                if (newer(m_changed_ticks[i], since)) fn(i, m_data[i]);
+            }
         }
 
-        bool remove(EntityID eid) {
-            auto it = m_lookup.find(eid);
-            if (it == m_lookup.end()) return false;
-            size_t idx = it->second;
+        /* Only this pool and its registry, the child pools are left to remove_cascade */
+        Removal remove(EntityID eid) {
+            auto found = m_lookup.find(eid);
+            if (!found.has_value()) return Removal{};
+
+            Removal removal{true};
+            size_t idx = found.value();
             size_t last_idx = m_data.size() - 1;
             if (idx != last_idx) {
                 m_data[idx].~ComponentEntry<T>();
                 new (&m_data[idx]) ComponentEntry<T>(std::move(m_data[last_idx]));
-                m_lookup[m_data[idx].owner] = idx;
-                
-                for (auto& fn : m_swap_listeners) {
-                    fn(m_data[idx].owner, idx);
+                m_lookup.set(m_data[idx].owner, idx);
+                mark_dirty(idx);
+                m_added_ticks[idx] = m_added_ticks[last_idx];
+                m_changed_ticks[idx] = m_change_tick;
+
+                if constexpr (!std::is_void_v<R>) {
+                    auto handle = m_reg->data.find(m_data[idx].owner);
+                    if (handle.has_value()) m_reg->data.entry_at(handle.value()).data.comp_idx = idx;
                 }
-            }
 
-            for (auto& fn : m_remove_listeners) {
-                fn(eid);
+                removal.moved = m_data[idx].owner;
+                removal.moved_to = idx;
             }
 
             if constexpr (!std::is_void_v<R>) {
@@ -127,39 +191,227 @@ class ComponentPool {
             }
 
             m_data.pop_back();
-            m_lookup.erase(it);
+            m_added_ticks.pop_back();
+            m_changed_ticks.pop_back();
+            m_lookup.erase(eid);
 
-            return true;
+            return removal;
         }
 
         size_t size() const {
             return m_data.size();
         }
 
-        void subscribe_swap_listener(SwapNotifyFn fn) {
-            m_swap_listeners.push_back(std::move(fn));
+        /* Dense but not contiguous, indexed or walked block by block */
+        const Storage& entries() const {
+            return m_data;
         }
-        void subscribe_remove_listener(RemoveNotifyFn fn) {
-            m_remove_listeners.push_back(std::move(fn));
+
+        /*
+         * Replaces the whole pool with a bulk copy of entries. The registry is
+         * restored on its own and is not touched, nor are the listeners called.
+         */
+        void load(const ComponentEntry<T>* entries, std::size_t count) {
+            static_assert(std::is_trivially_copyable_v<ComponentEntry<T>>,
+                    "Only trivially copyable components can be bulk loaded");
+            m_data.assign(entries, entries + count);
+            rebuild_lookup();
+            mark_all_dirty();
+            mark_all_added();
+        }
+
+        /* Same as above for components that have to be rebuilt, make(i) returns the i-th entry */
+        template<typename F>
+        void load(std::size_t count, F&& make) {
+            m_data.clear();
+            m_data.reserve(count);
+            for (std::size_t i = 0; i < count; ++i) {
+                m_data.emplace_back(make(i));
+            }
+            rebuild_lookup();
+            mark_all_dirty();
+            mark_all_added();
+        }
+
+        /*
+         * Calls fn(first, count) for every run of entries written since the last
+         * call, at PAGE_ENTRIES granularity, and forgets them. Entries past the
+         * end, from pages that shrank away, are not reported.
+         */
+        template<typename F>
+        void take_dirty_pages(F&& fn) {
+            for (std::size_t word = 0; word < m_dirty.size(); ++word) {
+                uint64_t bits = m_dirty[word];
+                m_dirty[word] = 0;
+                while (bits != 0) {
+                    std::size_t page = word * 64 + static_cast<std::size_t>(std::countr_zero(bits));
+                    bits &= bits - 1;
+
+                    std::size_t first = page * PAGE_ENTRIES;
+                    if (first >= m_data.size()) continue;
+                    fn(first, std::min(PAGE_ENTRIES, m_data.size() - first));
+                }
+            }
         }
 
+        void mark_all_dirty() {
+            std::size_t pages = (m_data.size() + PAGE_ENTRIES - 1) / PAGE_ENTRIES;
+            m_dirty.assign((pages + 63) / 64, ~uint64_t{0});
+        }
+
+        /* Mutable iteration may write anywhere */
         iterator begin() {
+            mark_all_dirty();
+            std::fill(m_changed_ticks.begin(), m_changed_ticks.end(), m_change_tick);
             return m_data.begin();
         }
         iterator end() {
             return m_data.end();
         }
 
+    private:
+        size_t register_entry(EntityID owner) {
+            size_t idx = m_data.size();
+
+            if constexpr (!std::is_same_v<R, void>) {
+                assert(m_reg->data.find(owner) == std::nullopt && "Registry already has an entry for this component type");
+                m_reg->data.add(owner, {owner, m_pool_id, idx});
+            }
+
+            m_lookup.set(owner, idx);
+            return idx;
+        }
+
+        void mark_dirty(std::size_t idx) {
+            std::size_t page = idx / PAGE_ENTRIES;
+            if (page / 64 >= m_dirty.size()) m_dirty.resize(page / 64 + 1, 0);
+            m_dirty[page / 64] |= uint64_t{1} << (page % 64);
+        }
+
+        void mark_added(std::size_t idx) {
+            mark_dirty(idx);
+            m_added_ticks.emplace_back(m_change_tick);
+            m_changed_ticks.emplace_back(m_change_tick);
+        }
+
+        /* A loaded pool is new to every reader */
+        void mark_all_added() {
+            m_added_ticks.assign(m_data.size(), m_change_tick);
+            m_changed_ticks.assign(m_data.size(), m_change_tick);
+        }
+
+        void rebuild_lookup() {
+            m_lookup.clear();
+            for (std::size_t i = 0; i < m_data.size(); ++i) {
+                m_lookup.set(m_data[i].owner, i);
+            }
+        }
+
     private:
         uint8_t m_pool_id{0};
 
-        std::vector<ComponentEntry<T>>  m_data;
-        std::unordered_map<EntityID, std::size_t> m_lookup;
+        Storage                 m_data;
+        SparseIndex             m_lookup;
+        std::vector<uint64_t>   m_dirty;        // One bit per PAGE_ENTRIES entries
 
-        std::vector<SwapNotifyFn> m_swap_listeners;
-        std::vector<RemoveNotifyFn> m_remove_listeners;
+        uint32_t                m_change_tick{1};
+        ChunkedVector<uint32_t, PAGE_ENTRIES>   m_added_ticks;      // Parallel to m_data
+        ChunkedVector<uint32_t, PAGE_ENTRIES>   m_changed_ticks;
 
         std::conditional_t<std::is_void_v<R>, std::monostate, R*> m_reg;
 };
 
+template<typename Pool, typename T>
+concept ChildPoolOf = std::is_same_v<typename Pool::traits::parent, T>;
+
+/* Through the traits' parent_moved hook if there is one, for components that have more to update */
+template<typename Child>
+void set_parent_idx(Child& child, std::size_t i, std::size_t parent_idx) {
+    auto& comp = child.entry_at(i).data;
+    if constexpr (requires { Child::traits::parent_moved(comp, parent_idx); }) {
+        Child::traits::parent_moved(comp, parent_idx);
+    } else {
+        comp.*Child::traits::parent_idx = parent_idx;
+    }
+}
+
+/* Points the child component of owner, if it has one, at the new index of its parent entry */
+template<typename Child>
+void follow_parent(Child& child, EntityID owner, std::size_t parent_idx) {
+    auto idx = child.find(owner);
+    if (idx.has_value()) set_parent_idx(child, idx.value(), parent_idx);
+}
+
+/*
+ * Removes the T component of owner and, recursively, the components of every
+ * child pool of T for the same owner. The children are found at compile time
+ * from the pool traits, so the whole cascade is statically dispatched.
+ */
+template<typename T, typename... Pools>
+bool remove_cascade(TypeMap<Pools...>& pools, EntityID owner) {
+    auto removal = pools.template get<T>().remove(owner);
+    if (!removal.removed) return false;
+
+    pools.for_each([&pools, &removal, owner]<typename Child>(Child& child) {
+        if constexpr (ChildPoolOf<Child, T>) {
+            if (removal.moved != INVALID_ENTITY) follow_parent(child, removal.moved, removal.moved_to);
+            remove_cascade<typename Child::value_type>(pools, owner);
+        }
+    });
+    return true;
+}
+
+/*
+ * Same as above for many owners at once. The whole batch is removed from T
+ * first and cascaded into each child pool as a single batch, then each child
+ * is fixed up once for the entries of T that ended up somewhere else: by a
+ * lookup per moved entry for small batches, by one linear pass over the child
+ * when most of it may be affected. Returns how many owners had a T component.
+ */
+template<typename T, typename... Pools>
+std::size_t remove_cascade(TypeMap<Pools...>& pools, std::span<const EntityID> owners) {
+    auto& pool = pools.template get<T>();
+
+    std::vector<EntityID> removed;
+    std::vector<EntityID> moved;
+    removed.reserve(owners.size());
+    for (EntityID owner : owners) {
+        auto removal = pool.remove(owner);
+        if (!removal.removed) continue;
+        removed.push_back(owner);
+        if (removal.moved != INVALID_ENTITY) moved.push_back(removal.moved);
+    }
+    if (removed.empty()) return 0;
+
+    /* An entry can move several times in a batch, or be removed after moving, only where it ends up matters */
+    std::vector<std::pair<EntityID, std::size_t>> relocated;
+    relocated.reserve(moved.size());
+    for (EntityID owner : moved) {
+        auto idx = pool.find(owner);
+        if (idx.has_value()) relocated.emplace_back(owner, idx.value());
+    }
+
+    const auto& parents = pool.entries();
+    pools.for_each([&pools, &pool, &removed, &relocated, &parents]<typename Child>(Child& child) {
+        if constexpr (ChildPoolOf<Child, T>) {
+            remove_cascade<typename Child::value_type>(pools, std::span<const EntityID>(removed));
+
+            if (relocated.size() * 4 < child.size()) {
+                for (const auto& [owner, idx] : relocated) follow_parent(child, owner, idx);
+                return;
+            }
+
+            const auto& entries = child.entries();
+            for (std::size_t i = 0; i < entries.size(); ++i) {
+                std::size_t idx = entries[i].data.*Child::traits::parent_idx;
+                if (idx < parents.size() && parents[idx].owner == entries[i].owner) continue;
+
+                auto now = pool.find(entries[i].owner);
+                if (now.has_value()) set_parent_idx(child, i, now.value());
+            }
+        }
+    });
+    return removed.size();
+}
+
 #endif
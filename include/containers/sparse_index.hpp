@@ -0,0 +1,77 @@
+#ifndef SPARSE_INDEX_H
+#define SPARSE_INDEX_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "entity.hpp"
+
+/*
+ * EntityID to index map as a paged array. Ids are handed out densely so the
+ * pages fill up, a lookup is two loads and growing allocates one page, nothing
+ * is ever rehashed or moved. Ids are never reused, so a page is freed as soon
+ * as its last id is erased, the index only holds the pages of live ids.
+ */
+class SparseIndex {
+    public:
+        static constexpr std::size_t PAGE_IDS = 4096;
+
+        std::optional<std::size_t> find(EntityID eid) const {
+            std::size_t page = eid / PAGE_IDS;
+            if (page >= m_pages.size() || !m_pages[page]) return std::nullopt;
+
+            uint32_t idx = m_pages[page]->idx[eid % PAGE_IDS];
+            if (idx == NONE) return std::nullopt;
+            return idx;
+        }
+
+        void set(EntityID eid, std::size_t idx) {
+            std::size_t page = eid / PAGE_IDS;
+            if (page >= m_pages.size()) m_pages.resize(page + 1);
+            if (!m_pages[page]) {
+                m_pages[page] = std::make_unique<Page>();
+                m_pages[page]->idx.fill(NONE);
+            }
+
+            uint32_t& slot = m_pages[page]->idx[eid % PAGE_IDS];
+            if (slot == NONE) ++m_pages[page]->live;
+            slot = static_cast<uint32_t>(idx);
+        }
+
+        void erase(EntityID eid) {
+            std::size_t page = eid / PAGE_IDS;
+            if (page >= m_pages.size() || !m_pages[page]) return;
+
+            uint32_t& slot = m_pages[page]->idx[eid % PAGE_IDS];
+            if (slot == NONE) return;
+            slot = NONE;
+            if (--m_pages[page]->live == 0) release(page);
+        }
+
+        void clear() {
+            m_pages.clear();
+        }
+
+    private:
+        static constexpr uint32_t NONE = UINT32_MAX;
+
+        struct Page {
+            std::array<uint32_t, PAGE_IDS>  idx;
+            std::size_t                     live{0};    // Entries not NONE
+        };
+
+        /* Trailing empty pages are dropped from the table as well */
+        void release(std::size_t page) {
+            m_pages[page].reset();
+            while (!m_pages.empty() && !m_pages.back()) m_pages.pop_back();
+        }
+
+    private:
+        std::vector<std::unique_ptr<Page>>  m_pages;
+};
+
+#endif
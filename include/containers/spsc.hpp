@@ -0,0 +1,59 @@
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/*
+ * Bounded single producer, single consumer ring. Unlike MPSCQueue nothing is
+ * allocated after construction, a full ring rejects the push instead.
+ */
+template<typename T, std::size_t N>
+class SPSCQueue {
+    static_assert((N & (N - 1)) == 0, "SPSCQueue capacity must be a power of two");
+
+    public:
+        SPSCQueue() = default;
+
+        SPSCQueue(const SPSCQueue&) = delete;
+        SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+        /* Producer side only */
+        bool push(const T& v) noexcept {
+            std::size_t head = m_head.load(std::memory_order_relaxed);
+            if (head - m_tail_cache == N) {
+                m_tail_cache = m_tail.load(std::memory_order_acquire);
+                if (head - m_tail_cache == N) return false;
+            }
+
+            m_data[head & (N - 1)] = v;
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /* Consumer side only */
+        bool pop(T& v) noexcept {
+            std::size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail == m_head_cache) {
+                m_head_cache = m_head.load(std::memory_order_acquire);
+                if (tail == m_head_cache) return false;
+            }
+
+            v = std::move(m_data[tail & (N - 1)]);
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        /* Each side keeps a stale copy of the other's index and only reloads it when it looks full/empty */
+        alignas(64) std::atomic<std::size_t>    m_head{0};
+        std::size_t                             m_tail_cache{0};
+
+        alignas(64) std::atomic<std::size_t>    m_tail{0};
+        std::size_t                             m_head_cache{0};
+
+        alignas(64) std::array<T, N>            m_data{};
+};
+
+#endif
@@ -1,8 +1,12 @@
 #ifndef CTIME_TYPEMAP_H
 #define CTIME_TYPEMAP_H
 
-#include <stdexcept>
+#include <array>
+#include <cstddef>
 #include <type_traits>
+#include <utility>
+
+#include <assert.h>
 
 
 template<typename... Ts>
@@ -54,19 +58,6 @@ void for_each(TypeMapNode<T, Ts...>& node, F&& func) {
     for_each(node.next, std::forward<F>(func));
 }
 
-template<std::size_t I = 0, typename T, typename... Ts, typename F>
-void for_index(TypeMapNode<T, Ts...>& node, std::size_t idx, F&& func) {
-    if (I == idx) {
-        func(node.value);
-    } else {
-        if constexpr (sizeof... (Ts) > 0) {
-            for_index<I+1>(node.next, idx, std::forward<F>(func));
-        } else {
-            throw std::out_of_range("Index is out-of-bounds");
-        }
-    }
-}
-
 template<std::size_t I, typename T, typename... Ts>
 auto& get_at(TypeMapNode<T, Ts...>& node) {
     if constexpr (I == 0) {
@@ -108,9 +99,17 @@ class TypeMap {
             ::for_each(nodes, std::forward<F>(func));
         }
 
+        /*
+         * Calls func on the idx-th value through a table with one entry per
+         * type, built at compile time for each F, so the dispatch is a single
+         * indirect call whatever the number of types. idx must be < size().
+         */
         template<typename F>
-        void for_index(std::size_t idx, F&& func) {
-            ::for_index(nodes, idx, std::forward<F>(func));
+        void for_index(std::size_t idx, F&& func) noexcept {
+            using Fn = std::remove_reference_t<F>;
+            static constexpr auto table = make_dispatch_table<Fn>(std::index_sequence_for<Ts...>{});
+            assert(idx < table.size() && "Index out-of bounds");
+            table[idx](nodes, func);
         }
 
         template<std::size_t I = 0>
@@ -122,7 +121,22 @@ class TypeMap {
         std::size_t find() {
             return ::find<U>(nodes);
         }
+
+        static constexpr std::size_t size() {
+            return sizeof... (Ts);
+        }
     
+    private:
+        template<std::size_t I, typename Fn>
+        static void dispatch_at(TypeMapNode<Ts...>& nodes, Fn& func) {
+            func(::get_at<I>(nodes));
+        }
+
+        template<typename Fn, std::size_t... Is>
+        static constexpr auto make_dispatch_table(std::index_sequence<Is...>) {
+            return std::array<void (*)(TypeMapNode<Ts...>&, Fn&), sizeof... (Is)>{ &dispatch_at<Is, Fn>... };
+        }
+
     private:
         TypeMapNode<Ts...> nodes;
 };
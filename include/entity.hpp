@@ -1,18 +1,31 @@
 #ifndef ENTITY_H
 #define ENTITY_H
 
+#include <atomic>
 #include <cstdint>
+#include <limits>
 
 using EntityID = uint32_t;
 
+static constexpr EntityID INVALID_ENTITY = std::numeric_limits<EntityID>::max();
+
 class EntityManager {
     public:
+        /* Safe from any thread, command buffers reserve ids while systems run */
         EntityID create() {
-            return s_entity_counter++;
+            return s_entity_counter.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /* The id the next create() hands out, saved with the world so ids are never reused */
+        EntityID next_id() const {
+            return s_entity_counter.load(std::memory_order_relaxed);
+        }
+        void restore(EntityID next) {
+            s_entity_counter.store(next, std::memory_order_relaxed);
         }
         
     private:
-        static EntityID s_entity_counter;
+        static std::atomic<EntityID> s_entity_counter;
 };
 
 #endif
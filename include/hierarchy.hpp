@@ -0,0 +1,238 @@
+#ifndef HIERARCHY_H
+#define HIERARCHY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "containers/sparse_index.hpp"
+
+#include "entity.hpp"
+
+/*
+ * Parent/child links between entities, kept as one array in depth first
+ * order: a node is followed by its whole subtree, size entries long. Parents
+ * therefore always come before their children and a subtree is a contiguous
+ * range, so propagation is a single forward pass that recomputes the dirty
+ * subtrees and skips over nothing else than flags.
+ *
+ * Relinking moves the subtree's range in the array, it costs a pass over the
+ * nodes in between and is meant to be rare next to propagation. Unlinks and
+ * erases come in batches, a mass despawn, and cost one pass over every node
+ * per batch.
+ */
+class Hierarchy {
+    public:
+        /* Moves child, with its subtree, under parent. False if parent is in that subtree */
+        bool link(EntityID child, EntityID parent) {
+            if (child == parent) return false;
+            ensure(child);
+            std::size_t p = ensure(parent);
+            std::size_t c = m_pos.find(child).value();
+            std::size_t count = m_nodes[c].size;
+            if (p >= c && p < c + count) return false;
+
+            /* Right after the parent's subtree as it is laid out now, it may still hold child */
+            std::size_t to = p + m_nodes[p].size;
+            EntityID old_parent = m_nodes[c].parent;
+            shrink_ancestors(c, count);
+            std::size_t at = move_range(c, count, to);
+            m_nodes[at].parent = parent;
+            grow_ancestors(at, count);
+            m_nodes[at].dirty = true;
+
+            /* The old parent may be left a root with no child, compact() drops it */
+            if (old_parent != INVALID_ENTITY) {
+                const Node& old = m_nodes[m_pos.find(old_parent).value()];
+                if (old.parent == INVALID_ENTITY && old.size == 1) compact();
+            }
+            return true;
+        }
+
+        /* The subtree of each child becomes a tree of its own, nodes left alone are dropped */
+        void unlink(std::span<const EntityID> children) {
+            bool any = false;
+            for (EntityID child : children) {
+                auto found = m_pos.find(child);
+                if (!found.has_value() || m_nodes[found.value()].parent == INVALID_ENTITY) continue;
+                m_nodes[found.value()].parent = INVALID_ENTITY;
+                m_nodes[found.value()].dirty = true;
+                any = true;
+            }
+            if (any) compact();
+        }
+
+        /* Removes the nodes, their children become the roots of their own trees */
+        void erase(std::span<const EntityID> eids) {
+            bool any = false;
+            for (EntityID eid : eids) {
+                auto found = m_pos.find(eid);
+                if (!found.has_value()) continue;
+                m_nodes[found.value()].gone = true;
+                any = true;
+            }
+            if (any) compact();
+        }
+
+        void clear() {
+            m_nodes.clear();
+            m_pos.clear();
+        }
+
+        void mark_dirty(EntityID eid) {
+            auto found = m_pos.find(eid);
+            if (found.has_value()) m_nodes[found.value()].dirty = true;
+        }
+
+        bool contains(EntityID eid) const {
+            return m_pos.find(eid).has_value();
+        }
+
+        std::size_t size() const {
+            return m_nodes.size();
+        }
+
+        /*
+         * fn(node, parent) for every node below a dirty one, itself included,
+         * parents first. Roots have no parent to follow and are not passed.
+         */
+        template<typename F>
+        void propagate(F&& fn) {
+            std::size_t i = 0;
+            while (i < m_nodes.size()) {
+                if (!m_nodes[i].dirty) {
+                    ++i;
+                    continue;
+                }
+
+                std::size_t end = i + m_nodes[i].size;
+                for (; i < end; ++i) {
+                    if (m_nodes[i].parent != INVALID_ENTITY) fn(m_nodes[i].eid, m_nodes[i].parent);
+                    m_nodes[i].dirty = false;
+                }
+            }
+        }
+
+    private:
+        struct Node {
+            EntityID    eid;
+            EntityID    parent{INVALID_ENTITY};
+            uint32_t    size{1};            // Subtree, this node included
+            bool        dirty{true};
+            bool        gone{false};        // Erased, dropped by the next compact()
+        };
+
+        /* Position of eid, appended as a root of its own if it is not in yet */
+        std::size_t ensure(EntityID eid) {
+            auto found = m_pos.find(eid);
+            if (found.has_value()) return found.value();
+
+            m_pos.set(eid, m_nodes.size());
+            m_nodes.push_back(Node{eid});
+            return m_nodes.size() - 1;
+        }
+
+        void shrink_ancestors(std::size_t c, std::size_t count) {
+            for (EntityID a = m_nodes[c].parent; a != INVALID_ENTITY;) {
+                Node& node = m_nodes[m_pos.find(a).value()];
+                node.size -= static_cast<uint32_t>(count);
+                a = node.parent;
+            }
+        }
+        void grow_ancestors(std::size_t c, std::size_t count) {
+            for (EntityID a = m_nodes[c].parent; a != INVALID_ENTITY;) {
+                Node& node = m_nodes[m_pos.find(a).value()];
+                node.size += static_cast<uint32_t>(count);
+                a = node.parent;
+            }
+        }
+
+        /* Moves [first, first + count) to just before position to, returns where it starts now */
+        std::size_t move_range(std::size_t first, std::size_t count, std::size_t to) {
+            std::size_t lo, hi, at;
+            if (to > first) {
+                std::rotate(m_nodes.begin() + first, m_nodes.begin() + first + count, m_nodes.begin() + to);
+                lo = first, hi = to, at = to - count;
+            } else {
+                std::rotate(m_nodes.begin() + to, m_nodes.begin() + first, m_nodes.begin() + first + count);
+                lo = to, hi = first + count, at = to;
+            }
+            for (std::size_t i = lo; i < hi; ++i) m_pos.set(m_nodes[i].eid, i);
+            return at;
+        }
+
+        /*
+         * Applies every unlink and erase marked since the last pass at once, in
+         * time linear in the number of nodes however many there are. A node is
+         * the root of a tree after the pass if it has no parent or its parent is
+         * gone. Taking the surviving nodes of each such tree in their current
+         * order still gives a depth first order, so the trees only need to be
+         * laid out one after the other, in the order of their roots. Sizes are
+         * then recounted and the lone roots left over dropped.
+         */
+        void compact() {
+            std::size_t n = m_nodes.size();
+            m_root.resize(n);
+            m_count.assign(n + 1, 0);
+            for (std::size_t i = 0; i < n; ++i) {
+                Node& node = m_nodes[i];
+                if (node.gone) continue;
+
+                std::size_t parent = (node.parent == INVALID_ENTITY) ? i : m_pos.find(node.parent).value();
+                if (parent != i && m_nodes[parent].gone) {
+                    node.parent = INVALID_ENTITY;
+                    node.dirty = true;
+                    parent = i;
+                }
+                m_root[i] = (parent == i) ? i : m_root[parent];
+                ++m_count[m_root[i] + 1];
+            }
+
+            /* Counting sort on the position of the root, stable so each tree keeps its order */
+            for (std::size_t i = 0; i < n; ++i) m_count[i + 1] += m_count[i];
+            m_scratch.resize(m_count[n]);
+            for (std::size_t i = 0; i < n; ++i) {
+                if (m_nodes[i].gone) {
+                    m_pos.erase(m_nodes[i].eid);
+                    continue;
+                }
+                m_scratch[m_count[m_root[i]]++] = m_nodes[i];
+            }
+            m_nodes.swap(m_scratch);
+
+            for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+                m_nodes[i].size = 1;
+                m_pos.set(m_nodes[i].eid, i);
+            }
+            for (std::size_t i = m_nodes.size(); i-- > 0;) {
+                if (m_nodes[i].parent != INVALID_ENTITY) m_nodes[m_pos.find(m_nodes[i].parent).value()].size += m_nodes[i].size;
+            }
+
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+                if (m_nodes[i].parent == INVALID_ENTITY && m_nodes[i].size == 1) {
+                    m_pos.erase(m_nodes[i].eid);
+                    continue;
+                }
+                if (kept != i) {
+                    m_nodes[kept] = m_nodes[i];
+                    m_pos.set(m_nodes[kept].eid, kept);
+                }
+                ++kept;
+            }
+            m_nodes.resize(kept);
+        }
+
+    private:
+        std::vector<Node>   m_nodes;        // Depth first
+        SparseIndex         m_pos;          // EntityID -> index in m_nodes
+
+        /* Scratch reused by compact() */
+        std::vector<Node>           m_scratch;
+        std::vector<std::size_t>    m_root;
+        std::vector<std::size_t>    m_count;
+};
+
+#endif
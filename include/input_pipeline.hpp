@@ -0,0 +1,205 @@
+#ifndef INPUT_PIPELINE_H
+#define INPUT_PIPELINE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+#include "SDL3/SDL_events.h"
+#include "SDL3/SDL_keycode.h"
+#include "SDL3/SDL_timer.h"
+
+#include "containers/spsc.hpp"
+
+/* What the simulation reacts to, whichever keys are bound to it */
+enum class Action : uint8_t {
+    MOVE_UP,
+    MOVE_DOWN,
+    MOVE_LEFT,
+    MOVE_RIGHT,
+
+    NUM_ACTIONS,
+};
+
+/* A key going down or up, stamped with the time the OS saw it on the SDL_GetTicksNS clock */
+struct InputEvent {
+    uint64_t    timestamp;
+    SDL_Keycode key;
+    bool        down;
+};
+
+/* Keys to actions, several keys can share an action. WASD and the arrows move by default */
+class ActionMap {
+    public:
+        ActionMap() {
+            bind(SDLK_W, Action::MOVE_UP);
+            bind(SDLK_UP, Action::MOVE_UP);
+            bind(SDLK_S, Action::MOVE_DOWN);
+            bind(SDLK_DOWN, Action::MOVE_DOWN);
+            bind(SDLK_A, Action::MOVE_LEFT);
+            bind(SDLK_LEFT, Action::MOVE_LEFT);
+            bind(SDLK_D, Action::MOVE_RIGHT);
+            bind(SDLK_RIGHT, Action::MOVE_RIGHT);
+        }
+
+        void bind(SDL_Keycode key, Action action) {
+            m_bindings[key] = action;
+        }
+        void unbind(SDL_Keycode key) {
+            m_bindings.erase(key);
+        }
+
+        std::optional<Action> find(SDL_Keycode key) const {
+            auto it = m_bindings.find(key);
+            if (it == m_bindings.end()) return std::nullopt;
+            return it->second;
+        }
+
+    private:
+        std::unordered_map<SDL_Keycode, Action>     m_bindings;
+};
+
+/* The actions as of a simulation tick */
+class ActionState {
+    public:
+        void apply(Action action, bool down) {
+            uint32_t bit = 1u << static_cast<uint32_t>(action);
+            if (down) {
+                m_held |= bit;
+                m_pressed |= bit;
+            } else {
+                m_held &= ~bit;
+            }
+        }
+
+        bool held(Action action) const {
+            return (m_held >> static_cast<uint32_t>(action)) & 1u;
+        }
+        /* Went down during the tick, even if released before it ended */
+        bool pressed(Action action) const {
+            return (m_pressed >> static_cast<uint32_t>(action)) & 1u;
+        }
+        /* Held, or tapped for less than a tick, which still counts for that tick */
+        bool active(Action action) const {
+            return held(action) || pressed(action);
+        }
+
+        void next_tick() {
+            m_pressed = 0;
+        }
+
+    private:
+        uint32_t    m_held{0};
+        uint32_t    m_pressed{0};
+};
+
+/* Over one INTERVAL of ticks */
+struct InputLatency {
+    uint32_t    events{0};      // Applied in the interval
+    uint32_t    avg_us{0};      // From the OS timestamp to the end of the tick that applied the event
+    uint32_t    max_us{0};
+    uint32_t    late{0};        // Stamped before the deadline of an earlier tick, but only seen after it
+};
+
+/*
+ * Carries input from the thread that owns the window to the simulation. The
+ * window thread blocks on the OS event queue and pushes each key event,
+ * stamped, as soon as it arrives. Each simulation tick then applies exactly
+ * the events stamped up to its own start, in order, and leaves the later ones
+ * to the next tick. Input does not wait for a tick to be polled, only for the
+ * tick it belongs to.
+ */
+class InputPipeline {
+    public:
+        static constexpr std::size_t CAPACITY = 256;
+        static constexpr uint64_t INTERVAL = 1'000'000'000;    // ns
+
+        /* Window thread only, a key event. Key repeats are left out, false if the queue is full */
+        bool capture(const SDL_Event& event) {
+            if (event.key.repeat) return true;
+
+            return m_queue.push(InputEvent{event.key.timestamp, event.key.key, event.type == SDL_EVENT_KEY_DOWN});
+        }
+
+        /* Simulation thread only, applies through map every event stamped up to deadline */
+        void consume(uint64_t deadline, const ActionMap& map, ActionState& state) {
+            state.next_tick();
+
+            InputEvent event;
+            while (next(deadline, event)) {
+                if (event.timestamp <= m_last_deadline) ++m_interval.late;
+                if (auto action = map.find(event.key)) state.apply(*action, event.down);
+
+                ++m_tick_events;
+                m_tick_oldest = std::min(m_tick_oldest, event.timestamp);
+                m_tick_stamps += event.timestamp;
+            }
+            m_last_deadline = deadline;
+        }
+
+        /* Simulation thread only, the tick that last consumed is done and its result published */
+        void tick_done(uint64_t now) {
+            if (m_tick_events != 0) {
+                m_interval.events += m_tick_events;
+                m_latency_sum += now * m_tick_events - m_tick_stamps;
+                m_interval.max_us = std::max(m_interval.max_us, static_cast<uint32_t>((now - m_tick_oldest) / 1000));
+            }
+            m_tick_events = 0;
+            m_tick_oldest = UINT64_MAX;
+            m_tick_stamps = 0;
+
+            if (m_interval_start == 0) m_interval_start = now;
+            if (now - m_interval_start < INTERVAL) return;
+
+            if (m_interval.events != 0) m_interval.avg_us = static_cast<uint32_t>(m_latency_sum / m_interval.events / 1000);
+            {
+                std::lock_guard<std::mutex> lock(m_latency_mutex);
+                m_latency = m_interval;
+            }
+            m_interval = InputLatency{};
+            m_latency_sum = 0;
+            m_interval_start = now;
+        }
+
+        /* Thread safe, the last full interval */
+        InputLatency latency() const {
+            std::lock_guard<std::mutex> lock(m_latency_mutex);
+            return m_latency;
+        }
+
+    private:
+        /* The event popped past the deadline is kept for the next tick, the queue cannot be peeked */
+        bool next(uint64_t deadline, InputEvent& event) {
+            if (!m_next.has_value()) {
+                InputEvent popped;
+                if (!m_queue.pop(popped)) return false;
+                m_next = popped;
+            }
+            if (m_next->timestamp > deadline) return false;
+
+            event = *m_next;
+            m_next.reset();
+            return true;
+        }
+
+    private:
+        SPSCQueue<InputEvent, CAPACITY>     m_queue;
+        std::optional<InputEvent>           m_next;
+        uint64_t        m_last_deadline{0};
+
+        uint32_t        m_tick_events{0};
+        uint64_t        m_tick_oldest{UINT64_MAX};
+        uint64_t        m_tick_stamps{0};       // Sum, for the average
+
+        InputLatency    m_interval;
+        uint64_t        m_latency_sum{0};       // ns
+        uint64_t        m_interval_start{0};
+
+        mutable std::mutex  m_latency_mutex;
+        InputLatency        m_latency;
+};
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef BITSTREAM_H
+#define BITSTREAM_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <assert.h>
+
+/*
+ * Bit-granular writer over a caller owned buffer. Nothing is allocated, if the
+ * buffer is exhausted the writer flags the overflow and drops further writes,
+ * so a packet can be built speculatively and discarded if it did not fit.
+ */
+class BitWriter {
+    public:
+        BitWriter(uint8_t* buf, std::size_t capacity) noexcept
+            : m_buf (buf)
+            , m_capacity (capacity)
+        {}
+
+        void write_bits(uint32_t value, unsigned bits) noexcept {
+            assert(bits <= 32);
+            if (bits == 0) return;
+            if (m_bits + bits > m_capacity * 8) {
+                m_overflow = true;
+                return;
+            }
+
+            if (bits < 32) value &= (1u << bits) - 1;
+            m_scratch |= static_cast<uint64_t>(value) << m_scratch_bits;
+            m_scratch_bits += bits;
+            m_bits += bits;
+
+            while (m_scratch_bits >= 8) {
+                m_buf[m_bytes++] = static_cast<uint8_t>(m_scratch & 0xFF);
+                m_scratch >>= 8;
+                m_scratch_bits -= 8;
+            }
+        }
+
+        void write_bool(bool value) noexcept {
+            write_bits(value ? 1 : 0, 1);
+        }
+
+        /* Pads the last partial byte with zeros, returns the number of bytes used */
+        std::size_t flush() noexcept {
+            if (m_scratch_bits > 0) {
+                m_buf[m_bytes++] = static_cast<uint8_t>(m_scratch & 0xFF);
+                m_bits += 8 - m_scratch_bits;
+                m_scratch = 0;
+                m_scratch_bits = 0;
+            }
+            return m_bytes;
+        }
+
+        std::size_t bits_written() const noexcept {
+            return m_bits;
+        }
+        std::size_t bits_left() const noexcept {
+            return m_capacity * 8 - m_bits;
+        }
+        bool overflowed() const noexcept {
+            return m_overflow;
+        }
+
+    private:
+        uint8_t*    m_buf;
+        std::size_t m_capacity;
+        std::size_t m_bytes{0};
+        std::size_t m_bits{0};
+
+        uint64_t    m_scratch{0};
+        unsigned    m_scratch_bits{0};
+
+        bool        m_overflow{false};
+};
+
+/*
+ * Reading past the end of the buffer returns zeros and sets the overflow flag,
+ * callers validate once at the end instead of after every field.
+ */
+class BitReader {
+    public:
+        BitReader(const uint8_t* buf, std::size_t size) noexcept
+            : m_buf (buf)
+            , m_size (size)
+        {}
+
+        uint32_t read_bits(unsigned bits) noexcept {
+            assert(bits <= 32);
+            if (bits == 0) return 0;
+            if (m_bits + bits > m_size * 8) {
+                m_overflow = true;
+                return 0;
+            }
+
+            while (m_scratch_bits < bits) {
+                m_scratch |= static_cast<uint64_t>(m_buf[m_bytes++]) << m_scratch_bits;
+                m_scratch_bits += 8;
+            }
+
+            uint32_t value = static_cast<uint32_t>(m_scratch & ((uint64_t{1} << bits) - 1));
+            m_scratch >>= bits;
+            m_scratch_bits -= bits;
+            m_bits += bits;
+            return value;
+        }
+
+        bool read_bool() noexcept {
+            return read_bits(1) != 0;
+        }
+
+        std::size_t bits_read() const noexcept {
+            return m_bits;
+        }
+        bool overflowed() const noexcept {
+            return m_overflow;
+        }
+
+    private:
+        const uint8_t*  m_buf;
+        std::size_t     m_size;
+        std::size_t     m_bytes{0};
+        std::size_t     m_bits{0};
+
+        uint64_t    m_scratch{0};
+        unsigned    m_scratch_bits{0};
+
+        bool        m_overflow{false};
+};
+
+#endif
@@ -0,0 +1,375 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "net/bitstream.hpp"
+
+/*
+ * Independent message streams multiplexed over one unreliable connection.
+ * A lost packet only delays the messages it carried on their own channel,
+ * there is no stream wide head-of-line blocking like with NETStreamSocket.
+ */
+enum class Channel : uint8_t {
+    UNRELIABLE_SEQUENCED = 0,  // Never resent, anything older than the newest delivered is dropped
+    RELIABLE_ORDERED,          // Resent until acked, delivered in send order
+    RELIABLE_UNORDERED,        // Resent until acked, delivered as soon as it arrives
+
+    COUNT,
+};
+
+struct ChannelMessage {
+    static constexpr std::size_t MAX_SIZE = 64;
+
+    uint16_t    id{0};
+    uint8_t     len{0};
+    std::array<uint8_t, MAX_SIZE>   data;
+};
+
+namespace channel {
+    static constexpr std::size_t NUM_CHANNELS = static_cast<std::size_t>(Channel::COUNT);
+
+    /* Messages in flight per channel, a reliable send fails once the oldest unacked is this far behind */
+    static constexpr uint16_t WINDOW = 64;
+    static constexpr uint16_t SENT_PACKETS = 128;
+    static constexpr std::size_t MESSAGES_PER_PACKET = 32;
+
+    static constexpr double MIN_RESEND_DELAY = 0.03;
+    static constexpr double RTT_SMOOTHING = 0.1;
+
+    static constexpr unsigned HEADER_BITS = 16 + 16 + 32;
+    static constexpr unsigned MESSAGE_HEADER_BITS = 1 + 2 + 16 + 8;
+
+    /* Sequence numbers wrap, a is newer than b if it is less than half the space ahead */
+    inline bool newer(uint16_t a, uint16_t b) noexcept {
+        return static_cast<int16_t>(a - b) > 0;
+    }
+}
+
+/*
+ * Protocol state for one peer, independent of any socket: write_packet fills
+ * the next outgoing packet and read_packet consumes an incoming one. Every
+ * packet has a sequence number and acks the newest packet received together
+ * with a bitfield of the 32 before it, so a message is only resent if every
+ * packet that carried it went unacknowledged.
+ */
+class ChannelConnection {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+    public:
+        /* False if the message is too big or a reliable channel window is full */
+        bool send(Channel ch, const uint8_t* data, std::size_t len) {
+            if (len > ChannelMessage::MAX_SIZE || ch >= Channel::COUNT) return false;
+
+            SendChannel& sc = m_send[index(ch)];
+            if (ch != Channel::UNRELIABLE_SEQUENCED &&
+                    static_cast<uint16_t>(sc.next_id - sc.oldest_unacked) >= channel::WINDOW) {
+                return false;
+            }
+
+            SendEntry& e = sc.entries[sc.next_id % channel::WINDOW];
+            e.valid = true;
+            e.sent = false;
+            e.msg.id = sc.next_id;
+            e.msg.len = static_cast<uint8_t>(len);
+            std::copy(data, data + len, e.msg.data.begin());
+
+            ++sc.next_id;
+            /* Unreliable messages that never made it out are simply overwritten by newer ones */
+            if (ch == Channel::UNRELIABLE_SEQUENCED &&
+                    static_cast<uint16_t>(sc.next_id - sc.oldest_unacked) > channel::WINDOW) {
+                sc.oldest_unacked = sc.next_id - channel::WINDOW;
+            }
+            return true;
+        }
+
+        /* Pops the next message delivered on ch, false if there is none */
+        bool receive(Channel ch, ChannelMessage& out) {
+            RecvChannel& rc = m_recv[index(ch)];
+            if (ch == Channel::RELIABLE_ORDERED) {
+                RecvEntry& e = rc.entries[rc.next_id % channel::WINDOW];
+                if (!e.valid || e.msg.id != rc.next_id) return false;
+                out = e.msg;
+                e.valid = false;
+                ++rc.next_id;
+                return true;
+            }
+
+            if (rc.head == rc.tail) return false;
+            out = rc.entries[rc.tail % channel::WINDOW].msg;
+            ++rc.tail;
+            return true;
+        }
+
+        /* True if there is something to resend, something new or acks the peer is waiting on */
+        bool wants_to_send(Clock::time_point now) const {
+            if (m_ack_pending) return true;
+            for (std::size_t c = 0; c < channel::NUM_CHANNELS; ++c) {
+                const SendChannel& sc = m_send[c];
+                for (uint16_t id = sc.oldest_unacked; id != sc.next_id; ++id) {
+                    if (due(sc.entries[id % channel::WINDOW], id, now)) return true;
+                }
+            }
+            return false;
+        }
+
+        /* Writes the packet header followed by as many due messages as fit in w */
+        void write_packet(BitWriter& w, Clock::time_point now) {
+            uint16_t seq = m_next_seq++;
+            w.write_bits(seq, 16);
+            w.write_bits(m_remote_seq, 16);
+            w.write_bits(m_remote_bits, 32);
+            m_ack_pending = false;
+
+            SentPacket& sent = m_sent[seq % channel::SENT_PACKETS];
+            sent.seq = seq;
+            sent.valid = true;
+            sent.acked = false;
+            sent.time = now;
+            sent.count = 0;
+
+            for (std::size_t c = 0; c < channel::NUM_CHANNELS; ++c) {
+                SendChannel& sc = m_send[c];
+                for (uint16_t id = sc.oldest_unacked; id != sc.next_id; ++id) {
+                    SendEntry& e = sc.entries[id % channel::WINDOW];
+                    if (!due(e, id, now)) continue;
+                    if (sent.count == channel::MESSAGES_PER_PACKET) break;
+
+                    std::size_t bits = channel::MESSAGE_HEADER_BITS + e.msg.len * 8u;
+                    if (w.bits_left() < bits + 1) continue;
+
+                    w.write_bool(true);
+                    w.write_bits(static_cast<uint32_t>(c), 2);
+                    w.write_bits(id, 16);
+                    w.write_bits(e.msg.len, 8);
+                    for (uint8_t i = 0; i < e.msg.len; ++i) w.write_bits(e.msg.data[i], 8);
+
+                    if (c == index(Channel::UNRELIABLE_SEQUENCED)) {
+                        e.valid = false;
+                    } else {
+                        e.sent = true;
+                        e.last_sent = now;
+                        if (e.sends++ > 0) ++m_resent;
+                    }
+                    sent.entries[sent.count++] = SentMessage{static_cast<uint8_t>(c), id};
+                }
+                /* Unreliable messages that did not fit stay queued for the next packet */
+                if (c == index(Channel::UNRELIABLE_SEQUENCED)) advance(sc);
+            }
+            w.write_bool(false);
+        }
+
+        /* False on a malformed packet or when the receive side is out of room, the packet is then not acked */
+        bool read_packet(BitReader& r, Clock::time_point now) {
+            uint16_t seq = static_cast<uint16_t>(r.read_bits(16));
+            uint16_t ack = static_cast<uint16_t>(r.read_bits(16));
+            uint32_t ack_bits = r.read_bits(32);
+            if (r.overflowed()) return false;
+
+            process_acks(ack, ack_bits, now);
+
+            while (r.read_bool()) {
+                uint32_t c = r.read_bits(2);
+                uint16_t id = static_cast<uint16_t>(r.read_bits(16));
+                uint8_t len = static_cast<uint8_t>(r.read_bits(8));
+                if (c >= channel::NUM_CHANNELS || len > ChannelMessage::MAX_SIZE) return false;
+
+                ChannelMessage msg;
+                msg.id = id;
+                msg.len = len;
+                for (uint8_t i = 0; i < len; ++i) msg.data[i] = static_cast<uint8_t>(r.read_bits(8));
+                if (r.overflowed()) return false;
+
+                if (!deliver(static_cast<Channel>(c), msg)) return false;
+            }
+            if (r.overflowed()) return false;
+
+            record_received(seq);
+            return true;
+        }
+
+        double rtt() const {
+            return m_rtt;
+        }
+        uint64_t messages_resent() const {
+            return m_resent;
+        }
+        uint64_t packets_acked() const {
+            return m_acked;
+        }
+
+    private:
+        struct SendEntry {
+            bool        valid{false};
+            bool        sent{false};
+            uint32_t    sends{0};
+            Clock::time_point   last_sent{};
+            ChannelMessage      msg;
+        };
+
+        struct SendChannel {
+            uint16_t    next_id{0};
+            uint16_t    oldest_unacked{0};
+            std::array<SendEntry, channel::WINDOW>  entries;
+        };
+
+        /* Ordered channels index entries by id, the others use them as a delivery ring */
+        struct RecvEntry {
+            bool            valid{false};
+            ChannelMessage  msg;
+        };
+
+        struct RecvChannel {
+            uint16_t    next_id{0};             // Ordered and unordered: oldest id not delivered yet. Sequenced: last id delivered
+            uint32_t    head{0};
+            uint32_t    tail{0};
+            std::array<RecvEntry, channel::WINDOW>  entries;
+            std::array<bool, channel::WINDOW>       seen{};     // Unordered: delivered, for the ids from next_id on
+        };
+
+        struct SentMessage {
+            uint8_t     channel;
+            uint16_t    id;
+        };
+
+        struct SentPacket {
+            uint16_t    seq{0};
+            bool        valid{false};
+            bool        acked{false};
+            Clock::time_point   time{};
+            std::size_t count{0};
+            std::array<SentMessage, channel::MESSAGES_PER_PACKET>   entries;
+        };
+
+    private:
+        static constexpr std::size_t index(Channel ch) noexcept {
+            return static_cast<std::size_t>(ch);
+        }
+
+        bool due(const SendEntry& e, uint16_t id, Clock::time_point now) const {
+            if (!e.valid || e.msg.id != id) return false;
+            if (!e.sent) return true;
+            double delay = std::max(channel::MIN_RESEND_DELAY, 1.5 * m_rtt);
+            return std::chrono::duration<double>(now - e.last_sent).count() >= delay;
+        }
+
+        void process_acks(uint16_t ack, uint32_t ack_bits, Clock::time_point now) {
+            for (uint16_t i = 0; i <= 32; ++i) {
+                if (i > 0 && !(ack_bits & (1u << (i - 1)))) continue;
+
+                uint16_t seq = ack - i;
+                SentPacket& sent = m_sent[seq % channel::SENT_PACKETS];
+                if (!sent.valid || sent.seq != seq || sent.acked) continue;
+                sent.acked = true;
+                ++m_acked;
+
+                double sample = std::chrono::duration<double>(now - sent.time).count();
+                m_rtt = (m_rtt == 0.0) ? sample : m_rtt + (sample - m_rtt) * channel::RTT_SMOOTHING;
+
+                for (std::size_t m = 0; m < sent.count; ++m) {
+                    const SentMessage& msg = sent.entries[m];
+                    if (msg.channel == index(Channel::UNRELIABLE_SEQUENCED)) continue;
+
+                    SendEntry& e = m_send[msg.channel].entries[msg.id % channel::WINDOW];
+                    if (e.valid && e.msg.id == msg.id) e.valid = false;
+                }
+            }
+
+            for (auto& sc : m_send) advance(sc);
+        }
+
+        static void advance(SendChannel& sc) {
+            while (sc.oldest_unacked != sc.next_id) {
+                const SendEntry& e = sc.entries[sc.oldest_unacked % channel::WINDOW];
+                if (e.valid && e.msg.id == sc.oldest_unacked) break;
+                ++sc.oldest_unacked;
+            }
+        }
+
+        bool deliver(Channel ch, const ChannelMessage& msg) {
+            RecvChannel& rc = m_recv[index(ch)];
+            switch (ch) {
+                case Channel::RELIABLE_ORDERED: {
+                    int16_t ahead = static_cast<int16_t>(msg.id - rc.next_id);
+                    if (ahead < 0) return true;                         // Already delivered
+                    if (ahead >= channel::WINDOW) return false;         // No room until the application drains, resent later
+                    RecvEntry& e = rc.entries[msg.id % channel::WINDOW];
+                    if (e.valid) return e.msg.id == msg.id;
+                    e.valid = true;
+                    e.msg = msg;
+                    return true;
+                }
+                case Channel::RELIABLE_UNORDERED: {
+                    int16_t ahead = static_cast<int16_t>(msg.id - rc.next_id);
+                    if (ahead < 0) return true;
+                    if (ahead >= channel::WINDOW) return false;
+                    bool& seen = rc.seen[msg.id % channel::WINDOW];
+                    if (seen) return true;
+                    if (rc.head - rc.tail == channel::WINDOW) return false;
+                    seen = true;
+                    push(rc, msg);
+
+                    /* Slide the window past every id delivered in a row */
+                    while (rc.seen[rc.next_id % channel::WINDOW]) {
+                        rc.seen[rc.next_id % channel::WINDOW] = false;
+                        ++rc.next_id;
+                    }
+                    return true;
+                }
+                case Channel::UNRELIABLE_SEQUENCED:
+                    if (m_got_sequenced && !channel::newer(msg.id, rc.next_id)) return true;
+                    m_got_sequenced = true;
+                    rc.next_id = msg.id;
+                    if (rc.head - rc.tail == channel::WINDOW) ++rc.tail;
+                    push(rc, msg);
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        static void push(RecvChannel& rc, const ChannelMessage& msg) {
+            rc.entries[rc.head % channel::WINDOW].msg = msg;
+            ++rc.head;
+        }
+
+        void record_received(uint16_t seq) {
+            if (!m_got_packet) {
+                m_got_packet = true;
+                m_remote_seq = seq;
+                m_remote_bits = 0;
+            } else if (channel::newer(seq, m_remote_seq)) {
+                uint16_t shift = seq - m_remote_seq;
+                m_remote_bits = (shift >= 32) ? 0 : (m_remote_bits << shift);
+                if (shift <= 32) m_remote_bits |= 1u << (shift - 1);
+                m_remote_seq = seq;
+            } else {
+                uint16_t behind = m_remote_seq - seq;
+                if (behind >= 1 && behind <= 32) m_remote_bits |= 1u << (behind - 1);
+            }
+            m_ack_pending = true;
+        }
+
+    private:
+        std::array<SendChannel, channel::NUM_CHANNELS>  m_send;
+        std::array<RecvChannel, channel::NUM_CHANNELS>  m_recv;
+        std::array<SentPacket, channel::SENT_PACKETS>   m_sent;
+
+        uint16_t    m_next_seq{0};
+        uint16_t    m_remote_seq{0};
+        uint32_t    m_remote_bits{0};
+        bool        m_got_packet{false};
+        bool        m_got_sequenced{false};
+        bool        m_ack_pending{false};
+
+        double      m_rtt{0.0};
+        uint64_t    m_resent{0};
+        uint64_t    m_acked{0};
+};
+
+#endif
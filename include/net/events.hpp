@@ -0,0 +1,58 @@
+#ifndef NET_EVENTS_H
+#define NET_EVENTS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "net/bitstream.hpp"
+#include "net/channel.hpp"
+
+/* Gameplay events carried by the channels, the first byte of every message is its EventType */
+enum class EventType : uint8_t {
+    SERVER_STATS = 1,
+};
+
+/* Broadcast once per interval on the sequenced channel, for tooling such as the load generator */
+struct ServerStats {
+    uint32_t    ticks{0};               // World ticks in the interval
+    uint32_t    tick_avg_us{0};         // Work per tick, excluding the sleep until the next one
+    uint32_t    tick_max_us{0};
+    uint16_t    clients{0};
+    uint32_t    bytes_per_client{0};    // Per second, averaged over the connected clients
+    uint32_t    checkpoint_max_us{0};   // Longest checkpoint capture in the interval, part of the tick time above
+};
+
+namespace events {
+    static constexpr unsigned TYPE_BITS = 8;
+
+    /* Returns the message length, 0 if it did not fit */
+    inline std::size_t write(uint8_t* buf, const ServerStats& stats) noexcept {
+        BitWriter w(buf, ChannelMessage::MAX_SIZE);
+        w.write_bits(static_cast<uint32_t>(EventType::SERVER_STATS), TYPE_BITS);
+        w.write_bits(stats.ticks, 32);
+        w.write_bits(stats.tick_avg_us, 32);
+        w.write_bits(stats.tick_max_us, 32);
+        w.write_bits(stats.clients, 16);
+        w.write_bits(stats.bytes_per_client, 32);
+        w.write_bits(stats.checkpoint_max_us, 32);
+        return w.overflowed() ? 0 : w.flush();
+    }
+
+    inline EventType type(const ChannelMessage& msg) noexcept {
+        return (msg.len == 0) ? EventType{} : static_cast<EventType>(msg.data[0]);
+    }
+
+    inline bool read(const ChannelMessage& msg, ServerStats& out) noexcept {
+        BitReader r(msg.data.data(), msg.len);
+        if (static_cast<EventType>(r.read_bits(TYPE_BITS)) != EventType::SERVER_STATS) return false;
+        out.ticks = r.read_bits(32);
+        out.tick_avg_us = r.read_bits(32);
+        out.tick_max_us = r.read_bits(32);
+        out.clients = static_cast<uint16_t>(r.read_bits(16));
+        out.bytes_per_client = r.read_bits(32);
+        out.checkpoint_max_us = r.read_bits(32);
+        return !r.overflowed();
+    }
+}
+
+#endif
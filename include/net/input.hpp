@@ -0,0 +1,61 @@
+#ifndef INPUT_CMD_H
+#define INPUT_CMD_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "net/bitstream.hpp"
+
+#include "vector.hpp"
+
+/* One sampled input per client tick, seq is the client tick it was sampled at */
+struct InputCmd {
+    uint32_t    seq{0};
+    int8_t      move_x{0};     // -1, 0 or 1
+    int8_t      move_y{0};
+};
+
+namespace input {
+    static constexpr double MOVE_SPEED = 120.0;
+
+    /* Every unacknowledged input is resent until the server confirms it, up to this many */
+    static constexpr std::size_t MAX_REDUNDANT = 16;
+
+    /* The one place an input turns into motion, used by the server and by client prediction */
+    inline Vector2D<double> velocity(const InputCmd& cmd) noexcept {
+        return {cmd.move_x * MOVE_SPEED, cmd.move_y * MOVE_SPEED};
+    }
+
+    /* Inputs are consecutive, only the first sequence number goes on the wire */
+    inline void write(BitWriter& w, const InputCmd* cmds, std::size_t count) noexcept {
+        w.write_bits(static_cast<uint32_t>(count), 5);
+        if (count == 0) return;
+        w.write_bits(cmds[0].seq, 32);
+        for (std::size_t i = 0; i < count; ++i) {
+            w.write_bits(static_cast<uint32_t>(cmds[i].move_x + 1), 2);
+            w.write_bits(static_cast<uint32_t>(cmds[i].move_y + 1), 2);
+        }
+    }
+
+    inline int8_t read_axis(BitReader& r) noexcept {
+        uint32_t v = r.read_bits(2);
+        return (v > 2) ? 0 : static_cast<int8_t>(static_cast<int32_t>(v) - 1);
+    }
+
+    /* Returns the number of inputs decoded into out, which must hold MAX_REDUNDANT */
+    inline std::size_t read(BitReader& r, InputCmd* out) noexcept {
+        std::size_t count = r.read_bits(5);
+        if (count > MAX_REDUNDANT) return 0;
+        if (count == 0) return 0;
+
+        uint32_t seq = r.read_bits(32);
+        for (std::size_t i = 0; i < count; ++i) {
+            out[i].seq = seq + static_cast<uint32_t>(i);
+            out[i].move_x = read_axis(r);
+            out[i].move_y = read_axis(r);
+        }
+        return r.overflowed() ? 0 : count;
+    }
+}
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef INTEREST_H
+#define INTEREST_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "net/snapshot.hpp"
+
+#include "entity.hpp"
+#include "vector.hpp"
+
+/*
+ * Uniform spatial hash over the replicated bodies, shared by every client of
+ * the server. It is kept up to date incrementally: a body only changes bucket
+ * when it crosses a cell boundary, so a tick where nothing crossed touches
+ * none of the buckets. Queries cost the bodies around the point, not the size
+ * of the world.
+ */
+class InterestGrid {
+    public:
+        static constexpr double CELL_SIZE = 64.0;
+
+    public:
+        /* cur must be sorted by id, indices handed out by query refer to it */
+        void update(const SnapshotView& cur) {
+            /* Bodies that disappeared since the last update are found by merging the sorted ids */
+            auto c = cur.begin();
+            for (EntityID id : m_ids) {
+                while (c != cur.end() && c->id < id) ++c;
+                if (c == cur.end() || c->id != id) erase(id);
+            }
+
+            m_ids.clear();
+            for (uint32_t i = 0; i < cur.size(); ++i) {
+                const QuantizedState& s = cur[i];
+                uint64_t cell = cell_of(s.px, s.py);
+                m_ids.push_back(s.id);
+
+                auto [it, inserted] = m_slots.try_emplace(s.id);
+                Slot& slot = it->second;
+                slot.index = i;
+                if (inserted) {
+                    insert(s.id, slot, cell);
+                } else if (slot.cell != cell) {
+                    remove_from_cell(slot);
+                    insert(s.id, slot, cell);
+                }
+            }
+        }
+
+        /* Calls fn(index) for every body in the cells overlapping the square around center */
+        template<typename F>
+        void query(Vector2D<double> center, double radius, F&& fn) const {
+            int32_t x0 = cell_coord(center.x - radius), x1 = cell_coord(center.x + radius);
+            int32_t y0 = cell_coord(center.y - radius), y1 = cell_coord(center.y + radius);
+
+            for (int32_t cx = x0; cx <= x1; ++cx) {
+                for (int32_t cy = y0; cy <= y1; ++cy) {
+                    auto cell = m_cells.find(key(cx, cy));
+                    if (cell == m_cells.end()) continue;
+                    for (EntityID id : cell->second) {
+                        fn(m_slots.find(id)->second.index);
+                    }
+                }
+            }
+        }
+
+        std::optional<uint32_t> index_of(EntityID eid) const {
+            auto it = m_slots.find(eid);
+            if (it == m_slots.end()) return std::nullopt;
+            return it->second.index;
+        }
+
+    private:
+        struct Slot {
+            uint64_t    cell{0};
+            uint32_t    pos{0};        // Position inside the cell bucket
+            uint32_t    index{0};      // Position inside the last view given to update
+        };
+
+    private:
+        static int32_t cell_coord(double v) noexcept {
+            return static_cast<int32_t>(std::floor(v / CELL_SIZE));
+        }
+        static uint64_t key(int32_t cx, int32_t cy) noexcept {
+            return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cy);
+        }
+        static uint64_t cell_of(int32_t px, int32_t py) noexcept {
+            return key(cell_coord(quant::dequantize(px, quant::POS_SCALE)),
+                       cell_coord(quant::dequantize(py, quant::POS_SCALE)));
+        }
+
+        void insert(EntityID id, Slot& slot, uint64_t cell) {
+            auto& bucket = m_cells[cell];
+            slot.cell = cell;
+            slot.pos = static_cast<uint32_t>(bucket.size());
+            bucket.push_back(id);
+        }
+
+        void remove_from_cell(const Slot& slot) {
+            auto it = m_cells.find(slot.cell);
+            auto& bucket = it->second;
+            if (slot.pos != bucket.size() - 1) {
+                bucket[slot.pos] = bucket.back();
+                m_slots[bucket[slot.pos]].pos = slot.pos;
+            }
+            bucket.pop_back();
+            if (bucket.empty()) m_cells.erase(it);
+        }
+
+        void erase(EntityID id) {
+            auto it = m_slots.find(id);
+            if (it == m_slots.end()) return;
+            remove_from_cell(it->second);
+            m_slots.erase(it);
+        }
+
+    private:
+        std::unordered_map<uint64_t, std::vector<EntityID>>    m_cells;
+        std::unordered_map<EntityID, Slot>                      m_slots;
+        std::vector<EntityID>   m_ids;     // Sorted ids of the last update, to find removals
+};
+
+#endif
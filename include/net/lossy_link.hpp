@@ -0,0 +1,115 @@
+#ifndef LOSSY_LINK_H
+#define LOSSY_LINK_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "net/bitstream.hpp"
+#include "net/channel.hpp"
+#include "net/protocol.hpp"
+
+/*
+ * In memory stand-in for the socket between two ChannelConnections, with
+ * configurable loss, latency, jitter and duplication. Time is whatever the
+ * caller passes in, so a run is reproducible from its seed and can cover
+ * minutes of traffic in milliseconds.
+ */
+class LossyLink {
+    public:
+        using Clock = ChannelConnection::Clock;
+
+        struct Config {
+            double      loss{0.0};          // Chance a packet is dropped
+            double      duplicate{0.0};     // Chance a delivered packet arrives twice
+            double      latency{0.05};      // One way, seconds
+            double      jitter{0.0};        // Added uniformly in [0, jitter), reorders packets
+            uint32_t    seed{1};
+        };
+
+    public:
+        LossyLink(ChannelConnection& a, ChannelConnection& b, const Config& config)
+            : m_a (a), m_b (b), m_config (config), m_rng (config.seed) {}
+
+        /* Lets both ends write whatever they want to send and delivers every packet due by now */
+        void step(Clock::time_point now) {
+            transmit(m_a, 0, now);
+            transmit(m_b, 1, now);
+
+            for (std::size_t i = 0; i < m_in_flight.size();) {
+                InFlight& f = m_in_flight[i];
+                if (f.arrival > now) {
+                    ++i;
+                    continue;
+                }
+
+                BitReader r(f.data.data(), f.len);
+                (f.to == 0 ? m_a : m_b).read_packet(r, now);
+                ++m_delivered;
+
+                f = m_in_flight.back();
+                m_in_flight.pop_back();
+            }
+        }
+
+        uint64_t packets_sent() const {
+            return m_sent;
+        }
+        uint64_t packets_lost() const {
+            return m_lost;
+        }
+        uint64_t packets_delivered() const {
+            return m_delivered;
+        }
+
+    private:
+        struct InFlight {
+            int                 to;
+            Clock::time_point   arrival;
+            std::size_t         len;
+            std::array<uint8_t, net::MTU>   data;
+        };
+
+    private:
+        void transmit(ChannelConnection& from, int from_idx, Clock::time_point now) {
+            if (!from.wants_to_send(now)) return;
+
+            InFlight f{};
+            f.to = 1 - from_idx;
+            BitWriter w(f.data.data(), f.data.size());
+            from.write_packet(w, now);
+            f.len = w.flush();
+            ++m_sent;
+
+            if (m_chance(m_rng) < m_config.loss) {
+                ++m_lost;
+                return;
+            }
+
+            int copies = (m_chance(m_rng) < m_config.duplicate) ? 2 : 1;
+            for (int i = 0; i < copies; ++i) {
+                double delay = m_config.latency + m_chance(m_rng) * m_config.jitter;
+                f.arrival = now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>{delay});
+                m_in_flight.push_back(f);
+            }
+        }
+
+    private:
+        ChannelConnection&  m_a;
+        ChannelConnection&  m_b;
+        Config              m_config;
+
+        std::mt19937                            m_rng;
+        std::uniform_real_distribution<double>  m_chance{0.0, 1.0};
+        std::vector<InFlight>                   m_in_flight;
+
+        uint64_t    m_sent{0};
+        uint64_t    m_lost{0};
+        uint64_t    m_delivered{0};
+};
+
+#endif
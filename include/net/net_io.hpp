@@ -0,0 +1,245 @@
+#ifndef NET_IO_H
+#define NET_IO_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "containers/spsc.hpp"
+
+#include "net/protocol.hpp"
+
+#include "RAII/SDL_net.hpp"
+
+/* A datagram in flight, always owned by exactly one of the pool, a queue or its current user */
+struct Packet {
+    NET_Address*    addr{nullptr};     // Holds a reference while the packet is in use
+    uint16_t        port{0};
+    net::MsgType    type{};            // Filled in by the I/O thread for received packets
+    std::size_t     len{0};
+    std::array<uint8_t, net::MTU>   data;
+};
+
+/*
+ * Fixed set of preallocated packets handed out through a lock free stack,
+ * indices are tagged with a generation so a concurrent pop/push pair cannot
+ * fall into the ABA trap.
+ */
+class PacketPool {
+    public:
+        explicit PacketPool(std::size_t count)
+            : m_packets (count)
+            , m_next (std::make_unique<std::atomic<uint32_t>[]>(count))
+        {
+            for (std::size_t i = 0; i < count; ++i) {
+                m_next[i].store((i + 1 < count) ? static_cast<uint32_t>(i + 1) : NIL, std::memory_order_relaxed);
+            }
+            m_head.store(pack(count > 0 ? 0 : NIL, 0), std::memory_order_relaxed);
+        }
+
+        PacketPool(const PacketPool&) = delete;
+        PacketPool& operator=(const PacketPool&) = delete;
+
+        /* Returns nullptr when every packet is in use */
+        Packet* acquire() noexcept {
+            uint64_t head = m_head.load(std::memory_order_acquire);
+            while (true) {
+                uint32_t idx = index(head);
+                if (idx == NIL) return nullptr;
+
+                uint64_t desired = pack(m_next[idx].load(std::memory_order_relaxed), tag(head) + 1);
+                if (m_head.compare_exchange_weak(head, desired,
+                            std::memory_order_acq_rel,
+                            std::memory_order_acquire))
+                {
+                    Packet* p = &m_packets[idx];
+                    p->len = 0;
+                    return p;
+                }
+            }
+        }
+
+        void release(Packet* p) noexcept {
+            if (p->addr != nullptr) {
+                NET_UnrefAddress(p->addr);
+                p->addr = nullptr;
+            }
+
+            uint32_t idx = static_cast<uint32_t>(p - m_packets.data());
+            uint64_t head = m_head.load(std::memory_order_relaxed);
+            while (true) {
+                m_next[idx].store(index(head), std::memory_order_relaxed);
+                if (m_head.compare_exchange_weak(head, pack(idx, tag(head) + 1),
+                            std::memory_order_release,
+                            std::memory_order_relaxed))
+                {
+                    return;
+                }
+            }
+        }
+
+    private:
+        static constexpr uint32_t NIL = 0xFFFFFFFF;
+
+        static uint64_t pack(uint32_t idx, uint32_t tag) noexcept {
+            return (static_cast<uint64_t>(tag) << 32) | idx;
+        }
+        static uint32_t index(uint64_t v) noexcept {
+            return static_cast<uint32_t>(v & 0xFFFFFFFF);
+        }
+        static uint32_t tag(uint64_t v) noexcept {
+            return static_cast<uint32_t>(v >> 32);
+        }
+
+    private:
+        std::vector<Packet>                         m_packets;
+        std::unique_ptr<std::atomic<uint32_t>[]>    m_next;
+        std::atomic<uint64_t>                       m_head;
+};
+
+/*
+ * Owns a datagram socket on a thread of its own. Received datagrams are copied
+ * into pooled packets, tagged with their message type and handed over through
+ * a lock free queue; outgoing packets come back the same way and are sent in
+ * batches. The simulation side never touches the socket and, once the pool is
+ * built, nothing on the packet path allocates on our side (SDL_net still
+ * allocates the NET_Datagram it returns, that copy is dropped right away on
+ * the I/O thread).
+ */
+class NetIO {
+    public:
+        static constexpr std::size_t QUEUE_SIZE = 1024;
+        static constexpr std::size_t POOL_SIZE = 2 * QUEUE_SIZE + 64;
+        static constexpr std::size_t RECEIVE_BATCH = 256;
+
+        /* How long the I/O thread blocks on the socket before it looks at the outgoing queue again */
+        static constexpr Sint32 POLL_TIMEOUT_MS = 1;
+
+    public:
+        explicit NetIO(NET_DatagramSocket* socket)
+            : m_socket (socket)
+            , m_pool (POOL_SIZE)
+        {}
+
+        ~NetIO() {
+            m_running.store(false, std::memory_order_relaxed);
+            if (m_io_thread.joinable()) m_io_thread.join();
+
+            Packet* p;
+            while (m_inbound.pop(p)) m_pool.release(p);
+        }
+
+        NetIO(const NetIO&) = delete;
+        NetIO& operator=(const NetIO&) = delete;
+
+        void run() {
+            m_running.store(true, std::memory_order_relaxed);
+            m_io_thread = std::thread(&NetIO::loop, this);
+        }
+
+        /* Simulation side. A received packet must be given back with release */
+        bool receive(Packet*& p) noexcept {
+            return m_inbound.pop(p);
+        }
+
+        /* Any thread. Returns nullptr if the pool is exhausted, the caller skips the send */
+        Packet* acquire() noexcept {
+            Packet* p = m_pool.acquire();
+            if (p == nullptr) m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return p;
+        }
+
+        void release(Packet* p) noexcept {
+            m_pool.release(p);
+        }
+
+        /* Simulation side, one producer. Takes a reference on addr, ownership of p moves to the I/O thread */
+        void send(Packet* p, NET_Address* addr, uint16_t port) noexcept {
+            p->addr = NET_RefAddress(addr);
+            p->port = port;
+            if (!m_outbound.push(p)) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                m_pool.release(p);
+            }
+        }
+
+        uint64_t packets_sent() const { return m_sent.load(std::memory_order_relaxed); }
+        uint64_t packets_received() const { return m_received.load(std::memory_order_relaxed); }
+        uint64_t packets_dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    private:
+        void loop() {
+            while (m_running.load(std::memory_order_relaxed)) {
+                flush_outbound();
+
+                void* sockets[] = {m_socket.get()};
+                if (NET_WaitUntilInputAvailable(sockets, 1, POLL_TIMEOUT_MS) > 0) {
+                    drain_inbound();
+                }
+            }
+            /* Whatever was queued before shutdown, like a goodbye, still goes out */
+            flush_outbound();
+        }
+
+        void flush_outbound() {
+            Packet* p;
+            while (m_outbound.pop(p)) {
+                NET_SendDatagram(m_socket.get(), p->addr, p->port, p->data.data(), static_cast<int>(p->len));
+                m_sent.fetch_add(1, std::memory_order_relaxed);
+                m_pool.release(p);
+            }
+        }
+
+        void drain_inbound() {
+            for (std::size_t i = 0; i < RECEIVE_BATCH; ++i) {
+                NETDatagram dgram(m_socket.get());
+                NET_Datagram* d = dgram.get();
+                if (d == nullptr) break;
+
+                if (d->buflen < 1 || static_cast<std::size_t>(d->buflen) > net::MTU) continue;
+                auto type = static_cast<net::MsgType>(d->buf[0]);
+                if (!valid_type(type)) continue;
+
+                Packet* p = acquire();
+                if (p == nullptr) continue;
+
+                p->addr = NET_RefAddress(d->addr);
+                p->port = d->port;
+                p->type = type;
+                p->len = static_cast<std::size_t>(d->buflen);
+                std::copy(d->buf, d->buf + d->buflen, p->data.begin());
+
+                if (!m_inbound.push(p)) {
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    m_pool.release(p);
+                    continue;
+                }
+                m_received.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        static bool valid_type(net::MsgType type) noexcept {
+            return type >= net::MsgType::HELLO && type < net::MsgType::COUNT;
+        }
+
+    private:
+        NETDatagramSocket   m_socket;
+        PacketPool          m_pool;
+
+        SPSCQueue<Packet*, QUEUE_SIZE>  m_inbound;
+        SPSCQueue<Packet*, QUEUE_SIZE>  m_outbound;
+
+        std::thread         m_io_thread;
+        std::atomic<bool>   m_running{false};
+
+        std::atomic<uint64_t>   m_sent{0};
+        std::atomic<uint64_t>   m_received{0};
+        std::atomic<uint64_t>   m_dropped{0};
+};
+
+#endif
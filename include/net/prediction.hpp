@@ -0,0 +1,174 @@
+#ifndef PREDICTION_H
+#define PREDICTION_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <vector>
+
+#include "net/input.hpp"
+#include "net/snapshot.hpp"
+
+#include "entity.hpp"
+#include "physics.hpp"
+#include "vector.hpp"
+
+/*
+ * Client side prediction of the locally controlled bodies. Every input is
+ * applied immediately with the same integration step the server physics uses,
+ * and the outcome is kept per input tick. When the server reports the state of
+ * a body together with the last input it applied, the prediction for that
+ * input is compared against it and only a body that diverged is rewound and
+ * replayed up to the present.
+ *
+ * Bodies are stepped here, synchronously on the world thread, rather than in
+ * the local PhysicsCore thread: a replay has to run inside one frame and
+ * reproduce exactly one integration step per input, which the free running
+ * physics loop does not guarantee.
+ */
+class Prediction {
+    public:
+        /* Two seconds of inputs at 60 Hz, far more than any round trip worth playing on */
+        static constexpr std::size_t HISTORY = 128;
+
+        /* Disagreement, in quantization steps, tolerated before a body is replayed */
+        static constexpr int32_t TOLERANCE = 1;
+
+    public:
+        void control(EntityID eid, const QuantizedState& state) {
+            if (controls(eid)) return;
+
+            ControlledBody body{};
+            body.id = eid;
+            body.pos = quant::position(state);
+            body.speed = quant::speed(state);
+            m_bodies.push_back(body);
+        }
+
+        void release(EntityID eid) {
+            std::erase_if(m_bodies, [eid](const ControlledBody& b) { return b.id == eid; });
+        }
+
+        bool controls(EntityID eid) const {
+            return find(eid) != nullptr;
+        }
+
+        /* Applies a freshly sampled input to every controlled body */
+        void predict(const InputCmd& cmd) {
+            m_inputs[cmd.seq % HISTORY] = cmd;
+            m_last_seq = cmd.seq;
+
+            for (auto& body : m_bodies) {
+                step(body, cmd);
+            }
+        }
+
+        /*
+         * state is the authoritative state of eid after the server applied
+         * input_ack. Returns the number of ticks replayed, 0 if the prediction held.
+         */
+        std::size_t reconcile(EntityID eid, const QuantizedState& state, uint32_t input_ack) {
+            if (static_cast<int32_t>(input_ack - m_acked_seq) > 0) m_acked_seq = input_ack;
+
+            ControlledBody* body = find(eid);
+            if (body == nullptr || input_ack == 0) return 0;
+
+            /* An input we never predicted, or one so old it fell out of the window, is always a divergence */
+            bool in_window = (m_last_seq - input_ack) < HISTORY;
+            const PredictedTick& predicted = body->history[input_ack % HISTORY];
+            if (in_window && predicted.seq == input_ack && matches(predicted, state)) return 0;
+
+            body->pos = quant::position(state);
+            body->speed = quant::speed(state);
+            if (!in_window) return 0;
+
+            std::size_t replayed = 0;
+            for (uint32_t seq = input_ack + 1; static_cast<int32_t>(m_last_seq - seq) >= 0; ++seq) {
+                const InputCmd& cmd = m_inputs[seq % HISTORY];
+                if (cmd.seq != seq) continue;
+                step(*body, cmd);
+                ++replayed;
+            }
+            m_replayed_ticks += replayed;
+            return replayed;
+        }
+
+        /* Inputs the server has not acknowledged yet, oldest first, consecutive */
+        std::size_t unacked_inputs(InputCmd* out, std::size_t max) const {
+            if (m_last_seq == 0) return 0;
+
+            uint32_t first = m_acked_seq + 1;
+            if (m_last_seq - m_acked_seq > max) first = m_last_seq - static_cast<uint32_t>(max) + 1;
+
+            std::size_t count = 0;
+            for (uint32_t seq = first; static_cast<int32_t>(m_last_seq - seq) >= 0; ++seq) {
+                out[count++] = m_inputs[seq % HISTORY];
+            }
+            return count;
+        }
+
+        std::optional<Vector2D<double>> position(EntityID eid) const {
+            const ControlledBody* body = find(eid);
+            if (body == nullptr) return std::nullopt;
+            return body->pos;
+        }
+
+        uint64_t replayed_ticks() const {
+            return m_replayed_ticks;
+        }
+
+    private:
+        struct PredictedTick {
+            uint32_t            seq{0};
+            Vector2D<double>    pos{0,0};
+            Vector2D<double>    speed{0,0};
+        };
+
+        struct ControlledBody {
+            EntityID            id;
+            Vector2D<double>    pos;
+            Vector2D<double>    speed;
+            Vector2D<double>    acc{0,0};
+
+            std::array<PredictedTick, HISTORY>  history;
+        };
+
+    private:
+        static void step(ControlledBody& body, const InputCmd& cmd) noexcept {
+            body.speed = input::velocity(cmd);
+            PhysicsCore::integrate(body.pos, body.speed, body.acc);
+            body.history[cmd.seq % HISTORY] = PredictedTick{cmd.seq, body.pos, body.speed};
+        }
+
+        static bool matches(const PredictedTick& predicted, const QuantizedState& state) noexcept {
+            QuantizedState q = quant::quantize(PhysicsSnapshot{state.id, predicted.pos, predicted.speed, {0,0}, 0, 0});
+            return std::abs(q.px - state.px) <= TOLERANCE && std::abs(q.py - state.py) <= TOLERANCE
+                && std::abs(q.vx - state.vx) <= TOLERANCE && std::abs(q.vy - state.vy) <= TOLERANCE;
+        }
+
+        const ControlledBody* find(EntityID eid) const {
+            for (const auto& body : m_bodies) {
+                if (body.id == eid) return &body;
+            }
+            return nullptr;
+        }
+        ControlledBody* find(EntityID eid) {
+            for (auto& body : m_bodies) {
+                if (body.id == eid) return &body;
+            }
+            return nullptr;
+        }
+
+    private:
+        std::vector<ControlledBody>         m_bodies;
+        std::array<InputCmd, HISTORY>       m_inputs;
+        uint32_t    m_last_seq{0};
+        uint32_t    m_acked_seq{0};
+
+        uint64_t    m_replayed_ticks{0};
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace net {
+    static constexpr uint16_t DEFAULT_PORT = 27015;
+    static constexpr uint16_t PROTOCOL_ID = 0x6765;
+
+    /* Conservative payload size that survives the common path MTU without fragmentation */
+    static constexpr std::size_t MTU = 1200;
+
+    /* A client that has not been heard from for this long is dropped by the server */
+    static constexpr double CLIENT_TIMEOUT = 5.0;
+    static constexpr double HELLO_INTERVAL = 0.5;
+
+    enum class MsgType : uint8_t {
+        HELLO = 1,
+        SNAPSHOT,
+        ACK,
+        BYE,
+        INPUT,
+        CHANNEL,    // ChannelConnection packet, gameplay events on top of the snapshot stream
+
+        COUNT,      // Not a message, one past the last valid type
+    };
+
+    static constexpr unsigned MSG_TYPE_BITS = 8;
+}
+
+#endif
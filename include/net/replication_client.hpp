@@ -0,0 +1,186 @@
+#ifndef REPLICATION_CLIENT_H
+#define REPLICATION_CLIENT_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "net/bitstream.hpp"
+#include "net/channel.hpp"
+#include "net/input.hpp"
+#include "net/net_io.hpp"
+#include "net/protocol.hpp"
+#include "net/snapshot.hpp"
+#include "net/snapshot_receiver.hpp"
+
+#include "RAII/SDL_net.hpp"
+#include "physics.hpp"
+
+/*
+ * Receiving end of ReplicationServer. Every decoded view is acknowledged right
+ * away so the server baseline follows as closely as the round trip allows.
+ *
+ * Gameplay events to and from the server go through a ChannelConnection.
+ */
+class ReplicationClient {
+    public:
+        ReplicationClient(const char* host, uint16_t port)
+            : m_server (resolve(host))
+            , m_port (port)
+            , m_io (NET_CreateDatagramSocket(nullptr, 0))
+        {
+            m_io.run();
+        }
+
+        ~ReplicationClient() {
+            if (resolved()) send_simple(net::MsgType::BYE);
+        }
+
+        ReplicationClient(const ReplicationClient&) = delete;
+        ReplicationClient& operator=(const ReplicationClient&) = delete;
+
+        /* Drains the socket, returns true if a newer view than the last one is available */
+        bool poll() {
+            auto now = std::chrono::steady_clock::now();
+            if (m_receiver.latest_tick() == PhysicsCore::INVALID_TICK && now - m_last_hello > m_hello_interval) {
+                send_simple(net::MsgType::HELLO);
+                m_last_hello = now;
+            }
+
+            bool updated = false;
+            Packet* p;
+            while (m_io.receive(p)) {
+                if (p->port == m_port && NET_CompareAddresses(p->addr, m_server.get()) == 0) {
+                    BitReader r(p->data.data(), p->len);
+                    r.read_bits(net::MSG_TYPE_BITS);
+                    if (p->type == net::MsgType::SNAPSHOT) {
+                        updated |= on_snapshot(r, p->len);
+                    } else if (p->type == net::MsgType::CHANNEL) {
+                        m_channels.read_packet(r, now);
+                    }
+                }
+                m_io.release(p);
+            }
+
+            flush_channel(now);
+            return updated;
+        }
+
+        /* The tick is INVALID_TICK until the first snapshot has been decoded */
+        const SnapshotView& latest_view(uint32_t& tick) const {
+            return m_receiver.latest_view(tick);
+        }
+
+        /* The body the server spawned for us, INVALID_ENTITY until the first snapshot */
+        EntityID avatar() const {
+            return m_receiver.avatar();
+        }
+
+        /* Last input the server had applied to the avatar when it took the latest view */
+        uint32_t input_ack() const {
+            return m_receiver.input_ack();
+        }
+
+        void send_inputs(const InputCmd* cmds, std::size_t count) {
+            Packet* p = m_io.acquire();
+            if (p == nullptr) return;
+
+            BitWriter w(p->data.data(), p->data.size());
+            w.write_bits(static_cast<uint32_t>(net::MsgType::INPUT), net::MSG_TYPE_BITS);
+            input::write(w, cmds, std::min(count, input::MAX_REDUNDANT));
+            p->len = w.flush();
+            m_io.send(p, m_server.get(), m_port);
+        }
+
+        /* False if the message is too large or the channel is saturated */
+        bool send_event(Channel ch, const uint8_t* data, std::size_t len) {
+            return m_channels.send(ch, data, len);
+        }
+
+        bool receive_event(Channel ch, ChannelMessage& out) {
+            return m_channels.receive(ch, out);
+        }
+
+        uint64_t bytes_received() const {
+            return m_bytes_received;
+        }
+
+        /* False if the host could not be resolved, nothing can be sent then */
+        bool resolved() const {
+            return m_server.get() != nullptr;
+        }
+
+    private:
+        static NET_Address* resolve(const char* host) {
+            NET_Address* addr = NET_ResolveHostname(host);
+            if (addr == nullptr || NET_WaitUntilResolved(addr, -1) != NET_SUCCESS) {
+                std::cerr << "[ERROR] ReplicationClient::resolve -> " << host << ": " << SDL_GetError() << std::endl;
+                if (addr != nullptr) NET_UnrefAddress(addr);
+                addr = nullptr;
+            }
+            return addr;
+        }
+
+        bool on_snapshot(BitReader& r, std::size_t len) {
+            if (!m_receiver.receive(r)) return false;
+
+            m_bytes_received += len;
+            send_ack(m_receiver.latest_tick());
+            return true;
+        }
+
+        void flush_channel(std::chrono::steady_clock::time_point now) {
+            if (!m_channels.wants_to_send(now)) return;
+
+            Packet* p = m_io.acquire();
+            if (p == nullptr) return;
+
+            BitWriter w(p->data.data(), p->data.size());
+            w.write_bits(static_cast<uint32_t>(net::MsgType::CHANNEL), net::MSG_TYPE_BITS);
+            m_channels.write_packet(w, now);
+            p->len = w.flush();
+            m_io.send(p, m_server.get(), m_port);
+        }
+
+        void send_simple(net::MsgType type) {
+            Packet* p = m_io.acquire();
+            if (p == nullptr) return;
+
+            BitWriter w(p->data.data(), p->data.size());
+            w.write_bits(static_cast<uint32_t>(type), net::MSG_TYPE_BITS);
+            w.write_bits(net::PROTOCOL_ID, 16);
+            p->len = w.flush();
+            m_io.send(p, m_server.get(), m_port);
+        }
+
+        void send_ack(uint32_t tick) {
+            Packet* p = m_io.acquire();
+            if (p == nullptr) return;
+
+            BitWriter w(p->data.data(), p->data.size());
+            w.write_bits(static_cast<uint32_t>(net::MsgType::ACK), net::MSG_TYPE_BITS);
+            w.write_bits(tick, 32);
+            p->len = w.flush();
+            m_io.send(p, m_server.get(), m_port);
+        }
+
+    private:
+        NETAddress          m_server;
+        uint16_t            m_port;
+        NetIO               m_io;
+        ChannelConnection   m_channels;
+
+        SnapshotReceiver    m_receiver;
+
+        std::chrono::steady_clock::time_point   m_last_hello{};
+        uint64_t    m_bytes_received{0};
+
+        static constexpr std::chrono::steady_clock::duration m_hello_interval =
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>{net::HELLO_INTERVAL}
+            );
+};
+
+#endif
@@ -0,0 +1,480 @@
+#ifndef REPLICATION_SERVER_H
+#define REPLICATION_SERVER_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "net/bitstream.hpp"
+#include "net/channel.hpp"
+#include "net/events.hpp"
+#include "net/input.hpp"
+#include "net/interest.hpp"
+#include "net/net_io.hpp"
+#include "net/protocol.hpp"
+#include "net/snapshot.hpp"
+
+#include "RAII/SDL_net.hpp"
+#include "entity.hpp"
+#include "physics.hpp"
+#include "worker_pool.hpp"
+
+/*
+ * Sends every connected client the physics state as a delta against the last
+ * view that client acknowledged. The view each client holds is mirrored here,
+ * one ring per client, since the per packet budget means a client can trail
+ * the physics ring for entities that did not fit in previous packets.
+ *
+ * Every client also owns an avatar, spawned and despawned through the
+ * callbacks, whose inputs are forwarded one per tick in sequence order.
+ *
+ * A client only receives the bodies within its view radius of the avatar,
+ * found through an InterestGrid shared by all clients, and inside that set the
+ * records compete for the per client byte budget by staleness and distance.
+ * Packets for different clients are built in parallel, straight into pooled
+ * packets that are then queued to the NetIO thread, which owns the socket.
+ *
+ * Gameplay events that must not be lost travel beside the snapshots through
+ * a ChannelConnection per client, addressed by the client's avatar.
+ */
+class ReplicationServer {
+    public:
+        using SpawnFn = std::function<EntityID()>;
+        using DespawnFn = std::function<void(EntityID avatar)>;
+        using InputFn = std::function<void(EntityID avatar, const InputCmd& cmd)>;
+
+    public:
+        ReplicationServer(uint16_t port, SpawnFn spawn, DespawnFn despawn, InputFn input)
+            : m_io (NET_CreateDatagramSocket(nullptr, port))
+            , m_spawn (std::move(spawn))
+            , m_despawn (std::move(despawn))
+            , m_input (std::move(input))
+        {
+            m_io.run();
+        }
+
+        ~ReplicationServer() {
+            for (auto& c : m_clients) m_despawn(c.avatar);
+        }
+
+        ReplicationServer(const ReplicationServer&) = delete;
+        ReplicationServer& operator=(const ReplicationServer&) = delete;
+
+        /*
+         * Called from inside the snapshot read/verify loop, so it may be called
+         * again for the same tick if the physics thread wrapped under us.
+         */
+        void capture(const std::vector<PhysicsSnapshot>& snapshot) {
+            m_current.clear();
+            m_current.reserve(snapshot.size());
+            m_input_acks.clear();
+            for (const auto& snap : snapshot) {
+                m_current.push_back(quant::quantize(snap));
+                if (snap.input_seq != 0) m_input_acks[snap.id] = snap.input_seq;
+            }
+        }
+
+        void update(uint32_t tick) {
+            receive();
+            flush_channels();
+
+            if (tick == PhysicsCore::INVALID_TICK || tick == m_last_tick) return;
+            m_last_tick = tick;
+
+            std::sort(m_current.begin(), m_current.end(),
+                    [](const QuantizedState& a, const QuantizedState& b) { return a.id < b.id; });
+            m_grid.update(m_current);
+
+            auto now = std::chrono::steady_clock::now();
+            for (auto it = m_clients.begin(); it != m_clients.end();) {
+                if (now - it->last_heard > m_timeout) {
+                    m_despawn(it->avatar);
+                    it = m_clients.erase(it);
+                    continue;
+                }
+                dispatch_input(*it);
+                ++it;
+            }
+
+            m_workers.parallel_for(m_clients.size(), [this, tick](std::size_t i) {
+                build_snapshot(m_clients[i], tick);
+            });
+
+            for (auto& client : m_clients) {
+                if (client.packet == nullptr) continue;
+                m_bytes_sent += client.packet->len;
+                m_io.send(client.packet, client.addr.get(), client.port);
+                client.packet = nullptr;
+            }
+        }
+
+        /* Distance around the avatar within which a client is sent bodies */
+        void set_view_radius(double radius) {
+            m_view_radius = radius;
+        }
+
+        /* Bytes of snapshot data each client may receive per tick, at least the snapshot header and at most one MTU */
+        void set_byte_budget(std::size_t bytes) {
+            m_byte_budget = std::clamp(bytes, MIN_BYTE_BUDGET, net::MTU);
+        }
+
+        /* False if there is no such client or its channel is saturated */
+        bool send_event(EntityID avatar, Channel ch, const uint8_t* data, std::size_t len) {
+            for (auto& c : m_clients) {
+                if (c.avatar == avatar) return c.channels->send(ch, data, len);
+            }
+            return false;
+        }
+
+        void broadcast_event(Channel ch, const uint8_t* data, std::size_t len) {
+            for (auto& c : m_clients) c.channels->send(ch, data, len);
+        }
+
+        /* Calls fn(avatar, msg) for every event delivered on ch since the last call */
+        template<typename F>
+        void poll_events(Channel ch, F&& fn) {
+            ChannelMessage msg;
+            for (auto& c : m_clients) {
+                while (c.channels->receive(ch, msg)) fn(c.avatar, msg);
+            }
+        }
+
+        std::size_t num_clients() const {
+            return m_clients.size();
+        }
+
+        /* Work time of one world tick, reported to the clients as ServerStats every STATS_INTERVAL */
+        void record_tick_time(std::chrono::steady_clock::duration work) {
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(work).count();
+            m_tick_us_total += static_cast<uint64_t>(us);
+            m_tick_us_max = std::max(m_tick_us_max, static_cast<uint64_t>(us));
+            ++m_ticks;
+
+            auto now = std::chrono::steady_clock::now();
+            if (m_stats_start == std::chrono::steady_clock::time_point{}) m_stats_start = now;
+            double elapsed = std::chrono::duration<double>(now - m_stats_start).count();
+            if (elapsed < STATS_INTERVAL) return;
+
+            ServerStats stats{};
+            stats.ticks = static_cast<uint32_t>(m_ticks);
+            stats.tick_avg_us = static_cast<uint32_t>(m_tick_us_total / m_ticks);
+            stats.tick_max_us = static_cast<uint32_t>(m_tick_us_max);
+            stats.clients = static_cast<uint16_t>(m_clients.size());
+            stats.checkpoint_max_us = static_cast<uint32_t>(m_checkpoint_us_max);
+            if (!m_clients.empty()) {
+                stats.bytes_per_client = static_cast<uint32_t>(
+                        (m_bytes_sent - m_stats_bytes) / elapsed / m_clients.size());
+            }
+
+            std::array<uint8_t, ChannelMessage::MAX_SIZE> buf;
+            std::size_t len = events::write(buf.data(), stats);
+            if (len > 0) broadcast_event(Channel::UNRELIABLE_SEQUENCED, buf.data(), len);
+
+            m_stats_start = now;
+            m_stats_bytes = m_bytes_sent;
+            m_ticks = 0;
+            m_tick_us_total = 0;
+            m_tick_us_max = 0;
+            m_checkpoint_us_max = 0;
+        }
+
+        /* What taking a checkpoint added to the current tick */
+        void record_checkpoint_time(std::chrono::steady_clock::duration capture) {
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(capture).count();
+            m_checkpoint_us_max = std::max(m_checkpoint_us_max, static_cast<uint64_t>(us));
+        }
+
+        uint64_t bytes_sent() const {
+            return m_bytes_sent;
+        }
+
+    private:
+        struct ClientConnection {
+            ClientConnection(NETAddress addr, uint16_t port, EntityID avatar)
+                : addr (std::move(addr)), port (port), avatar (avatar)
+                , channels (std::make_unique<ChannelConnection>()) {}
+
+            NETAddress  addr;
+            uint16_t    port;
+            uint32_t    acked_tick{PhysicsCore::INVALID_TICK};
+
+            SnapshotRing    views;
+            std::unordered_map<EntityID, uint32_t>  last_sent;     // Tick each entity was last written to this client
+
+            EntityID                avatar;
+            std::deque<InputCmd>    inputs;
+            uint32_t                last_input_seq{0};
+
+            Vector2D<double>        center{0,0};    // Last known avatar position
+
+            /* Boxed, the channel buffers are large and the client vector gets shuffled on erase */
+            std::unique_ptr<ChannelConnection>  channels;
+
+            /* Scratch reused every tick, owned per client so clients can be built in parallel */
+            SnapshotView                    interest;
+            std::vector<SnapshotRecord>     records;
+            SnapshotView                    view;
+            Packet*                         packet{nullptr};
+
+            std::chrono::steady_clock::time_point   last_heard;
+        };
+
+        /* Avatars are spawned per address and port, HELLOs from new ones are ignored past this */
+        static constexpr std::size_t MAX_CLIENTS = 1024;
+
+        /* Inputs queued beyond this are a client running ahead, it is pulled back by dropping the oldest */
+        static constexpr std::size_t MAX_QUEUED_INPUTS = 8;
+
+        static constexpr double DEFAULT_VIEW_RADIUS = 512.0;
+        static constexpr double PRIORITY_SCALE = 1024.0;
+        static constexpr double STATS_INTERVAL = 1.0;
+
+        /* Room for the message type and the snapshot header, select_records budgets the records past them */
+        static constexpr std::size_t MIN_BYTE_BUDGET = (net::MSG_TYPE_BITS + snapshot::HEADER_BITS + 7) / 8;
+
+    private:
+        void receive() {
+            Packet* p;
+            while (m_io.receive(p)) {
+                on_packet(*p);
+                m_io.release(p);
+            }
+        }
+
+        void on_packet(const Packet& p) {
+            BitReader r(p.data.data(), p.len);
+            r.read_bits(net::MSG_TYPE_BITS);
+
+            ClientConnection* client = find_client(p.addr, p.port);
+            switch (p.type) {
+                case net::MsgType::HELLO:
+                    if (r.read_bits(16) != net::PROTOCOL_ID || r.overflowed()) break;
+                    if (client == nullptr) {
+                        if (m_clients.size() >= MAX_CLIENTS) break;
+                        m_clients.emplace_back(NETAddress(NET_RefAddress(p.addr)), p.port, m_spawn());
+                        client = &m_clients.back();
+                    }
+                    client->last_heard = std::chrono::steady_clock::now();
+                    break;
+                case net::MsgType::ACK: {
+                    uint32_t tick = r.read_bits(32);
+                    if (client == nullptr || r.overflowed()) break;
+                    /* Acks can arrive out of order, only ever move the baseline forward */
+                    if (client->views.find(tick) != nullptr &&
+                            static_cast<int32_t>(tick - client->acked_tick) > 0) {
+                        client->acked_tick = tick;
+                    }
+                    client->last_heard = std::chrono::steady_clock::now();
+                    break;
+                }
+                case net::MsgType::INPUT:
+                    if (client == nullptr) break;
+                    on_input(*client, r);
+                    client->last_heard = std::chrono::steady_clock::now();
+                    break;
+                case net::MsgType::CHANNEL:
+                    if (client == nullptr) break;
+                    client->channels->read_packet(r, std::chrono::steady_clock::now());
+                    client->last_heard = std::chrono::steady_clock::now();
+                    break;
+                case net::MsgType::BYE:
+                    if (client != nullptr) {
+                        m_despawn(client->avatar);
+                        m_clients.erase(m_clients.begin() + (client - m_clients.data()));
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        ClientConnection* find_client(NET_Address* addr, uint16_t port) {
+            for (auto& c : m_clients) {
+                if (c.port == port && NET_CompareAddresses(c.addr.get(), addr) == 0) return &c;
+            }
+            return nullptr;
+        }
+
+        /* Inputs are resent until acknowledged, only the ones not seen before are queued */
+        void on_input(ClientConnection& client, BitReader& r) {
+            std::array<InputCmd, input::MAX_REDUNDANT> cmds;
+            std::size_t count = input::read(r, cmds.data());
+
+            for (std::size_t i = 0; i < count; ++i) {
+                if (static_cast<int32_t>(cmds[i].seq - client.last_input_seq) <= 0) continue;
+                client.inputs.push_back(cmds[i]);
+                client.last_input_seq = cmds[i].seq;
+            }
+            while (client.inputs.size() > MAX_QUEUED_INPUTS) client.inputs.pop_front();
+        }
+
+        void dispatch_input(ClientConnection& client) {
+            if (client.inputs.empty()) return;
+            m_input(client.avatar, client.inputs.front());
+            client.inputs.pop_front();
+        }
+
+        void flush_channels() {
+            auto now = std::chrono::steady_clock::now();
+            for (auto& client : m_clients) {
+                if (!client.channels->wants_to_send(now)) continue;
+
+                Packet* p = m_io.acquire();
+                if (p == nullptr) return;
+
+                BitWriter w(p->data.data(), p->data.size());
+                w.write_bits(static_cast<uint32_t>(net::MsgType::CHANNEL), net::MSG_TYPE_BITS);
+                client.channels->write_packet(w, now);
+                p->len = w.flush();
+                m_bytes_sent += p->len;
+                m_io.send(p, client.addr.get(), client.port);
+            }
+        }
+
+        void build_snapshot(ClientConnection& client, uint32_t tick) {
+            static const SnapshotView empty;
+
+            auto avatar_idx = m_grid.index_of(client.avatar);
+            if (avatar_idx.has_value()) client.center = quant::position(m_current[avatar_idx.value()]);
+
+            client.interest.clear();
+            m_grid.query(client.center, m_view_radius, [&](uint32_t idx) {
+                const QuantizedState& state = m_current[idx];
+                if (distance(client.center, state) <= m_view_radius) client.interest.push_back(state);
+            });
+            std::sort(client.interest.begin(), client.interest.end(),
+                    [](const QuantizedState& a, const QuantizedState& b) { return a.id < b.id; });
+
+            SnapshotHeader header{tick, client.acked_tick};
+            const SnapshotView* base = client.views.find(client.acked_tick);
+            if (base == nullptr) {
+                base = &empty;
+                header.baseline_tick = PhysicsCore::INVALID_TICK;
+            }
+
+            header.avatar = client.avatar;
+            auto ack = m_input_acks.find(client.avatar);
+            header.input_ack = (ack == m_input_acks.end()) ? 0 : ack->second;
+
+            client.records.clear();
+            snapshot::diff(*base, client.interest, client.records);
+            select_records(client, tick);
+            header.count = static_cast<uint16_t>(client.records.size());
+
+            Packet* packet = m_io.acquire();
+            if (packet == nullptr) return;
+
+            BitWriter w(packet->data.data(), packet->data.size());
+            w.write_bits(static_cast<uint32_t>(net::MsgType::SNAPSHOT), net::MSG_TYPE_BITS);
+            snapshot::write_header(w, header);
+            snapshot::write_records(w, client.records);
+            if (w.overflowed()) {
+                m_io.release(packet);
+                return;
+            }
+
+            /* Whatever did not fit keeps its baseline value on the client, mirror that */
+            /* The baseline may live in the slot being stored to, build into scratch first */
+            snapshot::apply(*base, client.records, client.view);
+            client.views.store(tick).swap(client.view);
+            for (const auto& rec : client.records) {
+                if (rec.op == SnapshotRecord::REMOVE) client.last_sent.erase(rec.state.id);
+                else client.last_sent[rec.state.id] = tick;
+            }
+
+            packet->len = w.flush();
+            client.packet = packet;
+        }
+
+        static double distance(Vector2D<double> center, const QuantizedState& state) noexcept {
+            Vector2D<double> pos = quant::position(state);
+            return std::hypot(pos.x - center.x, pos.y - center.y);
+        }
+
+        /*
+         * Keeps the records that fit in the budget, highest priority first, and
+         * leaves them sorted by id. Priority grows with the ticks since a body was
+         * last sent and shrinks with its distance, so far bodies still get their
+         * turn, only less often.
+         */
+        void select_records(ClientConnection& client, uint32_t tick) {
+            std::size_t budget = m_byte_budget * 8 - net::MSG_TYPE_BITS - snapshot::HEADER_BITS;
+
+            std::size_t total = 0;
+            for (auto& rec : client.records) {
+                total += rec.bits;
+
+                /* A client predicting its own avatar needs it in every packet to reconcile */
+                if (rec.state.id == client.avatar) {
+                    rec.priority = std::numeric_limits<uint32_t>::max();
+                    continue;
+                }
+
+                auto it = client.last_sent.find(rec.state.id);
+                double staleness = (it == client.last_sent.end()) ? PhysicsCore::NUM_SNAPSHOTS : tick - it->second;
+                double dist = (rec.op == SnapshotRecord::REMOVE) ? 0.0 : distance(client.center, rec.state);
+                rec.priority = static_cast<uint32_t>(std::min(
+                            staleness * PRIORITY_SCALE / (1.0 + dist / InterestGrid::CELL_SIZE),
+                            static_cast<double>(std::numeric_limits<uint32_t>::max() - 1)));
+            }
+            if (total <= budget && client.records.size() <= snapshot::MAX_RECORDS) return;
+
+            auto& records = client.records;
+            std::stable_sort(records.begin(), records.end(),
+                    [](const SnapshotRecord& a, const SnapshotRecord& b) { return a.priority > b.priority; });
+
+            std::size_t used = 0;
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < records.size() && kept < snapshot::MAX_RECORDS; ++i) {
+                if (used + records[i].bits > budget) continue;
+                used += records[i].bits;
+                records[kept++] = records[i];
+            }
+            records.resize(kept);
+
+            std::sort(records.begin(), records.end(),
+                    [](const SnapshotRecord& a, const SnapshotRecord& b) { return a.state.id < b.state.id; });
+        }
+
+    private:
+        NetIO   m_io;
+        std::vector<ClientConnection>   m_clients;
+
+        SpawnFn     m_spawn;
+        DespawnFn   m_despawn;
+        InputFn     m_input;
+
+        SnapshotView    m_current;
+        InterestGrid    m_grid;
+        std::unordered_map<EntityID, uint32_t>  m_input_acks;
+        uint32_t        m_last_tick{PhysicsCore::INVALID_TICK};
+
+        WorkerPool      m_workers;
+
+        double          m_view_radius{DEFAULT_VIEW_RADIUS};
+        std::size_t     m_byte_budget{net::MTU};
+
+        uint64_t    m_bytes_sent{0};
+
+        std::chrono::steady_clock::time_point   m_stats_start{};
+        uint64_t    m_stats_bytes{0};
+        uint64_t    m_ticks{0};
+        uint64_t    m_tick_us_total{0};
+        uint64_t    m_tick_us_max{0};
+        uint64_t    m_checkpoint_us_max{0};
+
+        static constexpr std::chrono::steady_clock::duration m_timeout =
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>{net::CLIENT_TIMEOUT}
+            );
+};
+
+#endif
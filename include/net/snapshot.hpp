@@ -0,0 +1,364 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "net/bitstream.hpp"
+
+#include "entity.hpp"
+#include "physics.hpp"
+#include "vector.hpp"
+
+/*
+ * Fixed point representation of a replicated body. Positions and speeds are
+ * stored with a 1/POS_SCALE resolution, which is well below a pixel and lets
+ * small per-tick deltas fit in a handful of bits.
+ */
+struct QuantizedState {
+    EntityID    id;
+    int32_t     px;
+    int32_t     py;
+    int32_t     vx;
+    int32_t     vy;
+
+    bool same_pos(const QuantizedState& o) const noexcept { return px == o.px && py == o.py; }
+    bool same_speed(const QuantizedState& o) const noexcept { return vx == o.vx && vy == o.vy; }
+};
+
+/* Always sorted by id so that two views can be diffed with a single merge */
+using SnapshotView = std::vector<QuantizedState>;
+
+namespace quant {
+    static constexpr double POS_SCALE = 64.0;
+    static constexpr double SPEED_SCALE = 64.0;
+
+    inline int32_t quantize(double v, double scale) noexcept {
+        double q = std::round(v * scale);
+        q = std::clamp(q,
+                static_cast<double>(std::numeric_limits<int32_t>::min()),
+                static_cast<double>(std::numeric_limits<int32_t>::max()));
+        return static_cast<int32_t>(q);
+    }
+
+    inline double dequantize(int32_t q, double scale) noexcept {
+        return static_cast<double>(q) / scale;
+    }
+
+    inline QuantizedState quantize(const PhysicsSnapshot& snap) noexcept {
+        return QuantizedState{
+            snap.id,
+            quantize(snap.pos.x, POS_SCALE), quantize(snap.pos.y, POS_SCALE),
+            quantize(snap.speed.x, SPEED_SCALE), quantize(snap.speed.y, SPEED_SCALE)
+        };
+    }
+
+    inline Vector2D<double> position(const QuantizedState& s) noexcept {
+        return {dequantize(s.px, POS_SCALE), dequantize(s.py, POS_SCALE)};
+    }
+    inline Vector2D<double> speed(const QuantizedState& s) noexcept {
+        return {dequantize(s.vx, SPEED_SCALE), dequantize(s.vy, SPEED_SCALE)};
+    }
+}
+
+/*
+ * Values are written with a small prefix selecting one of four widths, most
+ * deltas between consecutive ticks land in the 5 bit tier.
+ */
+namespace bitcode {
+    static constexpr std::array<unsigned, 4> TIER_BITS{4, 8, 16, 32};
+    static constexpr std::array<unsigned, 4> TIER_PREFIX_BITS{1, 2, 3, 3};
+    static constexpr std::array<uint32_t, 4> TIER_PREFIX{0b0, 0b01, 0b011, 0b111};
+
+    inline uint32_t zigzag(int32_t v) noexcept {
+        return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+    }
+    inline int32_t unzigzag(uint32_t z) noexcept {
+        return static_cast<int32_t>(z >> 1) ^ -static_cast<int32_t>(z & 1);
+    }
+
+    inline std::size_t tier(uint32_t v) noexcept {
+        for (std::size_t t = 0; t < TIER_BITS.size() - 1; ++t) {
+            if (v < (1u << TIER_BITS[t])) return t;
+        }
+        return TIER_BITS.size() - 1;
+    }
+
+    inline unsigned unsigned_bits(uint32_t v) noexcept {
+        std::size_t t = tier(v);
+        return TIER_PREFIX_BITS[t] + TIER_BITS[t];
+    }
+    inline unsigned signed_bits(int32_t v) noexcept {
+        return unsigned_bits(zigzag(v));
+    }
+
+    inline void write_unsigned(BitWriter& w, uint32_t v) noexcept {
+        std::size_t t = tier(v);
+        w.write_bits(TIER_PREFIX[t], TIER_PREFIX_BITS[t]);
+        w.write_bits(v, TIER_BITS[t]);
+    }
+    inline void write_signed(BitWriter& w, int32_t v) noexcept {
+        write_unsigned(w, zigzag(v));
+    }
+
+    inline uint32_t read_unsigned(BitReader& r) noexcept {
+        std::size_t t = 0;
+        while (t < TIER_BITS.size() - 1 && r.read_bool()) ++t;
+        return r.read_bits(TIER_BITS[t]);
+    }
+    inline int32_t read_signed(BitReader& r) noexcept {
+        return unzigzag(read_unsigned(r));
+    }
+
+    /* Wrapping difference, the receiver adds it back with the same wrapping */
+    inline int32_t delta(int32_t cur, int32_t base) noexcept {
+        return static_cast<int32_t>(static_cast<uint32_t>(cur) - static_cast<uint32_t>(base));
+    }
+    inline int32_t undelta(int32_t base, int32_t d) noexcept {
+        return static_cast<int32_t>(static_cast<uint32_t>(base) + static_cast<uint32_t>(d));
+    }
+}
+
+/* The avatar fields are per client, they tell it which body it predicts and up to which input */
+struct SnapshotHeader {
+    uint32_t    tick;
+    uint32_t    baseline_tick;
+    EntityID    avatar{INVALID_ENTITY};
+    uint32_t    input_ack{0};
+    uint16_t    count{0};
+};
+
+struct SnapshotRecord {
+    enum Op : uint8_t {
+        UPDATE = 0,
+        ADD,
+        REMOVE,
+    } op;
+
+    QuantizedState  state;      // Only the id is meaningful for REMOVE
+    QuantizedState  base{};     // Only meaningful for UPDATE
+
+    uint32_t    priority{0};
+    unsigned    bits{0};        // Upper bound of the encoded size, the id gap is never bigger than the id
+};
+
+namespace snapshot {
+    static constexpr unsigned OP_BITS = 2;
+    static constexpr unsigned HEADER_BITS = 32 + 32 + 32 + 32 + 16;
+    static constexpr std::size_t MAX_RECORDS = std::numeric_limits<uint16_t>::max();
+
+    inline unsigned record_bits(const SnapshotRecord& rec) noexcept {
+        unsigned bits = bitcode::unsigned_bits(rec.state.id) + OP_BITS;
+        switch (rec.op) {
+            case SnapshotRecord::UPDATE:
+                bits += 2;
+                if (!rec.state.same_pos(rec.base)) {
+                    bits += bitcode::signed_bits(bitcode::delta(rec.state.px, rec.base.px));
+                    bits += bitcode::signed_bits(bitcode::delta(rec.state.py, rec.base.py));
+                }
+                if (!rec.state.same_speed(rec.base)) {
+                    bits += bitcode::signed_bits(bitcode::delta(rec.state.vx, rec.base.vx));
+                    bits += bitcode::signed_bits(bitcode::delta(rec.state.vy, rec.base.vy));
+                }
+                break;
+            case SnapshotRecord::ADD:
+                bits += bitcode::signed_bits(rec.state.px) + bitcode::signed_bits(rec.state.py);
+                bits += bitcode::signed_bits(rec.state.vx) + bitcode::signed_bits(rec.state.vy);
+                break;
+            case SnapshotRecord::REMOVE:
+                break;
+        }
+        return bits;
+    }
+
+    /* Appends a record for every entity that differs between two sorted views */
+    inline void diff(const SnapshotView& base, const SnapshotView& cur, std::vector<SnapshotRecord>& out) {
+        auto b = base.begin();
+        auto c = cur.begin();
+        while (b != base.end() || c != cur.end()) {
+            if (c == cur.end() || (b != base.end() && b->id < c->id)) {
+                out.push_back(SnapshotRecord{SnapshotRecord::REMOVE, *b});
+                ++b;
+            } else if (b == base.end() || c->id < b->id) {
+                out.push_back(SnapshotRecord{SnapshotRecord::ADD, *c});
+                ++c;
+            } else {
+                if (!c->same_pos(*b) || !c->same_speed(*b)) {
+                    out.push_back(SnapshotRecord{SnapshotRecord::UPDATE, *c, *b});
+                }
+                ++b;
+                ++c;
+            }
+        }
+        for (auto& rec : out) rec.bits = record_bits(rec);
+    }
+
+    /* Records must be sorted by id. Builds the view the receiver ends up with */
+    inline bool apply(const SnapshotView& base, const std::vector<SnapshotRecord>& records, SnapshotView& out) {
+        out.clear();
+        out.reserve(base.size() + records.size());
+
+        auto b = base.begin();
+        for (const auto& rec : records) {
+            while (b != base.end() && b->id < rec.state.id) out.push_back(*b++);
+
+            bool in_base = (b != base.end() && b->id == rec.state.id);
+            switch (rec.op) {
+                case SnapshotRecord::UPDATE:
+                    if (!in_base) return false;
+                    out.push_back(rec.state);
+                    ++b;
+                    break;
+                case SnapshotRecord::ADD:
+                    if (in_base) return false;
+                    out.push_back(rec.state);
+                    break;
+                case SnapshotRecord::REMOVE:
+                    if (!in_base) return false;
+                    ++b;
+                    break;
+            }
+        }
+        while (b != base.end()) out.push_back(*b++);
+        return true;
+    }
+
+    inline void write_header(BitWriter& w, const SnapshotHeader& h) noexcept {
+        w.write_bits(h.tick, 32);
+        w.write_bits(h.baseline_tick, 32);
+        w.write_bits(h.avatar, 32);
+        w.write_bits(h.input_ack, 32);
+        w.write_bits(h.count, 16);
+    }
+
+    inline void read_header(BitReader& r, SnapshotHeader& h) noexcept {
+        h.tick = r.read_bits(32);
+        h.baseline_tick = r.read_bits(32);
+        h.avatar = r.read_bits(32);
+        h.input_ack = r.read_bits(32);
+        h.count = static_cast<uint16_t>(r.read_bits(16));
+    }
+
+    /* Records must be sorted by id, ids are sent as gaps from the previous one */
+    inline void write_records(BitWriter& w, const std::vector<SnapshotRecord>& records) noexcept {
+        EntityID prev = 0;
+        for (const auto& rec : records) {
+            bitcode::write_unsigned(w, rec.state.id - prev);
+            prev = rec.state.id;
+
+            w.write_bits(rec.op, OP_BITS);
+            switch (rec.op) {
+                case SnapshotRecord::UPDATE: {
+                    bool pos = !rec.state.same_pos(rec.base);
+                    bool speed = !rec.state.same_speed(rec.base);
+                    w.write_bool(pos);
+                    if (pos) {
+                        bitcode::write_signed(w, bitcode::delta(rec.state.px, rec.base.px));
+                        bitcode::write_signed(w, bitcode::delta(rec.state.py, rec.base.py));
+                    }
+                    w.write_bool(speed);
+                    if (speed) {
+                        bitcode::write_signed(w, bitcode::delta(rec.state.vx, rec.base.vx));
+                        bitcode::write_signed(w, bitcode::delta(rec.state.vy, rec.base.vy));
+                    }
+                    break;
+                }
+                case SnapshotRecord::ADD:
+                    bitcode::write_signed(w, rec.state.px);
+                    bitcode::write_signed(w, rec.state.py);
+                    bitcode::write_signed(w, rec.state.vx);
+                    bitcode::write_signed(w, rec.state.vy);
+                    break;
+                case SnapshotRecord::REMOVE:
+                    break;
+            }
+        }
+    }
+
+    /* Decodes count records against the baseline view, false on a malformed packet */
+    inline bool read_records(BitReader& r, const SnapshotView& base, uint16_t count, std::vector<SnapshotRecord>& out) {
+        out.clear();
+        EntityID prev = 0;
+        auto b = base.begin();
+        for (uint16_t i = 0; i < count; ++i) {
+            SnapshotRecord rec{};
+            rec.state.id = prev + bitcode::read_unsigned(r);
+            if (i > 0 && rec.state.id <= prev) return false;
+            prev = rec.state.id;
+
+            uint32_t op = r.read_bits(OP_BITS);
+            switch (op) {
+                case SnapshotRecord::UPDATE: {
+                    while (b != base.end() && b->id < rec.state.id) ++b;
+                    if (b == base.end() || b->id != rec.state.id) return false;
+
+                    rec.op = SnapshotRecord::UPDATE;
+                    rec.base = *b;
+                    rec.state = *b;
+                    if (r.read_bool()) {
+                        rec.state.px = bitcode::undelta(b->px, bitcode::read_signed(r));
+                        rec.state.py = bitcode::undelta(b->py, bitcode::read_signed(r));
+                    }
+                    if (r.read_bool()) {
+                        rec.state.vx = bitcode::undelta(b->vx, bitcode::read_signed(r));
+                        rec.state.vy = bitcode::undelta(b->vy, bitcode::read_signed(r));
+                    }
+                    break;
+                }
+                case SnapshotRecord::ADD:
+                    rec.op = SnapshotRecord::ADD;
+                    rec.state.px = bitcode::read_signed(r);
+                    rec.state.py = bitcode::read_signed(r);
+                    rec.state.vx = bitcode::read_signed(r);
+                    rec.state.vy = bitcode::read_signed(r);
+                    break;
+                case SnapshotRecord::REMOVE:
+                    rec.op = SnapshotRecord::REMOVE;
+                    break;
+                default:
+                    return false;
+            }
+            out.push_back(rec);
+        }
+        return !r.overflowed();
+    }
+}
+
+/*
+ * History of the views exchanged with one peer, indexed by tick the same way
+ * PhysicsCore indexes its snapshot ring so a baseline lives exactly as long as
+ * the physics snapshot of the same tick.
+ */
+class SnapshotRing {
+    public:
+        static constexpr std::size_t SIZE = PhysicsCore::NUM_SNAPSHOTS;
+
+        const SnapshotView* find(uint32_t tick) const noexcept {
+            if (tick == PhysicsCore::INVALID_TICK) return nullptr;
+            const Entry& e = m_entries[tick % SIZE];
+            return (e.tick == tick) ? &e.view : nullptr;
+        }
+
+        /* The returned view is reused storage, the caller overwrites it */
+        SnapshotView& store(uint32_t tick) noexcept {
+            Entry& e = m_entries[tick % SIZE];
+            e.tick = tick;
+            return e.view;
+        }
+
+    private:
+        struct Entry {
+            uint32_t        tick{PhysicsCore::INVALID_TICK};
+            SnapshotView    view;
+        };
+
+    private:
+        std::array<Entry, SIZE> m_entries;
+};
+
+#endif
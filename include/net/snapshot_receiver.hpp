@@ -0,0 +1,80 @@
+#ifndef SNAPSHOT_RECEIVER_H
+#define SNAPSHOT_RECEIVER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "net/bitstream.hpp"
+#include "net/snapshot.hpp"
+
+#include "entity.hpp"
+#include "physics.hpp"
+
+/*
+ * Decoding side of the snapshot stream. Every decoded view is kept in a ring
+ * so that whichever tick the server picks as baseline can be found again.
+ */
+class SnapshotReceiver {
+    public:
+        /* r is positioned after the message type, returns true if a newer view was stored */
+        bool receive(BitReader& r) {
+            SnapshotHeader header{};
+            snapshot::read_header(r, header);
+            if (r.overflowed()) return false;
+
+            uint32_t tick = header.tick;
+
+            /* Stale or duplicated packets are useless, the newer view already supersedes them */
+            if (m_latest_tick != PhysicsCore::INVALID_TICK && static_cast<int32_t>(tick - m_latest_tick) <= 0) {
+                return false;
+            }
+
+            const SnapshotView* base = &m_empty;
+            if (header.baseline_tick != PhysicsCore::INVALID_TICK) {
+                base = m_views.find(header.baseline_tick);
+                if (base == nullptr) return false;
+            }
+
+            if (!snapshot::read_records(r, *base, header.count, m_records)) return false;
+
+            /* The baseline may live in the slot being stored to, decode into scratch first */
+            if (!snapshot::apply(*base, m_records, m_scratch)) return false;
+            m_views.store(tick).swap(m_scratch);
+
+            m_latest_tick = tick;
+            m_avatar = header.avatar;
+            m_input_ack = header.input_ack;
+            return true;
+        }
+
+        /* The tick is INVALID_TICK until the first snapshot has been decoded */
+        const SnapshotView& latest_view(uint32_t& tick) const {
+            tick = m_latest_tick;
+            const SnapshotView* view = m_views.find(m_latest_tick);
+            return view ? *view : m_empty;
+        }
+
+        uint32_t latest_tick() const {
+            return m_latest_tick;
+        }
+
+        EntityID avatar() const {
+            return m_avatar;
+        }
+
+        uint32_t input_ack() const {
+            return m_input_ack;
+        }
+
+    private:
+        SnapshotRing    m_views;
+        uint32_t        m_latest_tick{PhysicsCore::INVALID_TICK};
+        EntityID        m_avatar{INVALID_ENTITY};
+        uint32_t        m_input_ack{0};
+
+        std::vector<SnapshotRecord> m_records;
+        SnapshotView                m_scratch;
+        const SnapshotView          m_empty;
+};
+
+#endif
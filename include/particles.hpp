@@ -0,0 +1,272 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define PARTICLES_SSE 1
+#endif
+
+#include "SDL3/SDL_pixels.h"
+#include "SDL3/SDL_rect.h"
+#include "SDL3/SDL_render.h"
+
+#include "entity.hpp"
+#include "vector.hpp"
+
+/* How an emitter spawns and draws its particles, in pixels and seconds */
+struct ParticleParams {
+    static constexpr uint32_t SOLID = UINT32_MAX;
+
+    uint32_t    capacity{1024};     // Alive at once, spawning waits while full. Fixed once the emitter is first drawn
+    float       rate{100};          // Spawned per second
+    float       life_min{0.5f};
+    float       life_max{1.0f};
+    float       speed_min{20};
+    float       speed_max{60};
+    float       angle{0};           // Of the direction spawned in, in radians
+    float       spread{6.2831853f}; // Around angle, a full turn by default
+    float       gravity_x{0};
+    float       gravity_y{0};
+    float       drag{0};            // Share of the speed lost per second
+    float       size_start{4};
+    float       size_end{1};
+    SDL_FColor  color_start{1, 1, 1, 1};
+    SDL_FColor  color_end{1, 1, 1, 0};
+    uint32_t    atlas{SOLID};       // Sprite::atlas, or plain squares
+    SDL_FRect   uv{0, 0, 0, 0};
+};
+
+/* What the world sends of a ParticleEmitter each tick */
+struct EmitterState {
+    EntityID            id;         // Owner of the emitter
+    Vector2D<double>    pos;
+    ParticleParams      params;
+};
+
+/*
+ * The particles of one emitter as parallel arrays, allocated once for the
+ * capacity rounded up to a whole number of SIMD lanes. Alive particles are
+ * packed at the front: a dead one takes the place of the last, so spawning
+ * reuses the slots at the back and never allocates.
+ */
+class ParticleBuffer {
+    public:
+        static constexpr uint32_t LANES = 4;
+
+        explicit ParticleBuffer(uint32_t capacity)
+        : m_capacity (capacity)
+        {
+            std::size_t padded = (static_cast<std::size_t>(capacity) + LANES - 1) / LANES * LANES;
+            for (auto* a : {&m_x, &m_y, &m_vx, &m_vy, &m_age, &m_aging}) a->assign(padded, 0.0f);
+        }
+
+        uint32_t size() const {
+            return m_count;
+        }
+        bool full() const {
+            return m_count == m_capacity;
+        }
+
+        /* Only when not full */
+        void spawn(float x, float y, float vx, float vy, float life) {
+            uint32_t i = m_count++;
+            m_x[i] = x;
+            m_y[i] = y;
+            m_vx[i] = vx;
+            m_vy[i] = vy;
+            m_age[i] = 0;
+            m_aging[i] = 1.0f / life;
+        }
+
+        /*
+         * Moves every particle and ages it, four at a time. The lanes past the
+         * last alive particle are stepped too, they are free slots and a spawn
+         * overwrites them. Particles at the end of their life are retired after.
+         */
+        void update(float dt, float gravity_x, float gravity_y, float drag) {
+            float damping = std::max(0.0f, 1.0f - drag * dt);
+            std::size_t n = (static_cast<std::size_t>(m_count) + LANES - 1) / LANES * LANES;
+            float* x = m_x.data();
+            float* y = m_y.data();
+            float* vx = m_vx.data();
+            float* vy = m_vy.data();
+            float* age = m_age.data();
+            const float* aging = m_aging.data();
+
+#ifdef PARTICLES_SSE
+            const __m128 step = _mm_set1_ps(dt);
+            const __m128 damp = _mm_set1_ps(damping);
+            const __m128 gx = _mm_set1_ps(gravity_x * dt);
+            const __m128 gy = _mm_set1_ps(gravity_y * dt);
+            for (std::size_t i = 0; i < n; i += LANES) {
+                __m128 sx = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vx + i), gx), damp);
+                __m128 sy = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vy + i), gy), damp);
+                _mm_storeu_ps(vx + i, sx);
+                _mm_storeu_ps(vy + i, sy);
+                _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(sx, step)));
+                _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(sy, step)));
+                _mm_storeu_ps(age + i, _mm_add_ps(_mm_loadu_ps(age + i), _mm_mul_ps(_mm_loadu_ps(aging + i), step)));
+            }
+#else
+            for (std::size_t i = 0; i < n; ++i) {
+                vx[i] = (vx[i] + gravity_x * dt) * damping;
+                vy[i] = (vy[i] + gravity_y * dt) * damping;
+                x[i] += vx[i] * dt;
+                y[i] += vy[i] * dt;
+                age[i] += aging[i] * dt;
+            }
+#endif
+
+            for (uint32_t i = 0; i < m_count;) {
+                if (age[i] < 1.0f) {
+                    ++i;
+                    continue;
+                }
+
+                uint32_t last = --m_count;
+                x[i] = x[last];
+                y[i] = y[last];
+                vx[i] = vx[last];
+                vy[i] = vy[last];
+                age[i] = age[last];
+                m_aging[i] = aging[last];
+            }
+        }
+
+        /* 4 vertices per alive particle into out, sized and colored by its age */
+        void write_quads(SDL_Vertex* out, const ParticleParams& params) const {
+            float u0 = params.uv.x, v0 = params.uv.y, u1 = params.uv.x + params.uv.w, v1 = params.uv.y + params.uv.h;
+            const SDL_FColor& from = params.color_start;
+            const SDL_FColor& to = params.color_end;
+            for (uint32_t i = 0; i < m_count; ++i) {
+                float t = m_age[i];
+                float half = 0.5f * (params.size_start + (params.size_end - params.size_start) * t);
+                SDL_FColor color{
+                    from.r + (to.r - from.r) * t,
+                    from.g + (to.g - from.g) * t,
+                    from.b + (to.b - from.b) * t,
+                    from.a + (to.a - from.a) * t
+                };
+
+                float x0 = m_x[i] - half, y0 = m_y[i] - half, x1 = m_x[i] + half, y1 = m_y[i] + half;
+                out[0] = SDL_Vertex{SDL_FPoint{x0, y0}, color, SDL_FPoint{u0, v0}};
+                out[1] = SDL_Vertex{SDL_FPoint{x1, y0}, color, SDL_FPoint{u1, v0}};
+                out[2] = SDL_Vertex{SDL_FPoint{x1, y1}, color, SDL_FPoint{u1, v1}};
+                out[3] = SDL_Vertex{SDL_FPoint{x0, y1}, color, SDL_FPoint{u0, v1}};
+                out += 4;
+            }
+        }
+
+    private:
+        uint32_t    m_capacity;
+        uint32_t    m_count{0};
+
+        std::vector<float>  m_x;
+        std::vector<float>  m_y;
+        std::vector<float>  m_vx;
+        std::vector<float>  m_vy;
+        std::vector<float>  m_age;      // 0 when spawned, retired at 1
+        std::vector<float>  m_aging;    // 1 / life, per second
+};
+
+/*
+ * Every particle of the emitters the world sent, stepped and drawn on the
+ * render thread only. Particles never become entities: the world only sends
+ * where each emitter is and how it spawns. An emitter the world stopped
+ * sending spawns no more and is dropped once its last particle died.
+ */
+class ParticleSystem {
+    public:
+        void update(std::span<const EmitterState> states, float dt) {
+            for (auto& emitter : m_emitters) emitter.live = false;
+            for (const EmitterState& state : states) {
+                auto it = m_lookup.find(state.id);
+                if (it == m_lookup.end()) {
+                    it = m_lookup.emplace(state.id, m_emitters.size()).first;
+                    m_emitters.push_back(Emitter{state.id, state.params, state.pos, ParticleBuffer(state.params.capacity)});
+                }
+
+                Emitter& emitter = m_emitters[it->second];
+                emitter.params = state.params;
+                emitter.pos = state.pos;
+                emitter.live = true;
+            }
+
+            m_alive = 0;
+            for (std::size_t i = 0; i < m_emitters.size();) {
+                Emitter& emitter = m_emitters[i];
+                if (emitter.live) spawn(emitter, dt);
+
+                const ParticleParams& p = emitter.params;
+                emitter.particles.update(dt, p.gravity_x, p.gravity_y, p.drag);
+                if (emitter.live || emitter.particles.size() != 0) {
+                    m_alive += emitter.particles.size();
+                    ++i;
+                    continue;
+                }
+
+                m_lookup.erase(emitter.id);
+                if (i != m_emitters.size() - 1) {
+                    std::swap(m_emitters[i], m_emitters.back());
+                    m_lookup[m_emitters[i].id] = i;
+                }
+                m_emitters.pop_back();
+            }
+        }
+
+        /* Particles alive after the last update */
+        std::size_t size() const {
+            return m_alive;
+        }
+
+        /* fn(const ParticleParams&, const ParticleBuffer&) for each emitter with particles */
+        template<typename F>
+        void for_each(F&& fn) const {
+            for (const auto& emitter : m_emitters) {
+                if (emitter.particles.size() != 0) fn(emitter.params, emitter.particles);
+            }
+        }
+
+    private:
+        struct Emitter {
+            EntityID            id;
+            ParticleParams      params;
+            Vector2D<double>    pos;
+            ParticleBuffer      particles;
+            float               pending{0};     // Fraction of a particle owed by the rate
+            bool                live{true};     // Sent by the world this frame
+        };
+
+        void spawn(Emitter& emitter, float dt) {
+            const ParticleParams& p = emitter.params;
+            emitter.pending += p.rate * dt;
+
+            std::uniform_real_distribution<float> life(p.life_min, std::max(p.life_min, p.life_max));
+            std::uniform_real_distribution<float> speed(p.speed_min, std::max(p.speed_min, p.speed_max));
+            std::uniform_real_distribution<float> angle(p.angle - 0.5f * p.spread, p.angle + 0.5f * p.spread);
+            float x = static_cast<float>(emitter.pos.x), y = static_cast<float>(emitter.pos.y);
+            for (; emitter.pending >= 1.0f && !emitter.particles.full(); emitter.pending -= 1.0f) {
+                float a = angle(m_rng), s = speed(m_rng);
+                emitter.particles.spawn(x, y, std::cos(a) * s, std::sin(a) * s, std::max(life(m_rng), 1e-3f));
+            }
+            /* What could not spawn while full is dropped, not saved up for a burst */
+            emitter.pending = std::min(emitter.pending, 1.0f);
+        }
+
+    private:
+        std::vector<Emitter>                        m_emitters;
+        std::unordered_map<EntityID, std::size_t>   m_lookup;       // Into m_emitters
+        std::size_t                                 m_alive{0};
+        std::minstd_rand                            m_rng;
+};
+
+#endif
@@ -5,6 +5,10 @@
 #include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <span>
+#include <stdexcept>
 #include <utility>
 #include <vector>
 #include <unordered_map>
@@ -13,38 +17,159 @@
 
 #include "containers/mpsc.hpp"
 
+#include "contact_solver.hpp"
 #include "entity.hpp"
+#include "recording.hpp"
 #include "vector.hpp"
 
 struct PhysicsSnapshot {
     EntityID    id;
     Vector2D<double>    pos;
     Vector2D<double>    speed;
+    Vector2D<double>    acc;
 
     std::size_t transform_idx;
+    uint32_t    input_seq;      // Last client input applied to the body, 0 if it is not player controlled
+    Collider    collider{};
 };
 
 class PhysicsCore {
     public:
         static constexpr size_t INVALID_TICK = 0;
+        static constexpr size_t NUM_SNAPSHOTS = 64;
+
+        struct PhysicsData {
+            Vector2D<double>    pos;
+            Vector2D<double>    speed;
+            Vector2D<double>    acc;
+            Collider            collider{};
+        };
 
+        /* Every body as the parallel arrays the physics thread steps, all of the same length */
+        struct BodyArrays {
+            uint32_t                        tick;
+            std::span<const PhysicsData>    data;
+            std::span<const std::size_t>    transforms;
+            std::span<const uint32_t>       input_seqs;
+            std::span<const EntityID>       ids;
+        };
 
     public:
         PhysicsCore() = default;
         ~PhysicsCore() {
+            stop();
+        }
+
+        void stop() {
             m_running.store(false, std::memory_order_relaxed);
             if (m_physics_thread.joinable()) m_physics_thread.join();
+
+            /* What is still queued is applied by the next bodies(), record it as belonging to the next tick */
+            if (m_record != nullptr) {
+                process_physics_msg();
+                m_record->flush(m_tick);
+                m_record = nullptr;
+            }
+        }
+
+        /* Records every message as it is applied until the next stop(), only while stopped */
+        void record(Recorder::Stream* stream) {
+            m_record = stream;
+        }
+
+        /* The next tick to be stepped, only while the physics thread is stopped */
+        uint32_t tick() const {
+            return m_tick;
+        }
+
+        /*
+         * Replay counterpart of a tick of the physics thread, on the calling
+         * thread and without pacing. The messages recorded for this tick are
+         * applied instead of the queued ones, which are the replayed world
+         * sending again what the recording already holds. Returns false, with
+         * nothing stepped, once the recording runs out.
+         */
+        bool replay_step(recording::Cursor& records) {
+            PhysicsMsg queued;
+            while (m_msg.dequeue(queued)) {}
+
+            recording::Record rec;
+            while (records.next(m_tick, rec)) {
+                apply_recorded(rec);
+            }
+            if (m_tick >= records.end_tick()) return false;
+
+            update_state();
+            publish_snapshot();
+            ++m_tick;
+            return true;
+        }
+
+        /* Only while the physics thread is stopped, messages still queued are applied first */
+        BodyArrays bodies() {
+            process_physics_msg();
+            return BodyArrays{m_tick, m_data, m_transforms, m_input_seqs, m_ids};
+        }
+
+        /*
+         * Replaces every body with a bulk copy of arrays, only while the physics
+         * thread is stopped. Messages still queued refer to the bodies being
+         * replaced, they are applied first so none of them leaks into the new state.
+         */
+        void restore(const BodyArrays& arrays) {
+            process_physics_msg();
+
+            m_tick = arrays.tick;
+            m_data.assign(arrays.data.begin(), arrays.data.end());
+            m_transforms.assign(arrays.transforms.begin(), arrays.transforms.end());
+            m_input_seqs.assign(arrays.input_seqs.begin(), arrays.input_seqs.end());
+            m_ids.assign(arrays.ids.begin(), arrays.ids.end());
+
+            m_lookup.clear();
+            m_lookup.reserve(m_ids.size());
+            for (std::size_t i = 0; i < m_ids.size(); ++i) {
+                m_lookup.emplace(m_ids[i], i);
+            }
+
+            /* Published snapshots describe the old state, start over as if nothing was ever published */
+            m_last_snapshot_idx.store(NUM_SNAPSHOTS, std::memory_order_release);
+            m_oldest_snapshot_idx.store(0, std::memory_order_release);
+            for (auto& entry : m_snapshots) {
+                entry.tick.store(INVALID_TICK, std::memory_order_relaxed);
+            }
         }
 
         void add_physics_entity(EntityID eid, std::size_t transform_idx,
-                Vector2D<double> pos, Vector2D<double> speed, Vector2D<double> acc) {
-            m_msg.enqueue(PhysicsMsg{PhysicsMsg::ADD, eid, transform_idx, PhysicsData{pos, speed, acc}});
+                Vector2D<double> pos, Vector2D<double> speed, Vector2D<double> acc, Collider collider = {}) {
+            m_msg.enqueue(PhysicsMsg{PhysicsMsg::ADD, eid, transform_idx, PhysicsData{pos, speed, acc, collider}});
         }
 
         void del_physics_entity(EntityID eid) {
             m_msg.enqueue(PhysicsMsg{PhysicsMsg::DEL, eid});
         }
 
+        /* The Transform of the body moved to another index of its pool */
+        void move_transform(EntityID eid, std::size_t transform_idx) {
+            m_msg.enqueue(PhysicsMsg{PhysicsMsg::SWAP, eid, transform_idx});
+        }
+
+        /* Overrides the speed of a player controlled body and records which input did it */
+        void apply_input(EntityID eid, Vector2D<double> speed, uint32_t input_seq) {
+            m_msg.enqueue(PhysicsMsg{PhysicsMsg::INPUT, eid, 0, PhysicsData{{0,0}, speed, {0,0}}, input_seq});
+        }
+
+        /*
+         * A single integration step. Anything that has to reproduce the simulation
+         * outside of the physics thread, like client side prediction, goes through
+         * here so a replayed tick matches the authoritative one bit for bit. The
+         * physics thread solves contacts between its two halves, bodies that touch
+         * something are not reproduced by it.
+         */
+        static void integrate(Vector2D<double>& pos, Vector2D<double>& speed, const Vector2D<double>& acc) noexcept {
+            speed += acc * m_dt;
+            pos += speed * m_dt;
+        }
+
         bool verify_snapshot_valid(uint32_t tick) {
             size_t idx = tick % NUM_SNAPSHOTS;
             
@@ -57,6 +182,49 @@ class PhysicsCore {
             m_physics_thread = std::thread(&PhysicsCore::loop, this);
         }
 
+        /* Threads the contact solver uses besides the physics thread, only while the physics thread is stopped */
+        void set_solver_workers(std::size_t num_workers) {
+            m_solver.set_workers(num_workers);
+        }
+
+        const ContactSolver& solver() const {
+            return m_solver;
+        }
+
+        /* Advances n ticks on the calling thread as fast as it goes, only while the physics thread is stopped */
+        void step(uint32_t n = 1) {
+            for (uint32_t i = 0; i < n; ++i) {
+                advance();
+            }
+        }
+
+        /*
+         * Keeps the snapshot of tick readable from any thread, and its memory
+         * untouched, until unpin(). If the ring wraps onto it in the meantime the
+         * physics thread moves it aside instead of overwriting it. Only one
+         * snapshot can be pinned at a time, fails if tick is no longer in the ring.
+         */
+        bool pin(uint32_t tick, std::span<const PhysicsSnapshot>& out) {
+            std::lock_guard<std::mutex> lock(m_pin_mutex);
+            if (m_pinned != INVALID_TICK) return false;
+
+            SnapshotEntry& entry = m_snapshots[tick % NUM_SNAPSHOTS];
+            if (entry.tick.load(std::memory_order_acquire) != tick) return false;
+
+            m_pinned = tick;
+            out = entry.snapshot;
+            return true;
+        }
+
+        void unpin() {
+            std::vector<PhysicsSnapshot> retired;
+            {
+                std::lock_guard<std::mutex> lock(m_pin_mutex);
+                m_pinned = INVALID_TICK;
+                retired.swap(m_retired);
+            }
+        }
+
         /*
          * The returned value is a REFERENCE, meaning that it's up to the caller to
          * verify, after doing the needed operations, that the returned tick version
@@ -78,22 +246,18 @@ class PhysicsCore {
         }
 
     private:
-        struct PhysicsData {
-            Vector2D<double>    pos;
-            Vector2D<double>    speed;
-            Vector2D<double>    acc;
-        };
-
         struct PhysicsMsg {
             enum MsgType {
                 ADD = 0,
                 DEL,
                 SWAP,
+                INPUT,
             } type;
 
             EntityID    id;
             std::size_t transform_idx{0};
             PhysicsData data{};
+            uint32_t    input_seq{0};
         };
 
         struct SnapshotEntry {
@@ -105,6 +269,7 @@ class PhysicsCore {
         void process_physics_msg() {
             PhysicsMsg msg;
             while (m_msg.dequeue(msg)) {
+                if (m_record != nullptr) record_msg(msg);
                 switch (msg.type) {
                     case PhysicsMsg::ADD:
                         on_add(msg.id, msg.transform_idx, msg.data);
@@ -113,15 +278,70 @@ class PhysicsCore {
                         on_del(msg.id);
                         break;
                     case PhysicsMsg::SWAP:
+                        on_swap(msg.id, msg.transform_idx);
+                        break;
+                    case PhysicsMsg::INPUT:
+                        on_input(msg.id, msg.data.speed, msg.input_seq);
                         break;
                 }
             }
         }
 
+        void record_msg(const PhysicsMsg& msg) {
+            switch (msg.type) {
+                case PhysicsMsg::ADD:
+                    m_record->record(m_tick, recording::PHYSICS_ADD, msg.id, static_cast<uint64_t>(msg.transform_idx), msg.data);
+                    break;
+                case PhysicsMsg::DEL:
+                    m_record->record(m_tick, recording::PHYSICS_DEL, msg.id);
+                    break;
+                case PhysicsMsg::SWAP:
+                    m_record->record(m_tick, recording::PHYSICS_SWAP, msg.id, static_cast<uint64_t>(msg.transform_idx));
+                    break;
+                case PhysicsMsg::INPUT:
+                    m_record->record(m_tick, recording::PHYSICS_INPUT, msg.id, msg.data.speed, msg.input_seq);
+                    break;
+            }
+        }
+
+        void apply_recorded(const recording::Record& rec) {
+            EntityID eid;
+            uint64_t transform_idx;
+            PhysicsData data;
+            Vector2D<double> speed;
+            uint32_t input_seq;
+
+            bool ok = false;
+            switch (rec.kind) {
+                case recording::PHYSICS_ADD:
+                    ok = rec.read(eid, transform_idx, data);
+                    if (ok) on_add(eid, static_cast<std::size_t>(transform_idx), data);
+                    break;
+                case recording::PHYSICS_DEL:
+                    ok = rec.read(eid);
+                    if (ok) on_del(eid);
+                    break;
+                case recording::PHYSICS_INPUT:
+                    ok = rec.read(eid, speed, input_seq);
+                    if (ok) on_input(eid, speed, input_seq);
+                    break;
+                case recording::PHYSICS_SWAP:
+                    ok = rec.read(eid, transform_idx);
+                    if (ok) on_swap(eid, static_cast<std::size_t>(transform_idx));
+                    break;
+            }
+
+            if (!ok) {
+                std::cerr << "[ERROR] PhysicsCore::apply_recorded -> Malformed record at tick " << rec.tick << std::endl;
+                throw std::runtime_error("Malformed recording");
+            }
+        }
+
         void on_add(EntityID eid, std::size_t transform_idx, const PhysicsData& data) {
             if (m_lookup.find(eid) == m_lookup.end()) {
                 m_ids.push_back(eid);
                 m_transforms.push_back(transform_idx);
+                m_input_seqs.push_back(0);
                 m_data.push_back(data);
                 m_lookup.emplace(eid, m_ids.size()-1);
             }
@@ -136,19 +356,38 @@ class PhysicsCore {
             if (idx != last) {
                 std::swap(m_data[idx], m_data[last]);
                 std::swap(m_transforms[idx], m_transforms[last]);
+                std::swap(m_input_seqs[idx], m_input_seqs[last]);
                 std::swap(m_ids[idx], m_ids[last]);
                 m_lookup[m_ids[idx]] = idx;
             }
 
             m_data.pop_back();
             m_transforms.pop_back();
+            m_input_seqs.pop_back();
             m_ids.pop_back();
             m_lookup.erase(it);
         }
+        void on_swap(EntityID eid, std::size_t transform_idx) {
+            auto it = m_lookup.find(eid);
+            if (it == m_lookup.end()) return;
+
+            m_transforms[it->second] = transform_idx;
+        }
+        void on_input(EntityID eid, Vector2D<double> speed, uint32_t input_seq) {
+            auto it = m_lookup.find(eid);
+            if (it == m_lookup.end()) return;
+
+            m_data[it->second].speed = speed;
+            m_input_seqs[it->second] = input_seq;
+        }
 
+        /* integrate() split in two around the contact solver, the same operations in the same order */
         void update_state() {
             for (auto& d : m_data) {
                 d.speed += d.acc * m_dt;
+            }
+            m_solver.solve(std::span<PhysicsData>(m_data), m_dt);
+            for (auto& d : m_data) {
                 d.pos += d.speed * m_dt;
             }
         }
@@ -166,24 +405,37 @@ class PhysicsCore {
                 m_oldest_snapshot_idx.store((idx+1) % NUM_SNAPSHOTS, std::memory_order_release);
             }
 
-            m_snapshots[idx].tick.store(m_tick, std::memory_order_release);
-            
+            /* The tick is replaced under the pin lock, so a pin either sees the old tick and gets retired here or fails */
+            {
+                std::lock_guard<std::mutex> lock(m_pin_mutex);
+                if (m_pinned != INVALID_TICK && m_snapshots[idx].tick.load(std::memory_order_relaxed) == m_pinned) {
+                    m_retired.swap(m_snapshots[idx].snapshot);
+                }
+                m_snapshots[idx].tick.store(m_tick, std::memory_order_release);
+            }
+
             m_snapshots[idx].snapshot.resize(m_data.size());
             for (size_t i = 0; i < m_data.size(); ++i) {
-                m_snapshots[idx].snapshot[i] = PhysicsSnapshot{m_ids[i], m_data[i].pos, m_data[i].speed, m_transforms[i]};
+                m_snapshots[idx].snapshot[i] = PhysicsSnapshot{m_ids[i], m_data[i].pos, m_data[i].speed, m_data[i].acc, m_transforms[i], m_input_seqs[i], m_data[i].collider};
             }
 
             m_last_snapshot_idx.store(idx, std::memory_order_release);
         }
 
+        void advance() {
+            process_physics_msg();
+            update_state();
+            publish_snapshot();
+
+            ++m_tick;
+            if (m_record != nullptr) m_record->tick(m_tick);
+        }
+
         void loop() {
             auto next = std::chrono::steady_clock::now();
             while (m_running.load(std::memory_order_relaxed)) {
-                process_physics_msg();
-                update_state();
-                publish_snapshot();
+                advance();
 
-                ++m_tick;
                 next += m_period;
                 std::this_thread::sleep_until(next);
             }
@@ -194,18 +446,24 @@ class PhysicsCore {
 
         std::vector<PhysicsData>    m_data;
         std::vector<std::size_t>    m_transforms;
+        std::vector<uint32_t>       m_input_seqs;
         std::vector<EntityID>       m_ids;      // Keep entity id and data separate for SIMD performance
         std::unordered_map<EntityID, size_t>    m_lookup;
+        ContactSolver               m_solver;
 
-        static constexpr size_t NUM_SNAPSHOTS = 64;
         std::array<SnapshotEntry, NUM_SNAPSHOTS> m_snapshots;
         std::atomic<size_t> m_last_snapshot_idx{NUM_SNAPSHOTS};     // Default to an invalid value
         std::atomic<size_t> m_oldest_snapshot_idx{0};
 
+        std::mutex      m_pin_mutex;
+        uint32_t        m_pinned{INVALID_TICK};
+        std::vector<PhysicsSnapshot>    m_retired;      // A pinned snapshot the ring wrapped onto
+
         std::thread         m_physics_thread;
         std::atomic<bool>   m_running;
                                 
         MPSCQueue<PhysicsMsg>   m_msg;
+        Recorder::Stream*       m_record{nullptr};     // Physics thread only while running
 
         static constexpr double m_dt = 1.0 / 60.0;
         
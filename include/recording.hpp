@@ -0,0 +1,355 @@
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "RAII/mapped_file.hpp"
+#include "save.hpp"
+
+/*
+ * Session recording for deterministic replay. Each producer thread appends
+ * tick tagged records to its own stream, the streams are handed over in
+ * chunks and interleaved in the file as they fill up:
+ *
+ *   FileHeader | Chunk | Chunk | ...
+ *   Chunk = ChunkHeader | (RecordHeader | payload)[...]
+ *
+ * A chunk header carries the producer tick it was handed over at, every
+ * record of that stream tagged before it is in the chunk or an earlier one.
+ * A session cut short by a crash therefore replays up to its last complete
+ * chunk, at most FLUSH_TICKS behind.
+ *
+ * The world state the session starts from is written next to the recording,
+ * at initial_state_path(), as a regular save file.
+ */
+namespace recording {
+    static constexpr uint32_t MAGIC = 0x43524547;           // "GERC"
+    static constexpr uint32_t CHUNK_MAGIC = 0x4b4e4843;     // "CHNK"
+    static constexpr uint16_t VERSION = 2;
+
+    static constexpr std::size_t CHUNK_BYTES = 64 * 1024;
+    static constexpr uint32_t FLUSH_TICKS = 60;
+
+    enum StreamId : uint32_t {
+        PHYSICS = 0,        // Every PhysicsMsg, tagged with the tick that applied it
+        WORLD,              // Structural World changes and snapshot reads, tagged with the tick last read
+
+        NUM_STREAMS,
+    };
+
+    enum Kind : uint8_t {
+        PHYSICS_ADD = 1,
+        PHYSICS_DEL,
+        PHYSICS_INPUT,
+        PHYSICS_SWAP,
+
+        WORLD_TICK = 0x10,  // The world read the snapshot of the tick
+        WORLD_CREATE,
+        WORLD_ADD,
+        WORLD_REMOVE,
+    };
+
+    struct FileHeader {
+        uint32_t    magic;
+        uint16_t    version;
+        uint16_t    endian_mark;
+    };
+
+    struct ChunkHeader {
+        uint32_t    magic;
+        uint32_t    stream;
+        uint32_t    size;       // Records only, header excluded
+        uint32_t    tick;
+    };
+
+    struct RecordHeader {
+        uint32_t    tick;
+        uint8_t     kind;
+        uint8_t     reserved;
+        uint16_t    size;
+    };
+
+    inline std::string initial_state_path(const char* path) {
+        return std::string(path) + ".sav";
+    }
+
+    /* A record in place inside the mapped file, its fields are read back in the order they were recorded */
+    class Record {
+        public:
+            uint32_t    tick{0};
+            uint8_t     kind{0};
+
+            Record() = default;
+            Record(uint32_t tick, uint8_t kind, std::span<const uint8_t> payload)
+                : tick (tick), kind (kind), m_payload (payload) {}
+
+            /* False if the payload does not hold exactly the fields asked for */
+            template<typename... Fields>
+            bool read(Fields&... fields) const {
+                static_assert((std::is_trivially_copyable_v<Fields> && ...), "Fields are read as raw memory");
+                if ((sizeof(Fields) + ... + 0) != m_payload.size()) return false;
+
+                std::size_t offset = 0;
+                ((std::memcpy(&fields, m_payload.data() + offset, sizeof(Fields)), offset += sizeof(Fields)), ...);
+                return true;
+            }
+
+            /* The first field alone, to tell what the rest of the payload is */
+            template<typename Field>
+            bool peek(Field& field) const {
+                static_assert(std::is_trivially_copyable_v<Field>, "Fields are read as raw memory");
+                if (sizeof(Field) > m_payload.size()) return false;
+                std::memcpy(&field, m_payload.data(), sizeof(Field));
+                return true;
+            }
+
+        private:
+            std::span<const uint8_t>    m_payload;
+    };
+
+    /* Walks the records of one stream across its chunks, in recording order */
+    class Cursor {
+        public:
+            Cursor(std::vector<std::span<const uint8_t>> chunks, uint32_t end_tick)
+                : m_chunks (std::move(chunks)), m_end_tick (end_tick) {}
+
+            bool next(Record& out) {
+                return next(UINT32_MAX, out);
+            }
+
+            /* Only hands out the next record if it is tagged up to tick */
+            bool next(uint32_t tick, Record& out) {
+                while (m_chunk < m_chunks.size() && m_offset >= m_chunks[m_chunk].size()) {
+                    ++m_chunk;
+                    m_offset = 0;
+                }
+                if (m_chunk == m_chunks.size()) return false;
+
+                std::span<const uint8_t> chunk = m_chunks[m_chunk];
+                RecordHeader header{};
+                if (chunk.size() - m_offset < sizeof(header)) fail();
+                std::memcpy(&header, chunk.data() + m_offset, sizeof(header));
+                if (header.tick > tick) return false;
+                if (chunk.size() - m_offset - sizeof(header) < header.size) fail();
+
+                out = Record(header.tick, header.kind, chunk.subspan(m_offset + sizeof(header), header.size));
+                m_offset += sizeof(header) + header.size;
+                return true;
+            }
+
+            /* Every record tagged before this tick has been recorded */
+            uint32_t end_tick() const {
+                return m_end_tick;
+            }
+
+        private:
+            [[noreturn]] static void fail() {
+                std::cerr << "[ERROR] recording::Cursor::next -> Record overruns its chunk" << std::endl;
+                throw std::runtime_error("Malformed recording");
+            }
+
+        private:
+            std::vector<std::span<const uint8_t>>   m_chunks;
+            std::size_t     m_chunk{0};
+            std::size_t     m_offset{0};
+            uint32_t        m_end_tick;
+    };
+
+    /* Maps a recording and indexes its chunks, a torn chunk at the end is ignored */
+    class Reader {
+        public:
+            explicit Reader(const char* path) : m_file (path) {
+                FileHeader header{};
+                if (m_file.size() < sizeof(header)) fail("File too small");
+                std::memcpy(&header, m_file.data(), sizeof(header));
+                if (header.magic != MAGIC) fail("Not a recording");
+                if (header.endian_mark != save::ENDIAN_MARK) fail("Recorded with a different byte order");
+                if (header.version != VERSION) fail("Unsupported version");
+
+                uint64_t offset = sizeof(header);
+                while (m_file.size() - offset >= sizeof(ChunkHeader)) {
+                    ChunkHeader chunk{};
+                    std::memcpy(&chunk, m_file.data() + offset, sizeof(chunk));
+                    offset += sizeof(chunk);
+                    if (chunk.magic != CHUNK_MAGIC || chunk.stream >= NUM_STREAMS || chunk.size > m_file.size() - offset) break;
+
+                    m_chunks[chunk.stream].emplace_back(m_file.data() + offset, chunk.size);
+                    m_end_ticks[chunk.stream] = chunk.tick;
+                    offset += chunk.size;
+                }
+            }
+
+            Reader(const Reader&) = delete;
+            Reader& operator=(const Reader&) = delete;
+
+            Cursor cursor(StreamId stream) const {
+                return Cursor(m_chunks[stream], m_end_ticks[stream]);
+            }
+
+        private:
+            [[noreturn]] static void fail(const char* what) {
+                std::cerr << "[ERROR] recording::Reader -> " << what << std::endl;
+                throw std::runtime_error("Failed to read recording");
+            }
+
+        private:
+            MappedFile  m_file;
+            std::vector<std::span<const uint8_t>>   m_chunks[NUM_STREAMS];
+            uint32_t    m_end_ticks[NUM_STREAMS]{};
+    };
+}
+
+/*
+ * Writes a recording in the background. Producers only append to the buffer
+ * of their own stream, the file is written by the recorder thread.
+ */
+class Recorder {
+    public:
+        /* Single producer, only ever used from one thread at a time */
+        class Stream {
+            public:
+                Stream(Recorder& owner, recording::StreamId id) : m_owner (owner), m_id (id) {}
+
+                template<typename... Fields>
+                void record(uint32_t tick, recording::Kind kind, const Fields&... fields) {
+                    static_assert((std::is_trivially_copyable_v<Fields> && ...), "Fields are recorded as raw memory");
+                    recording::RecordHeader header{tick, kind, 0, static_cast<uint16_t>((sizeof(Fields) + ... + 0))};
+                    append(&header, sizeof(header));
+                    (append(&fields, sizeof(Fields)), ...);
+
+                    if (m_buf.size() >= recording::CHUNK_BYTES) flush(tick);
+                }
+
+                /* Once per producer tick, hands the records over every FLUSH_TICKS ticks even if there are none */
+                void tick(uint32_t now) {
+                    if (now - m_flushed_at >= recording::FLUSH_TICKS) flush(now);
+                }
+
+                void flush(uint32_t now) {
+                    m_owner.submit(m_id, now, std::move(m_buf));
+                    m_buf.clear();
+                    m_flushed_at = now;
+                }
+
+            private:
+                void append(const void* data, std::size_t len) {
+                    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+                    m_buf.insert(m_buf.end(), bytes, bytes + len);
+                }
+
+            private:
+                Recorder&               m_owner;
+                recording::StreamId     m_id;
+                std::vector<uint8_t>    m_buf;
+                uint32_t                m_flushed_at{0};
+        };
+
+    public:
+        explicit Recorder(const char* path)
+            : m_path (path)
+            , m_out (path, std::ios::binary | std::ios::trunc)
+            , m_streams {Stream(*this, recording::PHYSICS), Stream(*this, recording::WORLD)}
+        {
+            if (!m_out) {
+                std::cerr << "[ERROR] Recorder::Recorder -> Could not open " << path << std::endl;
+                throw std::runtime_error("Failed to open recording");
+            }
+
+            recording::FileHeader header{recording::MAGIC, recording::VERSION, save::ENDIAN_MARK};
+            m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+            m_running = true;
+            m_thread = std::thread(&Recorder::loop, this);
+        }
+
+        /* Writes out every chunk handed over, the producers have to flush their streams before */
+        ~Recorder() {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_running = false;
+            }
+            m_wake.notify_one();
+            if (m_thread.joinable()) m_thread.join();
+        }
+
+        Recorder(const Recorder&) = delete;
+        Recorder& operator=(const Recorder&) = delete;
+
+        Stream& physics() {
+            return m_streams[recording::PHYSICS];
+        }
+        Stream& world() {
+            return m_streams[recording::WORLD];
+        }
+
+        const std::string& path() const {
+            return m_path;
+        }
+
+    private:
+        struct Chunk {
+            recording::StreamId     stream;
+            uint32_t                tick;
+            std::vector<uint8_t>    bytes;
+        };
+
+        void submit(recording::StreamId stream, uint32_t tick, std::vector<uint8_t>&& bytes) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_queue.push_back(Chunk{stream, tick, std::move(bytes)});
+            }
+            m_wake.notify_one();
+        }
+
+        void loop() {
+            std::vector<Chunk> chunks;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_wake.wait(lock, [this] { return !m_queue.empty() || !m_running; });
+                    if (m_queue.empty()) break;
+                    chunks.swap(m_queue);
+                }
+
+                for (const auto& chunk : chunks) write(chunk);
+                chunks.clear();
+            }
+            m_out.flush();
+        }
+
+        void write(const Chunk& chunk) {
+            recording::ChunkHeader header{recording::CHUNK_MAGIC, chunk.stream,
+                static_cast<uint32_t>(chunk.bytes.size()), chunk.tick};
+            m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            m_out.write(reinterpret_cast<const char*>(chunk.bytes.data()), static_cast<std::streamsize>(chunk.bytes.size()));
+            if (!m_out) {
+                std::cerr << "[ERROR] Recorder::write -> Could not write " << m_path << std::endl;
+            }
+        }
+
+    private:
+        std::string     m_path;
+        std::ofstream   m_out;
+        Stream          m_streams[recording::NUM_STREAMS];
+
+        std::mutex                  m_mutex;
+        std::condition_variable     m_wake;
+        std::vector<Chunk>          m_queue;
+        bool                        m_running{false};
+        std::thread                 m_thread;
+};
+
+#endif
@@ -1,16 +1,25 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
 #include <thread>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "SDL3/SDL_events.h"
 #include "SDL3/SDL_pixels.h"
 #include "SDL3/SDL_rect.h"
 
 #include "SDL3/SDL_video.h"
+#include "containers/mpsc.hpp"
 #include "containers/triple_buffer.hpp"
 
+#include "atlas.hpp"
+#include "particles.hpp"
 #include "vector.hpp"
 #include "colors.hpp"
 #include "RAII/SDL.hpp"
@@ -18,17 +27,48 @@
 #include "SDL3/SDL_render.h"
 
 struct RenderCommand {
+    static constexpr uint32_t SOLID = UINT32_MAX;
+    static constexpr uint32_t NO_CHUNK = UINT32_MAX;
+
     Vector2D<double> pos;
     Vector2D<double> size;
-    Vector3D<double> color;
+    Vector3D<double> color;             // Tints the sprite if there is one
+    uint32_t    atlas{SOLID};           // Sprite::atlas, or a plain rectangle
+    SDL_FRect   uv{0, 0, 0, 0};
+    uint32_t    chunk{NO_CHUNK};        // A baked tile chunk drawn over pos and size instead, see ChunkBake
+};
+
+/* The tiles of a chunk in chunk coordinates, drawn once into a texture the chunk's commands then reuse */
+struct ChunkBake {
+    uint32_t                    chunk;      // Ids are picked by the caller, dense from 0
+    int                         pixels;     // Side of the texture
+    std::vector<RenderCommand>  tiles;
+};
+
+/* Draws into a surface of this size with the software renderer, no window, display or GPU needed */
+struct Offscreen {
+    int width;
+    int height;
 };
 
 class Renderer {
     public:
         explicit Renderer()
         : m_sdl_instance (SDL())
-        , m_sdl_window (480, 240)
+        , m_size {480, 240}
         {
+            m_sdl_window.emplace(m_size.x, m_size.y);
+            m_running.store(false, std::memory_order_relaxed);
+        }
+        explicit Renderer(Offscreen size)
+        : m_sdl_instance (SDL_INIT_EVENTS)
+        , m_size {size.width, size.height}
+        {
+            m_target.emplace(SDL_CreateSurface(size.width, size.height, SDL_PIXELFORMAT_RGBA32));
+            if (m_target->get() == nullptr) {
+                std::cerr << "[ERROR] Renderer::Renderer -> SDL_CreateSurface: " << SDL_GetError() << std::endl;
+                throw std::runtime_error("Failed to create offscreen target");
+            }
             m_running.store(false, std::memory_order_relaxed);
         }
         ~Renderer() {
@@ -48,59 +88,309 @@ class Renderer {
             m_cmds.produce(std::move(new_frame));
         }
 
-        bool poll_event(SDL_Event* event) {
-            return SDL_PollEvent(event);
+        /* Every ParticleEmitter of the world, particles keep moving on the render thread between two of them */
+        void publish_emitters(const std::vector<EmitterState>& emitters) {
+            m_emitters.produce(emitters);
+        }
+
+        /* Only on the thread that created the window, false if nothing came in timeout_ms */
+        bool wait_event(SDL_Event* event, int32_t timeout_ms) {
+            return SDL_WaitEventTimeout(event, timeout_ms);
+        }
+
+        /* Of the window or the offscreen target, in pixels */
+        Vector2D<double> size() const {
+            return Vector2D<double>{static_cast<double>(m_size.x), static_cast<double>(m_size.y)};
+        }
+
+        /*
+         * Thread safe, for images streamed in once running. The texture is
+         * created before the next frame is drawn, commands using it before
+         * then are skipped. Its id comes after the atlases', which must all be
+         * packed by then.
+         */
+        Sprite add_texture(SDLSurface surface) {
+            uint32_t id = static_cast<uint32_t>(m_atlases.size()) + m_streamed.fetch_add(1, std::memory_order_relaxed);
+            Sprite sprite{id, SDL_FRect{0, 0, 1, 1}, Vector2D<double>{
+                static_cast<double>(surface.get()->w), static_cast<double>(surface.get()->h)}};
+            m_uploads.enqueue(Upload{id, surface.release()});
+            return sprite;
+        }
+
+        /* Thread safe, replaces the chunk's texture before the next frame is drawn */
+        void bake_chunk(ChunkBake bake) {
+            m_bakes.enqueue(std::move(bake));
+        }
+
+        /* Packs every .bmp in dir into atlases, before run() */
+        bool load_sprites(const char* dir) {
+            bool found = m_atlases.load_directory(dir);
+            m_atlases.pack();
+            return found;
+        }
+
+        std::optional<Sprite> sprite(std::string_view name) const {
+            return m_atlases.find(name);
+        }
+
+        /* Images can also be added directly, packed by the caller, before the first frame */
+        Atlases& atlases() {
+            return m_atlases;
+        }
+
+        /* Writes every nth frame drawn to prefix followed by the frame number and .bmp, before the first frame */
+        void dump_frames(std::string prefix, uint32_t every) {
+            m_dump_prefix = std::move(prefix);
+            m_dump_every = every;
+        }
+
+        /*
+         * Draws the last published frame if it was not drawn yet, a texture it
+         * may use came in or particles are alive, false if there was nothing
+         * new. Particles are stepped by
+         * a period each call. The render thread calls it once per period. A
+         * renderer that is never run() can be driven by calling it directly,
+         * always from the same thread, which then owns the SDL renderer.
+         */
+        bool draw() {
+            if (!m_sdl_renderer) create_renderer();
+
+            /* Uploads and bakes are queued before the frames that use them, the last frame is redrawn with them too */
+            bool textures_changed = false;
+            Upload upload;
+            while (m_uploads.dequeue(upload)) {
+                upload_texture(upload);
+                textures_changed = true;
+            }
+            ChunkBake bake;
+            while (m_bakes.dequeue(bake)) {
+                bake_chunk_texture(bake);
+                textures_changed = true;
+            }
+
+            const auto [data, new_frame] = m_cmds.consume();
+            const auto [emitters, new_emitters] = m_emitters.consume();
+            (void) new_emitters;
+            bool had_particles = (m_particles.size() != 0);
+            m_particles.update(emitters, static_cast<float>(m_dt));
+            if (!new_frame && !textures_changed && !had_particles && m_particles.size() == 0) return false;
+
+            SDL_SetRenderDrawColor(
+                    m_sdl_renderer->get(), 
+                    color::blue_cornflower.x, color::blue_cornflower.y, color::blue_cornflower.z, 
+                    SDL_ALPHA_OPAQUE);
+            SDL_RenderClear(m_sdl_renderer->get());
+
+            /* Chunks are backgrounds, under everything else */
+            for (const auto& cmd : data) {
+                if (cmd.chunk == RenderCommand::NO_CHUNK) continue;
+                if (cmd.chunk >= m_chunks.size() || !m_chunks[cmd.chunk]) continue;
+
+                SDL_FRect dst{
+                    static_cast<float>(cmd.pos.x),
+                    static_cast<float>(cmd.pos.y),
+                    static_cast<float>(cmd.size.x),
+                    static_cast<float>(cmd.size.y)
+                };
+                SDL_RenderTexture(m_sdl_renderer->get(), m_chunks[cmd.chunk]->get(), nullptr, &dst);
+            }
+
+            /* One draw call per texture used, whatever the number of commands, particles over the rest */
+            build_batches(data);
+            draw_batches(m_batches);
+            build_particle_batches();
+            draw_batches(m_particle_batches);
+
+            if (m_dump_every != 0 && m_frame % m_dump_every == 0) dump_frame();
+            SDL_RenderPresent(m_sdl_renderer->get());
+            ++m_frame;
+            return true;
         }
 
     private:
+        struct Upload {
+            uint32_t        id;
+            SDL_Surface*    surface;        // Owned until turned into a texture
+        };
+
         void init() {
-            m_sdl_renderer = new SDLRenderer(m_sdl_window.get());
+            create_renderer();
             loop();
+
+            Upload upload;
+            while (m_uploads.dequeue(upload)) SDL_DestroySurface(upload.surface);
+            m_chunks.clear();
+            m_textures.clear();
+        }
+
+        /* On the thread that draws, textures belong to the renderer that uploaded them */
+        void create_renderer() {
+            if (m_target) {
+                m_sdl_renderer.emplace(m_target->get());
+            } else {
+                m_sdl_renderer.emplace(m_sdl_window->get());
+            }
+            for (auto& texture : m_atlases.upload(m_sdl_renderer->get())) m_textures.emplace_back(std::move(texture));
+            m_batches.resize(m_textures.size() + 1);
+            m_particle_batches.resize(m_batches.size());
+        }
+
+        void upload_texture(const Upload& upload) {
+            SDLSurface surface(upload.surface);
+            if (m_textures.size() <= upload.id) {
+                m_textures.resize(upload.id + 1);
+                m_batches.resize(m_textures.size() + 1);
+                m_particle_batches.resize(m_batches.size());
+            }
+            m_textures[upload.id].emplace(m_sdl_renderer->get(), surface.get());
+            SDL_SetTextureBlendMode(m_textures[upload.id]->get(), SDL_BLENDMODE_BLEND);
+        }
+
+        struct Batch {
+            std::vector<SDL_Vertex>     vertices;       // 4 per quad, reused from frame to frame
+            std::size_t                 quads{0};
+        };
+
+        void draw_batches(const std::vector<Batch>& batches) {
+            for (std::size_t i = 0; i < batches.size(); ++i) {
+                if (batches[i].quads == 0) continue;
+                SDL_RenderGeometry(m_sdl_renderer->get(),
+                        (i == 0) ? nullptr : m_textures[i - 1]->get(),
+                        batches[i].vertices.data(), static_cast<int>(batches[i].quads * 4),
+                        m_indices.data(), static_cast<int>(batches[i].quads * 6));
+            }
+        }
+
+        /* Draws the tiles into the chunk's texture through the same batches as a frame */
+        void bake_chunk_texture(const ChunkBake& bake) {
+            if (m_chunks.size() <= bake.chunk) m_chunks.resize(bake.chunk + 1);
+            if (!m_chunks[bake.chunk]) {
+                m_chunks[bake.chunk].emplace(m_sdl_renderer->get(), SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, bake.pixels, bake.pixels);
+                SDL_SetTextureBlendMode(m_chunks[bake.chunk]->get(), SDL_BLENDMODE_BLEND);
+            }
+
+            SDL_SetRenderTarget(m_sdl_renderer->get(), m_chunks[bake.chunk]->get());
+            SDL_SetRenderDrawColor(m_sdl_renderer->get(), 0, 0, 0, 0);
+            SDL_RenderClear(m_sdl_renderer->get());
+            build_batches(bake.tiles);
+            draw_batches(m_batches);
+            SDL_SetRenderTarget(m_sdl_renderer->get(), nullptr);
+        }
+
+        /* Read back before presenting, the back buffer is undefined after */
+        void dump_frame() {
+            SDLSurface pixels(SDL_RenderReadPixels(m_sdl_renderer->get(), nullptr));
+            std::string path = m_dump_prefix + std::to_string(m_frame) + ".bmp";
+            if (pixels.get() == nullptr || !SDL_SaveBMP(pixels.get(), path.c_str())) {
+                std::cerr << "[ERROR] Renderer::dump_frame -> " << path << ": " << SDL_GetError() << std::endl;
+            }
+        }
+
+        /*
+         * Sorts the frame into one batch per texture, plain rectangles first,
+         * and writes each batch's quads over the vertices of the last frame.
+         * The buffers only ever grow, a frame allocates nothing once they are
+         * as large as the largest frame so far.
+         */
+        void build_batches(const std::vector<RenderCommand>& cmds) {
+            for (auto& batch : m_batches) batch.quads = 0;
+
+            std::size_t most = 0;
+            for (const auto& cmd : cmds) {
+                if (cmd.chunk != RenderCommand::NO_CHUNK) continue;
+
+                bool solid = (cmd.atlas == RenderCommand::SOLID);
+                if (!solid && (cmd.atlas >= m_textures.size() || !m_textures[cmd.atlas])) continue;
+
+                Batch& batch = m_batches[solid ? 0 : cmd.atlas + 1];
+                std::size_t v = batch.quads * 4;
+                if (batch.vertices.size() < v + 4) batch.vertices.resize(std::max(v + 4, batch.vertices.size() * 2));
+
+                float x0 = static_cast<float>(cmd.pos.x), y0 = static_cast<float>(cmd.pos.y);
+                float x1 = x0 + static_cast<float>(cmd.size.x), y1 = y0 + static_cast<float>(cmd.size.y);
+                float u0 = cmd.uv.x, v0 = cmd.uv.y, u1 = cmd.uv.x + cmd.uv.w, v1 = cmd.uv.y + cmd.uv.h;
+                SDL_FColor color{
+                    static_cast<float>(cmd.color.x / 255.0),
+                    static_cast<float>(cmd.color.y / 255.0),
+                    static_cast<float>(cmd.color.z / 255.0),
+                    1.0f
+                };
+                batch.vertices[v + 0] = SDL_Vertex{SDL_FPoint{x0, y0}, color, SDL_FPoint{u0, v0}};
+                batch.vertices[v + 1] = SDL_Vertex{SDL_FPoint{x1, y0}, color, SDL_FPoint{u1, v0}};
+                batch.vertices[v + 2] = SDL_Vertex{SDL_FPoint{x1, y1}, color, SDL_FPoint{u1, v1}};
+                batch.vertices[v + 3] = SDL_Vertex{SDL_FPoint{x0, y1}, color, SDL_FPoint{u0, v1}};
+                most = std::max(most, ++batch.quads);
+            }
+
+            grow_indices(most);
+        }
+
+        /* Particles are written straight from their buffers into the vertices, one batch per texture like commands */
+        void build_particle_batches() {
+            for (auto& batch : m_particle_batches) batch.quads = 0;
+
+            std::size_t most = 0;
+            m_particles.for_each([this, &most](const ParticleParams& params, const ParticleBuffer& particles) {
+                bool solid = (params.atlas == ParticleParams::SOLID);
+                if (!solid && (params.atlas >= m_textures.size() || !m_textures[params.atlas])) return;
+
+                Batch& batch = m_particle_batches[solid ? 0 : params.atlas + 1];
+                std::size_t v = batch.quads * 4;
+                std::size_t needed = v + particles.size() * 4;
+                if (batch.vertices.size() < needed) batch.vertices.resize(std::max(needed, batch.vertices.size() * 2));
+
+                particles.write_quads(batch.vertices.data() + v, params);
+                batch.quads += particles.size();
+                most = std::max(most, batch.quads);
+            });
+
+            grow_indices(most);
+        }
+
+        /* Every batch indexes its quads the same way, one index buffer serves them all */
+        void grow_indices(std::size_t quads) {
+            for (std::size_t q = m_indices.size() / 6; q < quads; ++q) {
+                int v = static_cast<int>(q * 4);
+                m_indices.insert(m_indices.end(), {v, v + 1, v + 2, v + 2, v + 3, v});
+            }
         }
 
         void loop() {
             auto next = std::chrono::steady_clock::now();
             while (m_running.load(std::memory_order_relaxed)) {
-                /* Consume all render commands */
-                const auto [data, new_frame] = m_cmds.consume();
-
-                if (new_frame) {
-                    SDL_SetRenderDrawColor(
-                            m_sdl_renderer->get(), 
-                            color::blue_cornflower.x, color::blue_cornflower.y, color::blue_cornflower.z, 
-                            SDL_ALPHA_OPAQUE);
-                    SDL_RenderClear(m_sdl_renderer->get());
-                    
-                    for (auto cmd : data) {
-                        SDL_SetRenderDrawColor(
-                                m_sdl_renderer->get(), 
-                                cmd.color.x, cmd.color.y, cmd.color.z, 
-                                SDL_ALPHA_OPAQUE);
-
-                        SDL_FRect rect{
-                            static_cast<float>(cmd.pos.x), 
-                            static_cast<float>(cmd.pos.y), 
-                            static_cast<float>(cmd.size.x), 
-                            static_cast<float>(cmd.size.y)
-                        };
-                        SDL_RenderFillRect(m_sdl_renderer->get(), &rect);
-                    }
-                    
-                    SDL_RenderPresent(m_sdl_renderer->get());
-                }
+                draw();
                 next += m_period;
                 std::this_thread::sleep_until(next);
             }
         }
     private:
         SDL m_sdl_instance;
-        SDLWindow   m_sdl_window;
-        SDLRenderer* m_sdl_renderer{nullptr};
+        std::optional<SDLWindow>    m_sdl_window;
+        std::optional<SDLSurface>   m_target;       // Offscreen only, instead of the window
+        std::optional<SDLRenderer>  m_sdl_renderer;     // Created by the thread that draws
+        Vector2D<int>   m_size;
+
+        Atlases     m_atlases;
+        std::vector<std::optional<SDLTexture>>      m_textures;     // Indexed by Sprite::atlas, render thread only
+        std::vector<Batch>          m_batches;      // Plain rectangles, then one per texture
+        std::vector<Batch>          m_particle_batches;     // Same, drawn after
+        std::vector<int>            m_indices;      // 6 per quad
+
+        std::atomic<uint32_t>                       m_streamed{0};  // Textures added after the atlases
+        MPSCQueue<Upload>                           m_uploads;
+        MPSCQueue<ChunkBake>                        m_bakes;
+        std::vector<std::optional<SDLTexture>>      m_chunks;       // Indexed by ChunkBake::chunk, render thread only
+
+        uint64_t    m_frame{0};         // Frames drawn
+        std::string m_dump_prefix;
+        uint32_t    m_dump_every{0};    // 0 never dumps
 
         std::atomic<bool>   m_running;
         std::thread m_render_thread;
 
         TripleBuffer<RenderCommand> m_cmds;
+        TripleBuffer<EmitterState>  m_emitters;
+        ParticleSystem              m_particles;    // Render thread only
 
         static constexpr double m_dt = 1.0 / 60.0;
         
@@ -0,0 +1,206 @@
+#ifndef SAVE_H
+#define SAVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "RAII/mapped_file.hpp"
+#include "entity.hpp"
+
+/*
+ * World save file. A header and a table of blocks, then every block as the raw
+ * contiguous array it was in memory, each starting on an ALIGNMENT boundary so
+ * it can be used in place from the mapping. Nothing is parsed per entity.
+ *
+ *   FileHeader | BlockDesc[num_blocks] | pad | block 0 | pad | block 1 ...
+ *
+ * The format is only portable between builds with the same layout, the
+ * version, the byte order mark and the element size stored with each block
+ * are checked so a mismatch is rejected instead of misread.
+ */
+namespace save {
+    static constexpr uint32_t MAGIC = 0x56534547;     // "GESV"
+    static constexpr uint16_t VERSION = 2;
+    static constexpr uint16_t ENDIAN_MARK = 0x0102;
+    static constexpr std::size_t ALIGNMENT = 64;
+
+    enum BlockKind : uint32_t {
+        WORLD = 1,
+        PHYSICS_DATA,
+        PHYSICS_TRANSFORMS,
+        PHYSICS_INPUT_SEQS,
+        PHYSICS_IDS,
+        PHYSICS_REGISTRY,
+        RENDER_REGISTRY,
+
+        POOL_BASE = 0x100,      // Component pool i of the TypeMap is POOL_BASE + i
+    };
+
+    struct FileHeader {
+        uint32_t    magic;
+        uint16_t    version;
+        uint16_t    byte_order;
+        uint32_t    num_blocks;
+        uint32_t    reserved;
+        uint64_t    file_size;
+    };
+
+    struct BlockDesc {
+        uint32_t    kind;
+        uint32_t    elem_size;
+        uint64_t    count;
+        uint64_t    offset;
+    };
+
+    struct WorldState {
+        EntityID    next_entity;
+        uint32_t    physics_tick;
+    };
+
+    inline uint64_t align(uint64_t offset) noexcept {
+        return (offset + ALIGNMENT - 1) & ~static_cast<uint64_t>(ALIGNMENT - 1);
+    }
+
+    /* Collects the blocks by pointer, they have to stay alive until write() */
+    class Writer {
+        public:
+            template<typename T>
+            void add(uint32_t kind, std::span<const T> elems) {
+                add_parts(kind, std::vector<std::span<const T>>{elems});
+            }
+
+            /* One block gathered from several runs, written back to back */
+            template<typename T>
+            void add_parts(uint32_t kind, const std::vector<std::span<const T>>& parts) {
+                static_assert(std::is_trivially_copyable_v<T>, "Blocks are written as raw memory");
+                Pending p{BlockDesc{kind, sizeof(T), 0, 0}, {}};
+                for (auto part : parts) {
+                    p.desc.count += part.size();
+                    p.parts.push_back(std::as_bytes(part));
+                }
+                m_blocks.push_back(std::move(p));
+            }
+
+            /* For blocks built just for the save, kept alive by the writer */
+            template<typename T>
+            void add(uint32_t kind, std::vector<T>&& elems) {
+                auto owned = std::make_shared<const std::vector<T>>(std::move(elems));
+                add(kind, std::span<const T>(*owned));
+                m_owned.push_back(std::move(owned));
+            }
+
+            bool write(const char* path) {
+                FileHeader header{MAGIC, VERSION, ENDIAN_MARK, static_cast<uint32_t>(m_blocks.size()), 0, 0};
+
+                uint64_t offset = align(sizeof(FileHeader) + m_blocks.size() * sizeof(BlockDesc));
+                for (auto& b : m_blocks) {
+                    b.desc.offset = offset;
+                    offset = align(offset + b.desc.elem_size * b.desc.count);
+                }
+                header.file_size = offset;
+
+                std::ofstream out(path, std::ios::binary | std::ios::trunc);
+                if (!out) {
+                    std::cerr << "[ERROR] save::Writer::write -> Could not open " << path << std::endl;
+                    return false;
+                }
+
+                out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                for (const auto& b : m_blocks) {
+                    out.write(reinterpret_cast<const char*>(&b.desc), sizeof(b.desc));
+                }
+                for (const auto& b : m_blocks) {
+                    pad_to(out, b.desc.offset);
+                    for (auto part : b.parts) {
+                        out.write(reinterpret_cast<const char*>(part.data()), static_cast<std::streamsize>(part.size()));
+                    }
+                }
+                pad_to(out, header.file_size);
+
+                if (!out) {
+                    std::cerr << "[ERROR] save::Writer::write -> Write to " << path << " failed" << std::endl;
+                    return false;
+                }
+                return true;
+            }
+
+        private:
+            struct Pending {
+                BlockDesc   desc;
+                std::vector<std::span<const std::byte>>     parts;
+            };
+
+            static void pad_to(std::ofstream& out, uint64_t offset) {
+                static const char zeros[ALIGNMENT] = {};
+                uint64_t pos = static_cast<uint64_t>(out.tellp());
+                if (offset > pos) out.write(zeros, static_cast<std::streamsize>(offset - pos));
+            }
+
+        private:
+            std::vector<Pending>    m_blocks;
+            std::vector<std::shared_ptr<const void>>    m_owned;
+    };
+
+    /* Maps a save file and validates its header and block table up front */
+    class Reader {
+        public:
+            explicit Reader(const char* path) : m_file (path) {
+                if (m_file.size() < sizeof(FileHeader)) fail("File too small");
+
+                std::memcpy(&m_header, m_file.data(), sizeof(FileHeader));
+                if (m_header.magic != MAGIC) fail("Not a save file");
+                if (m_header.byte_order != ENDIAN_MARK) fail("Saved with a different byte order");
+                if (m_header.version != VERSION) fail("Unsupported version");
+                if (m_header.file_size != m_file.size()) fail("Truncated file");
+
+                uint64_t table_end = sizeof(FileHeader) + static_cast<uint64_t>(m_header.num_blocks) * sizeof(BlockDesc);
+                if (table_end > m_file.size()) fail("Truncated block table");
+
+                m_blocks.resize(m_header.num_blocks);
+                std::memcpy(m_blocks.data(), m_file.data() + sizeof(FileHeader), m_blocks.size() * sizeof(BlockDesc));
+                for (const auto& b : m_blocks) {
+                    /* Divided rather than multiplied, a crafted count cannot wrap around and pass */
+                    if (b.offset % ALIGNMENT != 0 || b.offset > m_file.size() ||
+                            (b.elem_size != 0 && b.count > (m_file.size() - b.offset) / b.elem_size)) {
+                        fail("Block out of bounds");
+                    }
+                }
+            }
+
+            Reader(const Reader&) = delete;
+            Reader& operator=(const Reader&) = delete;
+
+            /* The block in place inside the mapping, throws if it is missing or of another type */
+            template<typename T>
+            std::span<const T> block(uint32_t kind) const {
+                static_assert(std::is_trivially_copyable_v<T>, "Blocks are read as raw memory");
+                for (const auto& b : m_blocks) {
+                    if (b.kind != kind) continue;
+                    if (b.elem_size != sizeof(T)) fail("Block element size mismatch");
+                    return {reinterpret_cast<const T*>(m_file.data() + b.offset), b.count};
+                }
+                fail("Missing block");
+            }
+
+        private:
+            [[noreturn]] static void fail(const char* what) {
+                std::cerr << "[ERROR] save::Reader -> " << what << std::endl;
+                throw std::runtime_error("Failed to read save file");
+            }
+
+        private:
+            MappedFile              m_file;
+            FileHeader              m_header{};
+            std::vector<BlockDesc>  m_blocks;
+    };
+}
+
+#endif
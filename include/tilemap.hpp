@@ -0,0 +1,137 @@
+#ifndef TILEMAP_H
+#define TILEMAP_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <assert.h>
+
+#include "atlas.hpp"
+#include "renderer.hpp"
+#include "vector.hpp"
+
+/*
+ * Tiles of a static background, split in chunks of CHUNK_TILES x CHUNK_TILES.
+ * The renderer bakes each chunk into a texture of its own the first time it is
+ * visible and then draws it with a single call, a chunk is only baked again
+ * after one of its tiles changed. Tile 0 is empty, tile i draws palette[i - 1]
+ * stretched to the tile size.
+ */
+class TileMap {
+    public:
+        using Tile = uint16_t;
+
+        static constexpr uint32_t CHUNK_TILES = 32;
+        static constexpr Tile EMPTY = 0;
+
+        /* Throws on a map with no tiles or tiles of no size */
+        explicit TileMap(uint32_t width, uint32_t height, uint32_t tile_size, std::vector<Sprite> palette)
+        : m_width (width)
+        , m_height (height)
+        , m_tile_size (tile_size)
+        , m_chunks_x ((width + CHUNK_TILES - 1) / CHUNK_TILES)
+        , m_palette (std::move(palette))
+        , m_chunks (m_chunks_x * ((height + CHUNK_TILES - 1) / CHUNK_TILES))
+        {
+            /* Every chunk lookup divides by the chunks in a row */
+            if (width == 0 || height == 0 || tile_size == 0) {
+                std::cerr << "[ERROR] TileMap::TileMap -> Empty map " << width << "x" << height << " of " << tile_size << "px tiles" << std::endl;
+                throw std::runtime_error("Empty tile map");
+            }
+        }
+
+        void set(uint32_t x, uint32_t y, Tile tile) {
+            assert(x < m_width && y < m_height && tile <= m_palette.size());
+            Chunk& chunk = m_chunks[(y / CHUNK_TILES) * m_chunks_x + x / CHUNK_TILES];
+            Tile& t = chunk.tiles[(y % CHUNK_TILES) * CHUNK_TILES + x % CHUNK_TILES];
+            if (t == tile) return;
+
+            t = tile;
+            chunk.dirty = true;
+            ++m_version;
+        }
+
+        Tile get(uint32_t x, uint32_t y) const {
+            assert(x < m_width && y < m_height);
+            const Chunk& chunk = m_chunks[(y / CHUNK_TILES) * m_chunks_x + x / CHUNK_TILES];
+            return chunk.tiles[(y % CHUNK_TILES) * CHUNK_TILES + x % CHUNK_TILES];
+        }
+
+        uint32_t width() const {
+            return m_width;
+        }
+        uint32_t height() const {
+            return m_height;
+        }
+
+        std::size_t num_chunks() const {
+            return m_chunks.size();
+        }
+        uint32_t chunks_x() const {
+            return m_chunks_x;
+        }
+        uint32_t chunks_y() const {
+            return static_cast<uint32_t>(m_chunks.size() / m_chunks_x);
+        }
+
+        /* Bumped by every tile that changes */
+        uint32_t version() const {
+            return m_version;
+        }
+
+        /* Side of a chunk's texture in pixels, chunks on the far edges keep the full size */
+        int chunk_pixels() const {
+            return static_cast<int>(CHUNK_TILES * m_tile_size);
+        }
+
+        /* Of the chunk's top left corner, relative to the map's */
+        Vector2D<double> chunk_offset(std::size_t chunk) const {
+            return Vector2D<double>{
+                static_cast<double>((chunk % m_chunks_x) * CHUNK_TILES * m_tile_size),
+                static_cast<double>((chunk / m_chunks_x) * CHUNK_TILES * m_tile_size)
+            };
+        }
+
+        /* What the renderer draws into the chunk's texture, one command per tile that is not empty */
+        std::vector<RenderCommand> bake(std::size_t chunk) const {
+            std::vector<RenderCommand> cmds;
+            const auto& tiles = m_chunks[chunk].tiles;
+            double size = static_cast<double>(m_tile_size);
+            for (uint32_t i = 0; i < tiles.size(); ++i) {
+                if (tiles[i] == EMPTY) continue;
+
+                const Sprite& sprite = m_palette[tiles[i] - 1];
+                Vector2D<double> pos{(i % CHUNK_TILES) * size, (i / CHUNK_TILES) * size};
+                cmds.push_back(RenderCommand{pos, Vector2D<double>{size, size}, Vector3D<double>{255, 255, 255}, sprite.atlas, sprite.uv});
+            }
+            return cmds;
+        }
+
+        /* Whether the chunk needs baking, never baked or changed since, and clears it */
+        bool take_dirty(std::size_t chunk) {
+            bool dirty = m_chunks[chunk].dirty;
+            m_chunks[chunk].dirty = false;
+            return dirty;
+        }
+
+    private:
+        struct Chunk {
+            std::array<Tile, CHUNK_TILES * CHUNK_TILES>     tiles{};
+            bool                                            dirty{true};
+        };
+
+    private:
+        uint32_t                m_width;        // In tiles
+        uint32_t                m_height;
+        uint32_t                m_tile_size;    // In pixels
+        uint32_t                m_chunks_x;
+        std::vector<Sprite>     m_palette;
+        std::vector<Chunk>      m_chunks;       // Row major
+        uint32_t                m_version{1};
+};
+
+#endif
@@ -27,6 +27,18 @@ struct Vector2D {
         return *this;
     }
 
+    Vector2D operator-(const Vector2D& v) const noexcept {
+        return {x-v.x, y-v.y};
+    }
+    Vector2D& operator-=(const Vector2D& v) noexcept {
+        x -= v.x;
+        y -= v.y;
+
+        return *this;
+    }
+
+    bool operator==(const Vector2D&) const noexcept = default;
+
     friend Vector2D<T> operator*(T d, const Vector2D<T>& v) noexcept { return {v.x*d, v.y*d}; }
 };
 
@@ -0,0 +1,119 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Fixed set of threads for fork/join work inside a tick. parallel_for blocks
+ * until every index has been processed, the calling thread takes indices too,
+ * so a pool with zero workers degrades to a plain loop.
+ */
+class WorkerPool {
+    public:
+        explicit WorkerPool(std::size_t num_workers = default_workers()) {
+            m_workers.reserve(num_workers);
+            for (std::size_t i = 0; i < num_workers; ++i) {
+                m_workers.emplace_back(&WorkerPool::worker_loop, this);
+            }
+        }
+
+        ~WorkerPool() {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_running = false;
+                ++m_generation;
+            }
+            m_start.notify_all();
+            for (auto& t : m_workers) t.join();
+        }
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        template<typename F>
+        void parallel_for(std::size_t count, F&& fn) {
+            if (count == 0) return;
+            if (m_workers.empty() || count == 1) {
+                for (std::size_t i = 0; i < count; ++i) fn(i);
+                return;
+            }
+
+            /* No std::function, the job is a plain pointer to the caller's callable */
+            using Fn = std::remove_reference_t<F>;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_ctx = const_cast<void*>(static_cast<const void*>(&fn));
+                m_invoke = [](void* ctx, std::size_t i) { (*static_cast<Fn*>(ctx))(i); };
+                m_count = count;
+                m_next.store(0, std::memory_order_relaxed);
+                m_pending = m_workers.size();
+                ++m_generation;
+            }
+            m_start.notify_all();
+
+            run_indices();
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [this] { return m_pending == 0; });
+        }
+
+        std::size_t num_threads() const {
+            return m_workers.size() + 1;
+        }
+
+    private:
+        static std::size_t default_workers() {
+            unsigned hw = std::thread::hardware_concurrency();
+            return (hw > 1) ? hw - 1 : 0;
+        }
+
+        void run_indices() {
+            while (true) {
+                std::size_t i = m_next.fetch_add(1, std::memory_order_relaxed);
+                if (i >= m_count) break;
+                m_invoke(m_ctx, i);
+            }
+        }
+
+        void worker_loop() {
+            uint64_t seen = 0;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_start.wait(lock, [this, seen] { return m_generation != seen; });
+                    seen = m_generation;
+                    if (!m_running) return;
+                }
+
+                run_indices();
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (--m_pending == 0) m_done.notify_one();
+            }
+        }
+
+    private:
+        std::vector<std::thread>    m_workers;
+
+        std::mutex                  m_mutex;
+        std::condition_variable     m_start;
+        std::condition_variable     m_done;
+        uint64_t                    m_generation{0};
+        std::size_t                 m_pending{0};
+        bool                        m_running{true};
+
+        void                        (*m_invoke)(void*, std::size_t){nullptr};
+        void*                       m_ctx{nullptr};
+        std::size_t                 m_count{0};
+        std::atomic<std::size_t>    m_next{0};
+};
+
+#endif
@@ -1,8 +1,20 @@
 #ifndef WORLD_H
 #define WORLD_H
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
 #include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "containers/typemap.hpp"
 #include "containers/component_pool.hpp"
@@ -11,17 +23,62 @@
 #include "components/physics_body.hpp"
 #include "components/transform.hpp"
 #include "components/drawable_rect.hpp"
+#include "components/drawable_sprite.hpp"
+#include "components/drawable_tilemap.hpp"
+#include "components/parent_link.hpp"
+#include "components/particle_emitter.hpp"
 
 #include "RAII/SDL.hpp"
+#include "RAII/SDL_net.hpp"
+#include "assets/loader.hpp"
+#include "checkpoint.hpp"
+#include "command_buffer.hpp"
+#include "hierarchy.hpp"
 #include "physics.hpp"
+#include "recording.hpp"
+#include "save.hpp"
+#include "tilemap.hpp"
+
+#ifdef SERVER
+#include "net/replication_server.hpp"
+#else
+#include "input_pipeline.hpp"
+#include "net/prediction.hpp"
+#include "net/replication_client.hpp"
 #include "renderer.hpp"
+#endif
 
 #include "SDL3/SDL_events.h"
+#include "SDL3/SDL_keycode.h"
+
+#ifndef SERVER
+/* Components that draw themselves at the position of their Transform, one command each */
+template<typename Comp>
+concept Renderable = requires (const Comp& c, const Transform& t) {
+    { c.render_cmd(t) } -> std::same_as<RenderCommand>;
+    { c.transform_idx } -> std::convertible_to<std::size_t>;
+};
+#endif
 
 class World {
     public:
+        using Pools = TypeMap<
+            ComponentPool<Transform, void>,
+            ComponentPool<PhysicsBody, PhysicsRegistry>,
+            ComponentPool<RectangleDrawable, RenderRegistry>,
+            ComponentPool<ParentLink, void>,
+            ComponentPool<SpriteDrawable, RenderRegistry>,
+            ComponentPool<TileMapDrawable, RenderRegistry>,
+            ComponentPool<ParticleEmitter, void>
+        >;
+        using Commands = CommandBuffer<Pools>;
+
         explicit World()
-        : m_sdl_instance (SDL())
+#ifdef SERVER
+        : m_sdl_instance (SDL_INIT_EVENTS)
+#else
+        : m_sdl_instance (SDL_INIT_VIDEO)
+#endif
         {
             m_running.store(false, std::memory_order_relaxed);
 
@@ -35,23 +92,311 @@ class World {
             if (m_world_thread.joinable())
                 m_world_thread.join();
 
+            /* Despawning avatars touches the pools, which are destroyed before the members above them */
+            m_replication.reset();
         }
 
         void run() {
+            if (m_recorder) start_recording();
+
             m_running.store(true, std::memory_order_relaxed);
             m_physics.run();
-            m_renderer.run();
+#ifdef SERVER
             loop();
+#else
+            m_renderer.run();
+
+            /* The world ticks on its own thread, this one owns the window and only waits for input */
+            m_world_thread = std::thread(&World::loop, this);
+            pump_input();
+            m_world_thread.join();
+#endif
+
+#ifdef SERVER
+            /* Clients' avatars are not part of the world once it stops, removed before physics so a recording sees it */
+            m_replication.reset();
+#endif
+            m_physics.stop();
+            if (m_recorder) stop_recording();
+        }
+
+        /*
+         * Advances n ticks on the calling thread with nothing paced and no
+         * thread handoff: each tick steps physics once and then runs the world
+         * tick on the snapshot it just published, so the world never skips or
+         * repeats a tick. Meant for batch simulation, rollouts and throughput
+         * benchmarks, only while the world is not running. Events are not
+         * polled and the renderer thread is not started.
+         */
+        void step(uint32_t n = 1) {
+            if (m_running.load(std::memory_order_relaxed)) {
+                std::cerr << "[ERROR] World::step -> Cannot step a running world" << std::endl;
+                return;
+            }
+
+            for (uint32_t i = 0; i < n; ++i) {
+                m_physics.step();
+                update(std::chrono::steady_clock::now());
+            }
+        }
+
+        /*
+         * Records the next run() to path for replay(), see recording.hpp: the
+         * world as it is when run() starts, every physics message with the tick
+         * that applied it and every structural change the world makes along
+         * with the snapshot ticks it read in between.
+         */
+        bool record(const char* path) {
+            if (m_running.load(std::memory_order_relaxed)) {
+                std::cerr << "[ERROR] World::record -> Cannot start recording a running world" << std::endl;
+                return false;
+            }
+
+            try {
+                m_recorder.emplace(path);
+            } catch (const std::runtime_error&) {
+                return false;
+            }
+            return true;
+        }
+
+        /*
+         * Re-simulates a recording on the calling thread, as fast as it goes.
+         * The initial world is loaded, then the world's changes and snapshot
+         * reads are replayed in order while physics is stepped up to each tick
+         * read, with the messages recorded for it. Returns the number of physics
+         * ticks stepped, nothing if the recording is unreadable or the replay
+         * diverged from it.
+         */
+        std::optional<uint32_t> replay(const char* path) {
+            if (m_running.load(std::memory_order_relaxed)) {
+                std::cerr << "[ERROR] World::replay -> Cannot replay into a running world" << std::endl;
+                return std::nullopt;
+            }
+            if (!load(recording::initial_state_path(path).c_str())) return std::nullopt;
+
+            try {
+                recording::Reader reader(path);
+                recording::Cursor physics = reader.cursor(recording::PHYSICS);
+                recording::Cursor world = reader.cursor(recording::WORLD);
+                uint32_t first = m_physics.tick();
+
+                recording::Record rec;
+                bool stepping = true;
+                while (stepping && world.next(rec)) {
+                    if (rec.kind == recording::WORLD_TICK) {
+                        while (stepping && m_physics.tick() <= rec.tick) stepping = m_physics.replay_step(physics);
+                        if (stepping) {
+                            process_physics_snapshot();
+                            update_hierarchy();
+                        }
+                    } else if (!replay_change(rec)) {
+                        std::cerr << "[ERROR] World::replay -> Diverged from the recording at tick " << rec.tick << std::endl;
+                        return std::nullopt;
+                    }
+                }
+                while (stepping) stepping = m_physics.replay_step(physics);
+
+                return m_physics.tick() - first;
+            } catch (const std::runtime_error&) {
+                return std::nullopt;
+            }
+        }
+
+        /*
+         * Writes every pool, the registries, the entity counter and the physics
+         * bodies as raw blocks, see save.hpp. Only while the world is not running.
+         */
+        bool save(const char* path) {
+            if (m_running.load(std::memory_order_relaxed)) {
+                std::cerr << "[ERROR] World::save -> Cannot save a running world" << std::endl;
+                return false;
+            }
+
+            save::Writer w;
+            PhysicsCore::BodyArrays bodies = m_physics.bodies();
+            w.add(save::WORLD, std::vector<save::WorldState>{{m_entity_manager.next_id(), bodies.tick}});
+            w.add(save::PHYSICS_DATA, bodies.data);
+            w.add(save::PHYSICS_TRANSFORMS, bodies.transforms);
+            w.add(save::PHYSICS_INPUT_SEQS, bodies.input_seqs);
+            w.add(save::PHYSICS_IDS, bodies.ids);
+            w.add_parts(save::PHYSICS_REGISTRY, m_physics_reg.data.entries().chunks());
+            w.add_parts(save::RENDER_REGISTRY, m_render_reg.data.entries().chunks());
+
+            uint32_t kind = save::POOL_BASE;
+            m_pools.for_each([&w, &kind]<typename Pool>(Pool& pool) {
+                using Comp = typename Pool::value_type;
+                if constexpr (std::is_trivially_copyable_v<ComponentEntry<Comp>>) {
+                    w.add_parts(kind++, pool.entries().chunks());
+                } else {
+                    std::vector<typename Comp::Persistent> persisted;
+                    persisted.reserve(pool.size());
+                    for (const auto& entry : pool.entries()) persisted.push_back(entry.data.persist());
+                    w.add(kind++, std::move(persisted));
+                }
+            });
+
+            return w.write(path);
+        }
+
+        /*
+         * Replaces the whole world with the contents of a save, the blocks are
+         * bulk copied out of the mapped file. Only while the world is not running,
+         * nothing is modified if the file is rejected.
+         */
+        bool load(const char* path) {
+            if (m_running.load(std::memory_order_relaxed)) {
+                std::cerr << "[ERROR] World::load -> Cannot load into a running world" << std::endl;
+                return false;
+            }
+
+            try {
+                save::Reader r(path);
+                return load_blocks(r);
+            } catch (const std::runtime_error&) {
+                return false;
+            }
+        }
+
+        /*
+         * Writes incremental checkpoints to path every interval seconds while the
+         * world runs, see checkpoint.hpp. The tick only pays for copying the pool
+         * pages written since the previous checkpoint.
+         */
+        void enable_checkpoints(const char* path, double interval) {
+            m_pools.for_each([](auto& pool) { pool.mark_all_dirty(); });
+            m_physics_reg.data.mark_all_dirty();
+            m_render_reg.data.mark_all_dirty();
+            m_checkpoint.emplace(path, m_physics, interval);
+        }
+
+        /* Same as load, from the last complete checkpoint written by enable_checkpoints */
+        bool restore_checkpoint(const char* path) {
+            if (m_running.load(std::memory_order_relaxed)) {
+                std::cerr << "[ERROR] World::restore_checkpoint -> Cannot restore into a running world" << std::endl;
+                return false;
+            }
+
+            try {
+                checkpoint::Image image(path);
+                return load_blocks(image);
+            } catch (const std::runtime_error&) {
+                return false;
+            }
+        }
+
+#ifdef SERVER
+        /*
+         * Starts replicating the physics state to every client that says hello on
+         * port. Each client gets an avatar body driven by the inputs it sends.
+         */
+        void listen(uint16_t port) {
+            m_replication.emplace(port,
+                [this]() { return spawn_avatar(); },
+                [this](EntityID avatar) { remove_component<Transform>(avatar); },
+                [this](EntityID avatar, const InputCmd& cmd) {
+                    m_physics.apply_input(avatar, input::velocity(cmd), cmd.seq);
+                });
+        }
+#else
+        /* Mirrors the bodies replicated by the server at host:port as local entities, false if host does not resolve */
+        bool connect(const char* host, uint16_t port) {
+            m_replication.emplace(host, port);
+            if (!m_replication->resolved()) {
+                m_replication.reset();
+                return false;
+            }
+            return true;
+        }
+#endif
+
+#ifndef SERVER
+        /* Packs every .bmp in dir into the renderer's atlases, before run() */
+        bool load_sprites(const char* dir) {
+            return m_renderer.load_sprites(dir);
+        }
+
+        std::optional<Sprite> sprite(std::string_view name) const {
+            return m_renderer.sprite(name);
+        }
+
+        /* Key bindings, before run() */
+        ActionMap& actions() {
+            return m_actions;
+        }
+
+        /* Thread safe, how long input took to reach a published frame over the last second */
+        InputLatency input_latency() const {
+            return m_input.latency();
+        }
+#endif
+
+        /* Maps the pack and starts streaming from it, see assets/loader.hpp. Assets are only read when requested */
+        bool open_assets(const char* path) {
+            try {
+#ifdef SERVER
+                m_assets.emplace(path, nullptr);
+#else
+                m_assets.emplace(path, &m_renderer);
+#endif
+                return true;
+            } catch (const std::runtime_error&) {
+                return false;
+            }
+        }
+
+        /* Only once open_assets succeeded */
+        assets::Loader& assets() {
+            return m_assets.value();
+        }
+
+        /* Id for TileMapDrawable, maps live as long as the world */
+        uint32_t add_tilemap(TileMap map) {
+            uint32_t first_chunk = m_tilemaps.empty() ? 0 : m_tilemaps.back().first_chunk + static_cast<uint32_t>(m_tilemaps.back().map.num_chunks());
+            m_tilemaps.push_back(TileMapEntry{std::move(map), first_chunk, 0});
+            return static_cast<uint32_t>(m_tilemaps.size() - 1);
+        }
+
+        /* Tiles set between two frames are drawn by the next one, from the world thread once running */
+        TileMap& tilemap(uint32_t id) {
+            return m_tilemaps[id].map;
+        }
+
+        PhysicsCore& physics() {
+            return m_physics;
         }
 
         EntityID create_entity() {
-            return m_entity_manager.create();
+            EntityID eid = m_entity_manager.create();
+            if (m_recording) m_recorder->world().record(m_tick, recording::WORLD_CREATE, eid);
+            return eid;
         }
 
         template<typename T>
         void add_component(EntityID owner, T comp) {
             auto& pool = m_pools.get<T>();
-            pool.add(owner, comp);
+            if (m_recording) record_add(pool, owner, comp);
+            link_added(owner, comp);
+            pool.add(owner, std::move(comp));
+        }
+
+        template<typename T>
+        bool remove_component(EntityID owner) {
+            if (m_recording) record_remove<T>(owner);
+            bool removed = remove_cascade<T>(m_pools, owner);
+            unlink_removed<T>(std::span<const EntityID>(&owner, 1));
+            return removed;
+        }
+
+        /* Batched removal for mass despawns, the child pools are fixed up once for the whole batch */
+        template<typename T>
+        std::size_t remove_components(std::span<const EntityID> owners) {
+            if (m_recording) {
+                for (EntityID owner : owners) record_remove<T>(owner);
+            }
+            std::size_t removed = remove_cascade<T>(m_pools, owners);
+            unlink_removed<T>(owners);
+            return removed;
         }
 
         template<typename T>
@@ -59,91 +404,854 @@ class World {
             return m_pools.get<T>().find(eid);
         }
 
+        /*
+         * Change detection, see ComponentPool::newer. Every write to a pool is
+         * stamped with the current change tick, which advances right after each
+         * of the world's own readers (the hierarchy, then the renderer), so at
+         * least once per world tick. A reader remembers change_tick() when it
+         * runs and passes it as since next time, to visit only what was added
+         * or written after it.
+         */
+        uint32_t change_tick() const {
+            return m_change_tick;
+        }
+
+        template<typename T, typename F>
+        void added(uint32_t since, F&& fn) {
+            m_pools.get<T>().for_each_added(since, std::forward<F>(fn));
+        }
+
+        template<typename T, typename F>
+        void changed(uint32_t since, F&& fn) {
+            m_pools.get<T>().for_each_changed(since, std::forward<F>(fn));
+        }
+
+        /*
+         * Applies command buffers at a sync point, see command_buffer.hpp. The
+         * commands of all the buffers are coalesced by pool: each pool gets one
+         * sorted batch of removals through remove_cascade, so the child pools
+         * are fixed up once however many entities go, then its adds. Adds to
+         * an entity destroyed in the same apply are dropped, and so are adds
+         * of a component the entity already has. The buffers are cleared.
+         */
+        void apply(std::span<Commands> buffers) {
+            std::vector<EntityID> destroyed;
+            for (auto& cmds : buffers) {
+                if (m_recording) {
+                    for (EntityID eid : cmds.created()) m_recorder->world().record(m_tick, recording::WORLD_CREATE, eid);
+                }
+                destroyed.insert(destroyed.end(), cmds.destroyed().begin(), cmds.destroyed().end());
+            }
+            std::sort(destroyed.begin(), destroyed.end());
+            destroyed.erase(std::unique(destroyed.begin(), destroyed.end()), destroyed.end());
+
+            std::vector<EntityID> owners;
+            m_pools.for_each([&]<typename Pool>(Pool& pool) {
+                using Comp = typename Pool::value_type;
+                owners.assign(destroyed.begin(), destroyed.end());
+                for (const auto& cmds : buffers) {
+                    auto removes = cmds.template removes<Comp>();
+                    owners.insert(owners.end(), removes.begin(), removes.end());
+                }
+                std::sort(owners.begin(), owners.end());
+                owners.erase(std::unique(owners.begin(), owners.end()), owners.end());
+
+                /* Only what is still there, a cascade from another pool may have taken it already */
+                std::erase_if(owners, [&pool](EntityID owner) { return !pool.find(owner).has_value(); });
+                if (!owners.empty()) remove_components<Comp>(owners);
+            });
+
+            std::array<std::vector<EntityID>, Pools::size()> added;
+            m_pools.for_each([&]<typename Pool>(Pool& pool) {
+                auto& pool_added = added[m_pools.find<Pool>()];
+                for (auto& cmds : buffers) {
+                    for (auto& entry : cmds.template adds<typename Pool::value_type>()) {
+                        if (std::binary_search(destroyed.begin(), destroyed.end(), entry.owner)) continue;
+                        /* The component in the pool is kept, the duplicate never entered a pool so it holds nothing to free */
+                        if (pool.find(entry.owner).has_value()) continue;
+                        link_added(entry.owner, entry.data);
+                        pool.add(entry.owner, std::move(entry.data));
+                        pool_added.push_back(entry.owner);
+                    }
+                }
+            });
+
+            /* Every parent is in its pool by now, whichever buffer or pool order it came in */
+            m_pools.for_each([&]<typename Pool>(Pool& pool) {
+                using Parent = typename Pool::traits::parent;
+                if constexpr (!std::is_void_v<Parent>) {
+                    auto& parents = m_pools.get<Parent>();
+                    for (EntityID owner : added[m_pools.find<Pool>()]) {
+                        std::size_t idx = pool.find(owner).value();
+                        auto parent = parents.find(owner);
+                        if (parent.has_value() && pool.entry_at(idx).data.*Pool::traits::parent_idx != parent.value()) {
+                            set_parent_idx(pool, idx, parent.value());
+                        }
+                    }
+                }
+            });
+
+            /* Recorded as they ended up, a replay adds them in the same order without resolving anything */
+            if (m_recording) {
+                m_pools.for_each([&]<typename Pool>(Pool& pool) {
+                    for (EntityID owner : added[m_pools.find<Pool>()]) {
+                        record_add(pool, owner, pool.entry_at(pool.find(owner).value()).data);
+                    }
+                });
+            }
+
+            for (auto& cmds : buffers) cmds.clear();
+        }
+
+        void apply(Commands& cmds) {
+            apply(std::span<Commands>(&cmds, 1));
+        }
+
     private:
+        void start_recording() {
+            if (!save(recording::initial_state_path(m_recorder->path().c_str()).c_str())) {
+                std::cerr << "[ERROR] World::start_recording -> Could not save the initial state, not recording" << std::endl;
+                m_recorder.reset();
+                return;
+            }
+            m_tick = PhysicsCore::INVALID_TICK;
+            m_physics.record(&m_recorder->physics());
+            m_recording = true;
+        }
+
+        /* Physics has stopped and flushed its stream already */
+        void stop_recording() {
+            m_recording = false;
+            m_recorder->world().flush(m_tick);
+            m_recorder.reset();
+        }
+
+        /* Components are recorded raw, or as their Persistent part like in a save */
+        template<typename Pool, typename T>
+        void record_add(Pool&, EntityID owner, const T& comp) {
+            uint8_t pool_idx = static_cast<uint8_t>(m_pools.find<Pool>());
+            if constexpr (std::is_trivially_copyable_v<T>) {
+                m_recorder->world().record(m_tick, recording::WORLD_ADD, pool_idx, owner, comp);
+            } else {
+                m_recorder->world().record(m_tick, recording::WORLD_ADD, pool_idx, owner, comp.persist());
+            }
+        }
+
+        template<typename T>
+        void record_remove(EntityID owner) {
+            using Pool = std::remove_reference_t<decltype(m_pools.get<T>())>;
+            uint8_t pool_idx = static_cast<uint8_t>(m_pools.find<Pool>());
+            m_recorder->world().record(m_tick, recording::WORLD_REMOVE, pool_idx, owner);
+        }
+
+        template<typename T>
+        void link_added(EntityID owner, const T& comp) {
+            if constexpr (std::is_same_v<T, ParentLink>) {
+                if (!m_hierarchy.link(owner, comp.entity)) {
+                    std::cerr << "[ERROR] World::link_added -> " << owner << " cannot be a child of " << comp.entity << std::endl;
+                }
+            }
+        }
+
+        /* Whether directly or through a cascade, owners that lost their Transform or their ParentLink leave the hierarchy */
+        template<typename T>
+        void unlink_removed(std::span<const EntityID> owners) {
+            if constexpr (std::is_same_v<T, Transform> || std::is_same_v<T, ParentLink>) {
+                if (m_hierarchy.size() == 0) return;
+
+                std::vector<EntityID> erased, unlinked;
+                for (EntityID owner : owners) {
+                    if (!m_pools.get<Transform>().find(owner).has_value()) {
+                        erased.push_back(owner);
+                    } else if (!m_pools.get<ParentLink>().find(owner).has_value()) {
+                        unlinked.push_back(owner);
+                    }
+                }
+                m_hierarchy.erase(erased);
+                m_hierarchy.unlink(unlinked);
+            }
+        }
+
+        /*
+         * Brings the world position of every node below a moved Transform or a
+         * changed ParentLink up to date, parents first, in one pass over the
+         * hierarchy. Nothing else is touched.
+         */
+        void update_hierarchy() {
+            auto& transforms = m_pools.get<Transform>();
+            auto& links = m_pools.get<ParentLink>();
+            if (m_hierarchy.size() != 0) {
+                transforms.for_each_changed(m_hierarchy_tick, [this](std::size_t, const auto& entry) {
+                    m_hierarchy.mark_dirty(entry.owner);
+                });
+                links.for_each_changed(m_hierarchy_tick, [this](std::size_t, const auto& entry) {
+                    m_hierarchy.mark_dirty(entry.owner);
+                });
+
+                m_hierarchy.propagate([this, &transforms, &links](EntityID node, EntityID parent) {
+                    auto link = links.find(node);
+                    auto parent_idx = transforms.find(parent);
+                    if (!link.has_value() || !parent_idx.has_value()) return;
+
+                    const ParentLink& l = std::as_const(links).entry_at(link.value()).data;
+                    move_transform(l.transform_idx, std::as_const(transforms).entry_at(parent_idx.value()).data.value + l.offset);
+                });
+            }
+            m_hierarchy_tick = m_change_tick;
+            advance_change_tick();
+        }
+
+        /* Applies a recorded structural change, false if the world no longer matches the recording */
+        bool replay_change(const recording::Record& rec) {
+            switch (rec.kind) {
+                case recording::WORLD_CREATE: {
+                    /* Command buffers reserve ids ahead of time, and apply them in buffer order */
+                    EntityID eid;
+                    if (!rec.read(eid)) return false;
+                    if (eid >= m_entity_manager.next_id()) m_entity_manager.restore(eid + 1);
+                    return true;
+                }
+                case recording::WORLD_REMOVE: {
+                    uint8_t pool_idx;
+                    EntityID owner;
+                    if (!rec.read(pool_idx, owner) || pool_idx >= m_pools.size()) return false;
+                    bool removed = false;
+                    m_pools.for_index(pool_idx, [this, owner, &removed]<typename Pool>(Pool&) {
+                        removed = remove_cascade<typename Pool::value_type>(m_pools, owner);
+                        unlink_removed<typename Pool::value_type>(std::span<const EntityID>(&owner, 1));
+                    });
+                    return removed;
+                }
+                case recording::WORLD_ADD: {
+                    uint8_t pool_idx;
+                    if (!rec.peek(pool_idx) || pool_idx >= m_pools.size()) return false;
+                    bool added = false;
+                    m_pools.for_index(pool_idx, [this, &rec, &added]<typename Pool>(Pool& pool) {
+                        using Comp = typename Pool::value_type;
+                        uint8_t idx;
+                        EntityID owner;
+                        if constexpr (std::is_trivially_copyable_v<Comp>) {
+                            std::array<uint8_t, sizeof(Comp)> bytes;
+                            if (!rec.read(idx, owner, bytes)) return;
+                            link_added(owner, std::bit_cast<Comp>(bytes));
+                            pool.add(owner, std::bit_cast<Comp>(bytes));
+                        } else {
+                            typename Comp::Persistent persisted;
+                            if (!rec.read(idx, owner, persisted)) return;
+                            pool.add(owner, Comp::restore(m_physics, persisted));
+                        }
+                        added = true;
+                    });
+                    return added;
+                }
+                default:
+                    return false;
+            }
+        }
+
+        /* Source is a save::Reader or a checkpoint::Image, both throw on a missing or mismatched block */
+        template<typename Source>
+        bool load_blocks(const Source& src) {
+            auto world = src.template block<save::WorldState>(save::WORLD);
+            if (world.size() != 1) return false;
+            PhysicsCore::BodyArrays bodies{
+                world[0].physics_tick,
+                src.template block<PhysicsCore::PhysicsData>(save::PHYSICS_DATA),
+                src.template block<std::size_t>(save::PHYSICS_TRANSFORMS),
+                src.template block<uint32_t>(save::PHYSICS_INPUT_SEQS),
+                src.template block<EntityID>(save::PHYSICS_IDS)
+            };
+            auto physics_reg = src.template block<ComponentEntry<ComponentHandle>>(save::PHYSICS_REGISTRY);
+            auto render_reg = src.template block<ComponentEntry<ComponentHandle>>(save::RENDER_REGISTRY);
+
+            /* Every block is fetched and checked up front, so a bad file fails before anything is touched */
+            if (!valid_blocks(src, bodies, physics_reg, render_reg)) return false;
+
+            /* Pools first, the bodies they drop queue removals that restore() flushes before adopting the saved ones */
+            uint32_t kind = save::POOL_BASE;
+            m_pools.for_each([this, &src, &kind]<typename Pool>(Pool& pool) {
+                using Comp = typename Pool::value_type;
+                if constexpr (std::is_trivially_copyable_v<ComponentEntry<Comp>>) {
+                    auto block = src.template block<ComponentEntry<Comp>>(kind++);
+                    pool.load(block.data(), block.size());
+                } else {
+                    auto block = src.template block<typename Comp::Persistent>(kind++);
+                    pool.load(block.size(), [this, &block](std::size_t i) {
+                        return ComponentEntry<Comp>(block[i].eid, Comp::restore(m_physics, block[i]));
+                    });
+                }
+            });
+            m_physics_reg.data.load(physics_reg.data(), physics_reg.size());
+            m_render_reg.data.load(render_reg.data(), render_reg.size());
+            m_physics.restore(bodies);
+            m_entity_manager.restore(world[0].next_entity);
+
+            m_hierarchy.clear();
+            for (const auto& entry : m_pools.get<ParentLink>().entries()) link_added(entry.owner, entry.data);
+            return true;
+        }
+
+        /*
+         * Whether the blocks load into a consistent world: every index read from
+         * the file points at an entry of the right owner, owners are unique in
+         * each pool and registry, each registry has one entry per component
+         * registered with it, and the bodies are exactly those of the PhysicsBody
+         * components. Throws like load_blocks on a missing block.
+         */
+        template<typename Source>
+        bool valid_blocks(const Source& src, const PhysicsCore::BodyArrays& bodies,
+                std::span<const ComponentEntry<ComponentHandle>> physics_reg,
+                std::span<const ComponentEntry<ComponentHandle>> render_reg) {
+            auto fail = [](const char* what) {
+                std::cerr << "[ERROR] World::load_blocks -> " << what << std::endl;
+                return false;
+            };
+
+            /* Owner of each entry of each pool, and the index of its parent entry if the pool has a parent */
+            std::array<std::vector<EntityID>, Pools::size()> owners;
+            std::array<std::vector<std::size_t>, Pools::size()> parents;
+            std::array<const void*, Pools::size()> registries{};
+            m_pools.for_each([&]<typename Pool>(Pool&) {
+                using Comp = typename Pool::value_type;
+                using Parent = typename Pool::traits::parent;
+                std::size_t p = m_pools.template find<Pool>();
+                uint32_t kind = save::POOL_BASE + static_cast<uint32_t>(p);
+
+                if constexpr (std::is_trivially_copyable_v<ComponentEntry<Comp>>) {
+                    for (const auto& entry : src.template block<ComponentEntry<Comp>>(kind)) {
+                        owners[p].push_back(entry.owner);
+                        if constexpr (!std::is_void_v<Parent>) parents[p].push_back(entry.data.*Pool::traits::parent_idx);
+                    }
+                } else {
+                    /* The Persistent part keeps the index of the parent Transform */
+                    for (const auto& persistent : src.template block<typename Comp::Persistent>(kind)) {
+                        owners[p].push_back(persistent.eid);
+                        if constexpr (!std::is_void_v<Parent>) parents[p].push_back(persistent.transform_idx);
+                    }
+                }
+                if constexpr (std::is_same_v<typename Pool::registry_type, PhysicsRegistry>) registries[p] = &m_physics_reg;
+                if constexpr (std::is_same_v<typename Pool::registry_type, RenderRegistry>) registries[p] = &m_render_reg;
+            });
+
+            auto unique = [](std::vector<EntityID> ids) {
+                std::sort(ids.begin(), ids.end());
+                return std::adjacent_find(ids.begin(), ids.end()) == ids.end();
+            };
+
+            bool ok = true;
+            m_pools.for_each([&]<typename Pool>(Pool&) {
+                using Parent = typename Pool::traits::parent;
+                std::size_t p = m_pools.template find<Pool>();
+                if (!ok) return;
+                if (!unique(owners[p])) {
+                    ok = fail("Component owned twice");
+                    return;
+                }
+
+                if constexpr (!std::is_void_v<Parent>) {
+                    using ParentPool = std::remove_reference_t<decltype(m_pools.template get<Parent>())>;
+                    const auto& parent_owners = owners[m_pools.template find<ParentPool>()];
+                    for (std::size_t i = 0; i < parents[p].size(); ++i) {
+                        std::size_t idx = parents[p][i];
+                        if (idx >= parent_owners.size() || parent_owners[idx] != owners[p][i]) {
+                            ok = fail("Component not pointing at its owner's parent component");
+                            return;
+                        }
+                    }
+                }
+            });
+            if (!ok) return false;
+
+            auto valid_registry = [&](std::span<const ComponentEntry<ComponentHandle>> reg, const void* registry) {
+                std::size_t num_registered = 0;
+                for (std::size_t p = 0; p < Pools::size(); ++p) {
+                    if (registries[p] == registry) num_registered += owners[p].size();
+                }
+                if (reg.size() != num_registered) return false;
+
+                std::vector<EntityID> reg_owners;
+                reg_owners.reserve(reg.size());
+                for (const auto& entry : reg) {
+                    const ComponentHandle& h = entry.data;
+                    if (h.owner != entry.owner || h.pool_idx >= Pools::size() || registries[h.pool_idx] != registry ||
+                            h.comp_idx >= owners[h.pool_idx].size() || owners[h.pool_idx][h.comp_idx] != h.owner) {
+                        return false;
+                    }
+                    reg_owners.push_back(entry.owner);
+                }
+                return unique(std::move(reg_owners));
+            };
+            if (!valid_registry(physics_reg, &m_physics_reg)) return fail("Bad physics registry");
+            if (!valid_registry(render_reg, &m_render_reg)) return fail("Bad render registry");
+
+            /* One body per PhysicsBody, for the same entity, following its owner's Transform */
+            std::size_t num_bodies = bodies.ids.size();
+            if (bodies.data.size() != num_bodies || bodies.transforms.size() != num_bodies || bodies.input_seqs.size() != num_bodies) {
+                return fail("Body arrays of different sizes");
+            }
+            std::vector<EntityID> body_ids(bodies.ids.begin(), bodies.ids.end());
+            std::vector<EntityID> component_ids = owners[m_pools.template find<ComponentPool<PhysicsBody, PhysicsRegistry>>()];
+            std::sort(body_ids.begin(), body_ids.end());
+            std::sort(component_ids.begin(), component_ids.end());
+            if (body_ids != component_ids) return fail("Bodies do not match the PhysicsBody components");
+
+            const auto& transform_owners = owners[m_pools.template find<ComponentPool<Transform, void>>()];
+            for (std::size_t i = 0; i < num_bodies; ++i) {
+                if (bodies.transforms[i] >= transform_owners.size() || transform_owners[bodies.transforms[i]] != bodies.ids[i]) {
+                    return fail("Body not pointing at its owner's Transform");
+                }
+            }
+            return true;
+        }
+
+        /*
+         * Hands the writer the state of this tick: the physics snapshot pinned in
+         * place and copies of the pool pages written since the last checkpoint.
+         */
+        void capture_checkpoint(uint32_t tick) {
+            auto start = std::chrono::steady_clock::now();
+            checkpoint::Capture* c = m_checkpoint->begin(start);
+            if (c == nullptr || tick == PhysicsCore::INVALID_TICK) return;
+            if (!m_physics.pin(tick, c->physics)) return;
+            /* Restoring checks the bodies against the components, a checkpoint taken before physics caught up would not load */
+            if (!matches_components(c->physics)) {
+                m_physics.unpin();
+                m_checkpoint->retry(start);
+                return;
+            }
+
+            save::WorldState state{m_entity_manager.next_id(), tick};
+            c->block<save::WorldState>(save::WORLD, 1);
+            c->page(save::WORLD, 0, std::span<const save::WorldState>(&state, 1));
+
+            capture_pool(*c, save::PHYSICS_REGISTRY, m_physics_reg.data);
+            capture_pool(*c, save::RENDER_REGISTRY, m_render_reg.data);
+            uint32_t kind = save::POOL_BASE;
+            m_pools.for_each([this, c, &kind](auto& pool) { capture_pool(*c, kind++, pool); });
+
+            m_checkpoint->submit(std::chrono::steady_clock::now() - start);
+#ifdef SERVER
+            if (m_replication) m_replication->record_checkpoint_time(m_checkpoint->last_capture_time());
+#endif
+        }
+
+        /* Whether physics has applied every add, removal and Transform move of the PhysicsBody components */
+        bool matches_components(std::span<const PhysicsSnapshot> bodies) {
+            auto& pool = m_pools.get<PhysicsBody>();
+            auto& transforms = m_pools.get<Transform>();
+            if (bodies.size() != pool.size()) return false;
+            for (const auto& body : bodies) {
+                if (!pool.find(body.id).has_value() || body.transform_idx >= transforms.size() ||
+                        transforms.entry_at(body.transform_idx).owner != body.id) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        template<typename Pool>
+        static void capture_pool(checkpoint::Capture& c, uint32_t kind, Pool& pool) {
+            using Comp = typename Pool::value_type;
+            const auto& entries = pool.entries();
+
+            if constexpr (std::is_trivially_copyable_v<ComponentEntry<Comp>>) {
+                c.block<ComponentEntry<Comp>>(kind, entries.size());
+                /* A dirty page is exactly one storage block */
+                pool.take_dirty_pages([&](std::size_t first, std::size_t) {
+                    c.page(kind, first, entries.chunk(first / Pool::PAGE_ENTRIES));
+                });
+            } else {
+                using Persistent = typename Comp::Persistent;
+                c.block<Persistent>(kind, entries.size());
+                std::array<Persistent, Pool::PAGE_ENTRIES> page;
+                pool.take_dirty_pages([&](std::size_t first, std::size_t count) {
+                    for (std::size_t i = 0; i < count; ++i) page[i] = entries[first + i].data.persist();
+                    c.page(kind, first, std::span<const Persistent>(page.data(), count));
+                });
+            }
+        }
+
         void loop() {
             auto next = std::chrono::steady_clock::now();
             while (m_running.load(std::memory_order_relaxed)) {
+                auto start = std::chrono::steady_clock::now();
+#ifdef SERVER
                 poll_events();
-
-                /* Recover last recorded physics snapshot and update transforms */
-                process_physics_snapshot();
-
-                /* Build all the render commands */
-                publish_render_commands();
+                update(start);
+#else
+                m_input.consume(SDL_GetTicksNS(), m_actions, m_action_state);
+                update(start);
+                m_input.tick_done(SDL_GetTicksNS());
+#endif
 
                 next += m_period;
                 std::this_thread::sleep_until(next);
             }
         }
 
+        /* One world tick on the latest physics snapshot, shared by the paced loop and step() */
+        void update(std::chrono::steady_clock::time_point start) {
+            /* Recover last recorded physics snapshot and update transforms */
+            uint32_t tick = process_physics_snapshot();
+            if (m_recording) {
+                m_tick = tick;
+                m_recorder->world().record(tick, recording::WORLD_TICK);
+                m_recorder->world().tick(tick);
+            }
+            update_hierarchy();
+
+            if (m_checkpoint && m_checkpoint->due(start)) capture_checkpoint(tick);
+
+#ifdef SERVER
+            if (m_replication) {
+                m_replication->update(tick);
+                m_replication->record_tick_time(std::chrono::steady_clock::now() - start);
+            }
+#else
+            (void) tick;
+            if (m_replication) {
+                if (m_replication->poll()) {
+                    apply_replicated_view();
+                    reconcile_avatar();
+                }
+                predict_local_input();
+            }
+
+            /* Build all the render commands */
+            publish_render_commands();
+#endif
+        }
+
+        void advance_change_tick() {
+            ++m_change_tick;
+            m_pools.for_each([this](auto& pool) { pool.set_change_tick(m_change_tick); });
+        }
+
+#ifdef SERVER
         void poll_events() {
             SDL_Event event;
-            while (m_renderer.poll_event(&event)) {
+            while (SDL_PollEvent(&event)) {
                 switch (event.type) {
                     case SDL_EVENT_QUIT:
                         m_running.store(false, std::memory_order_relaxed);
+                        break;
                     default:
                         break;
                 }
             }
         }
+#else
+        /* On the thread that owns the window until the world stops, events are handed over as they arrive */
+        void pump_input() {
+            while (m_running.load(std::memory_order_relaxed)) {
+                SDL_Event event;
+                if (!m_renderer.wait_event(&event, PUMP_TIMEOUT_MS)) continue;
 
-        void process_physics_snapshot() {
+                switch (event.type) {
+                    case SDL_EVENT_QUIT:
+                        m_running.store(false, std::memory_order_relaxed);
+                        break;
+                    case SDL_EVENT_KEY_DOWN:
+                    case SDL_EVENT_KEY_UP:
+                        if (!m_input.capture(event)) {
+                            std::cerr << "[ERROR] World::pump_input -> Input queue full, event dropped" << std::endl;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+#endif
+
+        /* Bodies at rest are not written, so they do not show up as changed */
+        void move_transform(std::size_t idx, const Vector2D<double>& pos) {
+            auto& transforms = m_pools.get<Transform>();
+            if (std::as_const(transforms).entry_at(idx).data.value != pos) transforms.entry_at(idx).data.value = pos;
+        }
+
+        uint32_t process_physics_snapshot() {
+            auto& transforms = m_pools.get<Transform>();
             uint32_t tick{0};
             do {
                 const std::vector<PhysicsSnapshot>& last_snapshot = m_physics.get_last_snapshot_ref(tick);
+#ifdef SERVER
+                if (m_replication) m_replication->capture(last_snapshot);
+#endif
                 
                 for (size_t idx = 0; idx < last_snapshot.size(); ++idx) {
                     const PhysicsSnapshot& snap = last_snapshot[idx];
-                    auto& transform_c = m_pools.get<Transform>().entry_at(snap.transform_idx);
                     /* Update the position of the Entity */
-                    if (snap.id == transform_c.owner) {
-                        transform_c.data.value = snap.pos;
+                    if (snap.id == std::as_const(transforms).entry_at(snap.transform_idx).owner) {
+                        move_transform(snap.transform_idx, snap.pos);
                     }
                 }
             } while (!m_physics.verify_snapshot_valid(tick));
+
+            return tick;
         }
 
+#ifdef SERVER
+        EntityID spawn_avatar() {
+            EntityID eid = create_entity();
+            Vector2D<double> pos{240, 120};
+            add_component(eid, Transform{pos});
+            add_component(eid, PhysicsBody(m_physics, eid, get_component_idx<Transform>(eid).value(), pos));
+            return eid;
+        }
+#else
+        /* One input per world tick, applied locally right away and sent until acknowledged */
+        void predict_local_input() {
+            const ActionState& a = m_action_state;
+            InputCmd cmd{++m_input_seq,
+                static_cast<int8_t>(a.active(Action::MOVE_RIGHT) - a.active(Action::MOVE_LEFT)),
+                static_cast<int8_t>(a.active(Action::MOVE_DOWN) - a.active(Action::MOVE_UP))};
+            m_prediction.predict(cmd);
+
+            std::array<InputCmd, input::MAX_REDUNDANT> pending;
+            std::size_t count = m_prediction.unacked_inputs(pending.data(), pending.size());
+            m_replication->send_inputs(pending.data(), count);
+
+            auto local = m_remote_entities.find(m_replication->avatar());
+            auto pos = m_prediction.position(m_replication->avatar());
+            if (local == m_remote_entities.end() || !pos.has_value()) return;
+
+            auto idx = get_component_idx<Transform>(local->second);
+            if (idx.has_value()) move_transform(idx.value(), pos.value());
+        }
+
+        void reconcile_avatar() {
+            EntityID avatar = m_replication->avatar();
+            if (avatar == INVALID_ENTITY) return;
+
+            uint32_t tick;
+            const SnapshotView& view = m_replication->latest_view(tick);
+            auto it = std::lower_bound(view.begin(), view.end(), avatar,
+                    [](const QuantizedState& s, EntityID id) { return s.id < id; });
+            if (it == view.end() || it->id != avatar) return;
+
+            if (!m_prediction.controls(avatar)) {
+                m_prediction.control(avatar, *it);
+            } else {
+                m_prediction.reconcile(avatar, *it, m_replication->input_ack());
+            }
+        }
+
+        /* Creates, moves and destroys the local mirrors of the replicated bodies */
+        void apply_replicated_view() {
+            uint32_t tick;
+            const SnapshotView& view = m_replication->latest_view(tick);
+
+            for (const auto& state : view) {
+                auto it = m_remote_entities.find(state.id);
+                if (it == m_remote_entities.end()) {
+                    EntityID eid = m_commands.create();
+                    m_commands.add(eid, Transform{quant::position(state)});
+                    m_commands.add(eid, RectangleDrawable(0));
+                    m_remote_entities.emplace(state.id, eid);
+                    continue;
+                }
+
+                /* Predicted bodies are placed by the prediction, not by the (older) server view */
+                if (m_prediction.controls(state.id)) continue;
+
+                auto idx = get_component_idx<Transform>(it->second);
+                if (idx.has_value()) move_transform(idx.value(), quant::position(state));
+            }
+
+            for (auto it = m_remote_entities.begin(); it != m_remote_entities.end();) {
+                bool alive = std::binary_search(view.begin(), view.end(), QuantizedState{it->first, 0, 0, 0, 0},
+                        [](const QuantizedState& a, const QuantizedState& b) { return a.id < b.id; });
+                if (alive) {
+                    ++it;
+                    continue;
+                }
+                m_commands.destroy(it->second);
+                m_prediction.release(it->first);
+                it = m_remote_entities.erase(it);
+            }
+
+            /* Spawns and despawns of the whole view in one go */
+            apply(m_commands);
+        }
+#endif
+
+#ifndef SERVER
+        /*
+         * One tight loop per renderable pool, chosen at compile time, instead of
+         * a dispatch per entity through the RenderRegistry. Commands come out
+         * grouped by component type, in pool order.
+         *
+         * The command of each entry is cached, and only rebuilt when the entry
+         * or its Transform changed since the last frame. Nothing is published
+         * if nothing changed, the renderer keeps showing the last frame.
+         */
         void publish_render_commands() {
-            std::vector<RenderCommand> render_commands;
-            for (auto& entry : m_render_reg.data) {
-                auto& renderable = entry.data;
-                m_pools.for_index(renderable.pool_idx, [this, &renderable, &render_commands]<typename Pool>(Pool& pool) {
-                    using Comp = typename Pool::value_type;
-
-                    if constexpr (requires (Comp& c, std::vector<RenderCommand>& rc, Transform& t) {
-                        c.build_render_cmd(rc, t);
-                    }) {
-                        auto& comp = pool.entry_at(renderable.comp_idx).data;
-                        comp.build_render_cmd(
-                                render_commands,
-                                this->m_pools.get<Transform>().entry_at(comp.transform_idx).data);
+            const auto& transforms = m_pools.get<Transform>();
+            bool dirty = (m_render_tick == 0);
+            m_pools.for_each([this, &transforms, &dirty]<typename Pool>(Pool& pool) {
+                if constexpr (Renderable<typename Pool::value_type>) {
+                    auto& cache = m_render_cache[m_pools.find<Pool>()];
+                    if (cache.size() != pool.size()) {
+                        cache.resize(pool.size());
+                        dirty = true;
                     }
-                });
+
+                    const auto& entries = pool.entries();
+                    for (std::size_t i = 0; i < entries.size(); ++i) {
+                        std::size_t t = entries[i].data.transform_idx;
+                        if (!pool.changed_since(i, m_render_tick) && !transforms.changed_since(t, m_render_tick)) continue;
+                        cache[i] = entries[i].data.render_cmd(transforms.entry_at(t).data);
+                        dirty = true;
+                    }
+                }
+            });
+            dirty = publish_tilemaps(transforms) || dirty;
+            publish_emitters(transforms);
+
+            m_render_tick = m_change_tick;
+            advance_change_tick();
+            if (!dirty) return;
+
+            std::vector<RenderCommand> render_commands;
+            render_commands.reserve(m_render_reg.data.size() + m_tilemap_cache.size());
+            render_commands.insert(render_commands.end(), m_tilemap_cache.begin(), m_tilemap_cache.end());
+            for (const auto& cache : m_render_cache) {
+                render_commands.insert(render_commands.end(), cache.begin(), cache.end());
             }
             m_renderer.publish_frame(std::move(render_commands));
         }
 
+        /*
+         * One command per visible chunk of every TileMapDrawable, rebuilt only
+         * when a map moved, was added or removed, or had tiles changed. Visible
+         * chunks never baked or changed since are sent to the renderer to bake
+         * first, chunks out of view are left alone until they come into it.
+         */
+        bool publish_tilemaps(const ComponentPool<Transform, void>& transforms) {
+            const auto& pool = m_pools.get<TileMapDrawable>();
+            const auto& entries = pool.entries();
+            bool dirty = (pool.size() != m_tilemap_drawn);
+            for (std::size_t i = 0; i < entries.size() && !dirty; ++i) {
+                const TileMapDrawable& drawable = entries[i].data;
+                dirty = pool.changed_since(i, m_render_tick) || transforms.changed_since(drawable.transform_idx, m_render_tick)
+                    || (drawable.map < m_tilemaps.size() && m_tilemaps[drawable.map].drawn_version != m_tilemaps[drawable.map].map.version());
+            }
+            m_tilemap_drawn = pool.size();
+            if (!dirty) return false;
+
+            Vector2D<double> view = m_renderer.size();
+            m_tilemap_cache.clear();
+            for (std::size_t i = 0; i < entries.size(); ++i) {
+                const TileMapDrawable& drawable = entries[i].data;
+                if (drawable.map >= m_tilemaps.size()) continue;
+
+                TileMapEntry& entry = m_tilemaps[drawable.map];
+                entry.drawn_version = entry.map.version();
+                Vector2D<double> origin = transforms.entry_at(drawable.transform_idx).data.value;
+                double side = entry.map.chunk_pixels();
+
+                /* Only the chunks overlapping the view are walked, however large the map */
+                auto first = [side](double from) { return static_cast<int64_t>(std::floor(from / side)); };
+                int64_t x0 = std::max<int64_t>(first(-origin.x), 0);
+                int64_t y0 = std::max<int64_t>(first(-origin.y), 0);
+                int64_t x1 = std::min<int64_t>(first(view.x - origin.x) + 1, entry.map.chunks_x());
+                int64_t y1 = std::min<int64_t>(first(view.y - origin.y) + 1, entry.map.chunks_y());
+                for (int64_t y = y0; y < y1; ++y) {
+                    for (int64_t x = x0; x < x1; ++x) {
+                        std::size_t chunk = static_cast<std::size_t>(y * entry.map.chunks_x() + x);
+                        uint32_t id = entry.first_chunk + static_cast<uint32_t>(chunk);
+                        if (entry.map.take_dirty(chunk)) {
+                            m_renderer.bake_chunk(ChunkBake{id, entry.map.chunk_pixels(), entry.map.bake(chunk)});
+                        }
+
+                        RenderCommand cmd{origin + entry.map.chunk_offset(chunk), Vector2D<double>{side, side}, Vector3D<double>{255, 255, 255}};
+                        cmd.chunk = id;
+                        m_tilemap_cache.push_back(cmd);
+                    }
+                }
+            }
+            return true;
+        }
+
+        /* Sent again only when an emitter was added, removed, edited or moved, the renderer keeps the last ones */
+        void publish_emitters(const ComponentPool<Transform, void>& transforms) {
+            const auto& pool = m_pools.get<ParticleEmitter>();
+            const auto& entries = pool.entries();
+            bool dirty = (pool.size() != m_emitter_states.size());
+            for (std::size_t i = 0; i < entries.size() && !dirty; ++i) {
+                dirty = pool.changed_since(i, m_render_tick) || transforms.changed_since(entries[i].data.transform_idx, m_render_tick);
+            }
+            if (!dirty) return;
+
+            m_emitter_states.clear();
+            for (const auto& entry : entries) {
+                m_emitter_states.push_back(EmitterState{entry.owner, transforms.entry_at(entry.data.transform_idx).data.value, entry.data.params});
+            }
+            m_renderer.publish_emitters(m_emitter_states);
+        }
+#endif
+
     private:
         SDL m_sdl_instance;
         std::thread m_world_thread;
         std::atomic<bool> m_running;
 
+        SDLNet      m_sdl_net;
+        std::optional<Recorder>     m_recorder;     // Physics records into it, destroyed after m_physics
         PhysicsCore m_physics;
+        std::optional<Checkpointer>     m_checkpoint;   // Pins physics snapshots, destroyed before m_physics
+#ifdef SERVER
+        std::optional<ReplicationServer>    m_replication;
+#else
         Renderer    m_renderer;
+        std::optional<ReplicationClient>    m_replication;
+        std::unordered_map<EntityID, EntityID>  m_remote_entities;     // Server entity -> local mirror
+        Commands    m_commands;
+
+        std::array<std::vector<RenderCommand>, Pools::size()>   m_render_cache;     // Per renderable pool, one command per entry
+        uint32_t    m_render_tick{0};       // Change tick of the last frame built, 0 before the first
+        std::vector<RenderCommand>  m_tilemap_cache;    // Visible chunks, drawn before the rest
+        std::size_t m_tilemap_drawn{0};     // TileMapDrawables in the last frame built
+        std::vector<EmitterState>   m_emitter_states;   // Last sent to the renderer
+
+        Prediction  m_prediction;
+        uint32_t    m_input_seq{0};
+
+        InputPipeline   m_input;
+        ActionMap       m_actions;
+        ActionState     m_action_state;     // World thread only
+#endif
+
+        std::optional<assets::Loader>   m_assets;   // Uploads to m_renderer, destroyed before it
+
+        uint32_t    m_change_tick{1};       // Same start as the pools'
+
+        Hierarchy   m_hierarchy;            // Entities with a ParentLink and their ancestors
+        uint32_t    m_hierarchy_tick{0};    // Change tick of the last hierarchy pass
+
+        struct TileMapEntry {
+            TileMap     map;
+            uint32_t    first_chunk;        // Renderer ids of its chunks start there
+            uint32_t    drawn_version;      // TileMap::version of the last frame built
+        };
+        std::vector<TileMapEntry>   m_tilemaps;     // Indexed by TileMapDrawable::map
+
+        bool        m_recording{false};
+        uint32_t    m_tick{PhysicsCore::INVALID_TICK};    // Last snapshot tick read, what changes are recorded against
 
         EntityManager   m_entity_manager;
         PhysicsRegistry m_physics_reg;
         RenderRegistry  m_render_reg;
 
-        TypeMap<
-            ComponentPool<Transform, void>,
-            ComponentPool<PhysicsBody, PhysicsRegistry>,
-            ComponentPool<RectangleDrawable, RenderRegistry>
-        > m_pools{
+        Pools m_pools{
             ComponentPool<Transform, void>{},
             ComponentPool<PhysicsBody, PhysicsRegistry>{&m_physics_reg},
-            ComponentPool<RectangleDrawable, RenderRegistry>{&m_render_reg}
+            ComponentPool<RectangleDrawable, RenderRegistry>{&m_render_reg},
+            ComponentPool<ParentLink, void>{},
+            ComponentPool<SpriteDrawable, RenderRegistry>{&m_render_reg},
+            ComponentPool<TileMapDrawable, RenderRegistry>{&m_render_reg},
+            ComponentPool<ParticleEmitter, void>{}
         };
 
         static constexpr double m_dt = 1.0 / 60.0;
@@ -152,6 +1260,10 @@ class World {
             std::chrono::duration_cast<std::chrono::steady_clock::duration>(
                 std::chrono::duration<double>{m_dt}
             );
+
+#ifndef SERVER
+        static constexpr int32_t PUMP_TIMEOUT_MS = 100;     // Bounds how long the pump takes to notice the world stopped
+#endif
 };
 
 #endif
@@ -0,0 +1,35 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "assets/pack.hpp"
+
+/*
+ * Usage: GameEngine_asset_pack out.pack file...
+ * Packs the files into one asset pack, each named after its file name without
+ * the extension. .bmp files are images, anything else is a blob.
+ */
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::fprintf(stderr, "Usage: %s out.pack file...\n", argv[0]);
+        return 1;
+    }
+
+    assets::Writer writer;
+    for (int i = 2; i < argc; ++i) {
+        std::filesystem::path path(argv[i]);
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            std::fprintf(stderr, "Could not open %s\n", argv[i]);
+            return 1;
+        }
+
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        assets::Kind kind = (path.extension() == ".bmp") ? assets::IMAGE : assets::BLOB;
+        if (!writer.add(path.stem().string(), kind, std::move(data))) return 1;
+    }
+
+    return writer.write(argv[1]) ? 0 : 1;
+}
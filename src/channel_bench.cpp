@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "net/channel.hpp"
+#include "net/lossy_link.hpp"
+
+/*
+ * Usage: GameEngine_channel_bench [loss [duplicate [jitter [messages [seed]]]]]
+ * Sends messages on every channel from one ChannelConnection to another over
+ * a LossyLink, in simulated time. The receiver drains fewer messages per step
+ * than are sent while the sender is busy, so its reliable channels fill up and
+ * have to push back. Checks that both reliable channels deliver every message
+ * exactly once, the ordered one in send order, and that the sequenced channel
+ * never goes backwards. The exit code is non zero if any check fails.
+ */
+using Clock = ChannelConnection::Clock;
+
+static constexpr uint32_t SENDS_PER_STEP = 4;       // Attempted per reliable channel
+static constexpr uint32_t DRAINS_PER_STEP = 2;      // Per reliable channel, all of them once sending is done
+static constexpr auto STEP = std::chrono::milliseconds(16);
+static constexpr uint32_t MAX_STEPS = 1'000'000;
+
+struct Check {
+    uint32_t    received{0};
+    uint32_t    duplicated{0};
+    uint32_t    out_of_order{0};
+};
+
+static void write_id(uint8_t* buf, uint32_t id) {
+    std::memcpy(buf, &id, sizeof(id));
+}
+static uint32_t read_id(const ChannelMessage& msg) {
+    uint32_t id;
+    std::memcpy(&id, msg.data.data(), sizeof(id));
+    return id;
+}
+
+int main(int argc, char** argv) {
+    LossyLink::Config config;
+    config.loss = (argc > 1) ? std::atof(argv[1]) : 0.2;
+    config.duplicate = (argc > 2) ? std::atof(argv[2]) : 0.1;
+    config.jitter = (argc > 3) ? std::atof(argv[3]) : 0.05;
+    uint32_t messages = (argc > 4) ? static_cast<uint32_t>(std::atoll(argv[4])) : 100'000;
+    config.seed = (argc > 5) ? static_cast<uint32_t>(std::atoll(argv[5])) : 1;
+    if (config.loss >= 1.0) {
+        std::fprintf(stderr, "Loss must be under 1\n");
+        return 1;
+    }
+
+    ChannelConnection sender, receiver;
+    LossyLink link(sender, receiver, config);
+
+    uint32_t sent_ordered = 0, sent_unordered = 0, sent_sequenced = 0;
+    uint32_t refused = 0;
+    Check ordered, unordered, sequenced;
+    std::vector<bool> seen(messages, false);
+    int64_t last_sequenced = -1;
+
+    Clock::time_point now{};
+    uint32_t steps = 0;
+    for (; steps < MAX_STEPS; ++steps) {
+        uint8_t buf[sizeof(uint32_t)];
+        for (uint32_t i = 0; i < SENDS_PER_STEP; ++i) {
+            write_id(buf, sent_ordered);
+            if (sent_ordered < messages) {
+                if (sender.send(Channel::RELIABLE_ORDERED, buf, sizeof(buf))) ++sent_ordered; else ++refused;
+            }
+            write_id(buf, sent_unordered);
+            if (sent_unordered < messages) {
+                if (sender.send(Channel::RELIABLE_UNORDERED, buf, sizeof(buf))) ++sent_unordered; else ++refused;
+            }
+        }
+        bool sending = sent_ordered < messages || sent_unordered < messages;
+        if (sending) {
+            write_id(buf, sent_sequenced++);
+            sender.send(Channel::UNRELIABLE_SEQUENCED, buf, sizeof(buf));
+        }
+
+        now += STEP;
+        link.step(now);
+
+        ChannelMessage msg;
+        uint32_t drains = sending ? DRAINS_PER_STEP : UINT32_MAX;
+        for (uint32_t i = 0; i < drains && receiver.receive(Channel::RELIABLE_ORDERED, msg); ++i) {
+            if (read_id(msg) != ordered.received) ++ordered.out_of_order;
+            ++ordered.received;
+        }
+        for (uint32_t i = 0; i < drains && receiver.receive(Channel::RELIABLE_UNORDERED, msg); ++i) {
+            uint32_t id = read_id(msg);
+            if (id >= messages || seen[id]) {
+                ++unordered.duplicated;
+            } else {
+                seen[id] = true;
+            }
+            ++unordered.received;
+        }
+        while (receiver.receive(Channel::UNRELIABLE_SEQUENCED, msg)) {
+            int64_t id = read_id(msg);
+            if (id <= last_sequenced) ++sequenced.out_of_order;
+            last_sequenced = id;
+            ++sequenced.received;
+        }
+
+        if (!sending && ordered.received >= messages && unordered.received >= messages) break;
+    }
+
+    uint32_t missing = static_cast<uint32_t>(std::count(seen.begin(), seen.end(), false));
+    bool ok = ordered.received == messages && ordered.out_of_order == 0 &&
+            unordered.received == messages && unordered.duplicated == 0 && missing == 0 &&
+            sequenced.out_of_order == 0;
+
+    std::printf("loss %.2f, duplicate %.2f, jitter %.3fs, %u messages per channel, seed %u\n",
+            config.loss, config.duplicate, config.jitter, messages, config.seed);
+    std::printf("%.1fs simulated, %llu packets sent, %llu lost, %llu delivered, rtt %.3fs\n",
+            std::chrono::duration<double>(now.time_since_epoch()).count(),
+            static_cast<unsigned long long>(link.packets_sent()), static_cast<unsigned long long>(link.packets_lost()),
+            static_cast<unsigned long long>(link.packets_delivered()), sender.rtt());
+    std::printf("%llu messages resent, %u sends refused on a full window\n",
+            static_cast<unsigned long long>(sender.messages_resent()), refused);
+    std::printf("ordered    %u/%u received, %u out of order\n", ordered.received, messages, ordered.out_of_order);
+    std::printf("unordered  %u/%u received, %u duplicated, %u missing\n", unordered.received, messages, unordered.duplicated, missing);
+    std::printf("sequenced  %u/%u received, %u out of order\n", sequenced.received, sent_sequenced, sequenced.out_of_order);
+    std::printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
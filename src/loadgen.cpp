@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "entity.hpp"
+#include "physics.hpp"
+#include "net/bitstream.hpp"
+#include "net/channel.hpp"
+#include "net/events.hpp"
+#include "net/input.hpp"
+#include "net/protocol.hpp"
+#include "net/snapshot_receiver.hpp"
+
+#include "RAII/SDL.hpp"
+#include "RAII/SDL_net.hpp"
+
+std::atomic<EntityID> EntityManager::s_entity_counter{0};
+
+/*
+ * Headless stand-in for a player. Unlike ReplicationClient it owns its socket
+ * directly and is driven from the load generator thread, a NetIO thread per
+ * bot would measure the scheduler rather than the server.
+ */
+class Bot {
+    public:
+        Bot(NET_Address* server, uint16_t port, uint32_t index)
+            : m_socket (NET_CreateDatagramSocket(nullptr, 0))
+            , m_server (NET_RefAddress(server))
+            , m_port (port)
+            , m_index (index)
+            , m_channels (std::make_unique<ChannelConnection>())
+        {}
+
+        /* One bot tick, latency samples are appended to latencies in seconds */
+        void update(std::chrono::steady_clock::time_point now, std::vector<double>& latencies) {
+            receive(now, latencies);
+
+            if (m_receiver.latest_tick() == PhysicsCore::INVALID_TICK) {
+                if (now - m_last_hello > HELLO_INTERVAL) {
+                    send_simple(net::MsgType::HELLO);
+                    m_last_hello = now;
+                }
+                return;
+            }
+
+            send_input(now);
+            flush_channel(now);
+        }
+
+        void disconnect() {
+            send_simple(net::MsgType::BYE);
+        }
+
+        bool connected() const {
+            return m_receiver.latest_tick() != PhysicsCore::INVALID_TICK;
+        }
+
+        /* Most recent stats the server broadcast, false if none arrived yet */
+        bool server_stats(ServerStats& out) const {
+            out = m_stats;
+            return m_has_stats;
+        }
+
+        uint64_t take_bytes_received() {
+            uint64_t bytes = m_bytes_received;
+            m_bytes_received = 0;
+            return bytes;
+        }
+
+    private:
+        static constexpr std::chrono::milliseconds HELLO_INTERVAL{500};
+
+        /* Scripted movement, each bot walks its own rectangle so the avatars spread out */
+        InputCmd script(uint32_t seq) const {
+            uint32_t leg = ((seq + m_index * 37) / 90) % 4;
+            static constexpr int8_t dx[] = {1, 0, -1, 0};
+            static constexpr int8_t dy[] = {0, 1, 0, -1};
+            return InputCmd{seq, dx[leg], dy[leg]};
+        }
+
+        void receive(std::chrono::steady_clock::time_point now, std::vector<double>& latencies) {
+            while (true) {
+                NETDatagram d(m_socket.get());
+                NET_Datagram* dgram = d.get();
+                if (dgram == nullptr) break;
+                if (dgram->buflen == 0 || dgram->port != m_port ||
+                        NET_CompareAddresses(dgram->addr, m_server.get()) != 0) continue;
+
+                m_bytes_received += static_cast<uint64_t>(dgram->buflen);
+
+                BitReader r(dgram->buf, static_cast<std::size_t>(dgram->buflen));
+                auto type = static_cast<net::MsgType>(r.read_bits(net::MSG_TYPE_BITS));
+                if (type == net::MsgType::SNAPSHOT) {
+                    if (!m_receiver.receive(r)) continue;
+                    send_ack(m_receiver.latest_tick());
+                    sample_latency(now, latencies);
+                } else if (type == net::MsgType::CHANNEL) {
+                    m_channels->read_packet(r, now);
+                }
+            }
+
+            ChannelMessage msg;
+            while (m_channels->receive(Channel::UNRELIABLE_SEQUENCED, msg)) {
+                if (events::type(msg) == EventType::SERVER_STATS && events::read(msg, m_stats)) m_has_stats = true;
+            }
+        }
+
+        /* Every input the new snapshot acknowledges for the first time took this long to show up */
+        void sample_latency(std::chrono::steady_clock::time_point now, std::vector<double>& latencies) {
+            uint32_t ack = m_receiver.input_ack();
+            if (ack == 0 || static_cast<int32_t>(ack - m_acked_seq) <= 0) return;
+
+            uint32_t first = (ack - m_acked_seq > HISTORY) ? ack - HISTORY + 1 : m_acked_seq + 1;
+            for (uint32_t seq = first; static_cast<int32_t>(ack - seq) >= 0; ++seq) {
+                const SentInput& sent = m_sent[seq % HISTORY];
+                if (sent.seq != seq) continue;
+                latencies.push_back(std::chrono::duration<double>(now - sent.time).count());
+            }
+            m_acked_seq = ack;
+        }
+
+        void send_input(std::chrono::steady_clock::time_point now) {
+            uint32_t seq = ++m_input_seq;
+            m_sent[seq % HISTORY] = SentInput{seq, now};
+
+            /* Same redundancy as the real client, everything not acknowledged yet */
+            std::array<InputCmd, input::MAX_REDUNDANT> cmds;
+            uint32_t first = (seq - m_acked_seq > cmds.size()) ? seq - static_cast<uint32_t>(cmds.size()) + 1 : m_acked_seq + 1;
+            std::size_t count = 0;
+            for (uint32_t s = first; static_cast<int32_t>(seq - s) >= 0; ++s) cmds[count++] = script(s);
+
+            std::array<uint8_t, net::MTU> buf;
+            BitWriter w(buf.data(), buf.size());
+            w.write_bits(static_cast<uint32_t>(net::MsgType::INPUT), net::MSG_TYPE_BITS);
+            input::write(w, cmds.data(), count);
+            send(buf.data(), w.flush());
+        }
+
+        void send_ack(uint32_t tick) {
+            std::array<uint8_t, 8> buf;
+            BitWriter w(buf.data(), buf.size());
+            w.write_bits(static_cast<uint32_t>(net::MsgType::ACK), net::MSG_TYPE_BITS);
+            w.write_bits(tick, 32);
+            send(buf.data(), w.flush());
+        }
+
+        void send_simple(net::MsgType type) {
+            std::array<uint8_t, 8> buf;
+            BitWriter w(buf.data(), buf.size());
+            w.write_bits(static_cast<uint32_t>(type), net::MSG_TYPE_BITS);
+            w.write_bits(net::PROTOCOL_ID, 16);
+            send(buf.data(), w.flush());
+        }
+
+        void flush_channel(std::chrono::steady_clock::time_point now) {
+            if (!m_channels->wants_to_send(now)) return;
+
+            std::array<uint8_t, net::MTU> buf;
+            BitWriter w(buf.data(), buf.size());
+            w.write_bits(static_cast<uint32_t>(net::MsgType::CHANNEL), net::MSG_TYPE_BITS);
+            m_channels->write_packet(w, now);
+            send(buf.data(), w.flush());
+        }
+
+        void send(const uint8_t* data, std::size_t len) {
+            if (!NET_SendDatagram(m_socket.get(), m_server.get(), m_port, data, static_cast<int>(len))) {
+                std::cerr << "[ERROR] Bot::send -> " << SDL_GetError() << std::endl;
+            }
+        }
+
+    private:
+        struct SentInput {
+            uint32_t    seq{0};
+            std::chrono::steady_clock::time_point   time{};
+        };
+
+        static constexpr std::size_t HISTORY = 256;
+
+        NETDatagramSocket   m_socket;
+        NETAddress          m_server;
+        uint16_t            m_port;
+        uint32_t            m_index;
+
+        SnapshotReceiver                    m_receiver;
+        std::unique_ptr<ChannelConnection>  m_channels;
+        ServerStats                         m_stats{};
+        bool                                m_has_stats{false};
+
+        uint32_t    m_input_seq{0};
+        uint32_t    m_acked_seq{0};
+        std::array<SentInput, HISTORY>  m_sent{};
+
+        std::chrono::steady_clock::time_point   m_last_hello{};
+        uint64_t    m_bytes_received{0};
+};
+
+static double percentile(std::vector<double>& samples, double p) {
+    if (samples.empty()) return 0.0;
+    std::size_t k = static_cast<std::size_t>(p * static_cast<double>(samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(k), samples.end());
+    return samples[k];
+}
+
+/* Usage: GameEngine_loadgen [clients [seconds [host [port]]]] */
+int main(int argc, char** argv) {
+    uint32_t num_bots = (argc > 1) ? static_cast<uint32_t>(std::atoi(argv[1])) : 50;
+    int seconds = (argc > 2) ? std::atoi(argv[2]) : 30;
+    const char* host = (argc > 3) ? argv[3] : "127.0.0.1";
+    uint16_t port = (argc > 4) ? static_cast<uint16_t>(std::atoi(argv[4])) : net::DEFAULT_PORT;
+
+    SDL sdl(SDL_INIT_EVENTS);
+    SDLNet sdl_net;
+
+    NETAddress server(NET_ResolveHostname(host));
+    if (NET_WaitUntilResolved(server.get(), -1) != NET_SUCCESS) {
+        std::cerr << "[ERROR] main -> Could not resolve " << host << ": " << SDL_GetError() << std::endl;
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<Bot>> bots;
+    bots.reserve(num_bots);
+    for (uint32_t i = 0; i < num_bots; ++i) {
+        bots.push_back(std::make_unique<Bot>(server.get(), port, i));
+    }
+
+    std::printf("%u bots against %s:%u for %d s\n", num_bots, host, port, seconds);
+    std::printf("%6s %8s %10s %10s %10s %12s %9s %9s %9s\n",
+            "time", "clients", "tick avg", "tick max", "ckpt max", "B/s/client", "lat p50", "lat p95", "lat p99");
+
+    using Clock = std::chrono::steady_clock;
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>{1.0 / 60.0});
+
+    std::vector<double> window;
+    std::vector<double> total;
+    uint64_t total_bytes = 0;
+
+    auto start = Clock::now();
+    auto next = start;
+    auto next_report = start + std::chrono::seconds(1);
+    int elapsed = 0;
+    while (elapsed < seconds) {
+        auto now = Clock::now();
+        for (auto& bot : bots) bot->update(now, window);
+
+        if (now >= next_report) {
+            ++elapsed;
+            next_report += std::chrono::seconds(1);
+
+            uint32_t connected = 0;
+            uint64_t bytes = 0;
+            ServerStats stats{};
+            bool has_stats = false;
+            for (auto& bot : bots) {
+                connected += bot->connected();
+                bytes += bot->take_bytes_received();
+                has_stats |= bot->server_stats(stats);
+            }
+            total_bytes += bytes;
+
+            std::printf("%5ds %8u %8.2fms %8.2fms %8.2fms %12.0f %7.1fms %7.1fms %7.1fms\n", elapsed, connected,
+                    has_stats ? stats.tick_avg_us / 1000.0 : 0.0, has_stats ? stats.tick_max_us / 1000.0 : 0.0,
+                    has_stats ? stats.checkpoint_max_us / 1000.0 : 0.0,
+                    connected ? static_cast<double>(bytes) / connected : 0.0,
+                    percentile(window, 0.50) * 1000.0, percentile(window, 0.95) * 1000.0,
+                    percentile(window, 0.99) * 1000.0);
+            std::fflush(stdout);
+
+            total.insert(total.end(), window.begin(), window.end());
+            window.clear();
+        }
+
+        next += period;
+        std::this_thread::sleep_until(next);
+    }
+
+    for (auto& bot : bots) bot->disconnect();
+
+    double secs = std::chrono::duration<double>(Clock::now() - start).count();
+    std::printf("\ntotal: %.0f B/s/client, input to snapshot latency p50 %.1fms p95 %.1fms p99 %.1fms (%zu samples)\n",
+            num_bots ? static_cast<double>(total_bytes) / secs / num_bots : 0.0,
+            percentile(total, 0.50) * 1000.0, percentile(total, 0.95) * 1000.0,
+            percentile(total, 0.99) * 1000.0, total.size());
+
+    return 0;
+}
@@ -1,20 +1,86 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
 #include "world.hpp"
 
 #include "entity.hpp"
+#include "net/protocol.hpp"
+
+std::atomic<EntityID> EntityManager::s_entity_counter{0};
+
+#ifdef SERVER
+static constexpr double CHECKPOINT_INTERVAL = 5.0;
+
+/* Optional file arguments can be skipped with "-" */
+static const char* file_arg(int argc, char** argv, int i) {
+    return (argc > i && std::strcmp(argv[i], "-") != 0) ? argv[i] : nullptr;
+}
+
+/*
+ * Usage: GameEngine_server [port [save_file [checkpoint_file [recording]]]]
+ * The world is restored from the checkpoint if there is one, from save_file
+ * otherwise, and written back to save_file on a clean exit. The session is
+ * recorded for GameEngine_replay if a recording file is given.
+ */
+int main(int argc, char** argv) {
+    uint16_t port = (argc > 1) ? static_cast<uint16_t>(std::atoi(argv[1])) : net::DEFAULT_PORT;
+    const char* save_file = file_arg(argc, argv, 2);
+    const char* checkpoint_file = file_arg(argc, argv, 3);
+    const char* recording = file_arg(argc, argv, 4);
+
+    World world;
+    world.listen(port);
 
-EntityID EntityManager::s_entity_counter = 0;
+    bool restored = (checkpoint_file != nullptr) && world.restore_checkpoint(checkpoint_file);
+    restored = restored || ((save_file != nullptr) && world.load(save_file));
+    for (int i = 0; !restored && i < 16; ++i) {
+        EntityID eid = world.create_entity();
+        Vector2D<double> pos{20.0 + 25.0 * (i % 8), 40.0 + 80.0 * (i / 8)};
+        world.add_component(eid, Transform{pos});
 
-int main() {
+        size_t transform_idx = world.get_component_idx<Transform>(eid).value();
+        world.add_component(eid, PhysicsBody(world.physics(), eid, transform_idx,
+                    pos, Vector2D<double>{4.0 * (i % 3), 0}, Vector2D<double>{0, 2.0}));
+    }
+
+    if (checkpoint_file != nullptr) world.enable_checkpoints(checkpoint_file, CHECKPOINT_INTERVAL);
+    if (recording != nullptr) world.record(recording);
+
+    world.run();
+    if (save_file != nullptr) world.save(save_file);
+
+    return 0;
+}
+#else
+static constexpr const char* SPRITE_DIR = "assets/sprites";
+
+/* Usage: GameEngine_client [host [port]] */
+int main(int argc, char** argv) {
     World world;
+    world.load_sprites(SPRITE_DIR);
 
     EntityID player = world.create_entity();
     Transform player_transform;
     world.add_component(player, player_transform);
 
-    RectangleDrawable player_renderable(world.get_component_idx<Transform>(player).value());
-    world.add_component(player, player_renderable);
+    size_t transform_idx = world.get_component_idx<Transform>(player).value();
+    if (auto sprite = world.sprite("player")) {
+        world.add_component(player, SpriteDrawable(transform_idx, *sprite));
+    } else {
+        world.add_component(player, RectangleDrawable(transform_idx));
+    }
+
+    if (argc > 1) {
+        uint16_t port = (argc > 2) ? static_cast<uint16_t>(std::atoi(argv[2])) : net::DEFAULT_PORT;
+        if (!world.connect(argv[1], port)) {
+            std::cerr << "[ERROR] main -> Could not connect to " << argv[1] << ":" << port << std::endl;
+            return 1;
+        }
+    }
 
     world.run();
 
     return 0;
 }
+#endif
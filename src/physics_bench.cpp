@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "contact_solver.hpp"
+#include "entity.hpp"
+#include "physics.hpp"
+
+std::atomic<EntityID> EntityManager::s_entity_counter{0};
+
+/*
+ * Usage: GameEngine_physics_bench [crowd|pile [bodies [ticks [workers]]]]
+ * Steps PhysicsCore on the calling thread through a scene where most bodies
+ * end up touching. crowd: bodies spread on a grid all push towards the middle
+ * and pack into one large island. pile: bodies fall into a bin of immovable
+ * circles and stack on its floor. The scene is run once with the given number
+ * of solver workers and once with none, and the two end states are compared
+ * bit for bit.
+ */
+using Clock = std::chrono::steady_clock;
+
+static constexpr double RADIUS = 8.0;
+static constexpr double PUSH = 200.0;       // crowd, towards the middle
+static constexpr double GRAVITY = 600.0;    // pile
+
+struct Result {
+    std::vector<double>     tick_ms;
+    std::size_t             contacts{0};
+    std::size_t             islands{0};
+    uint64_t                checksum{0};
+};
+
+static void add(PhysicsCore& physics, EntityID& eid, Vector2D<double> pos, Vector2D<double> acc, Collider collider) {
+    physics.add_physics_entity(eid, eid, pos, Vector2D<double>{0, 0}, acc, collider);
+    ++eid;
+}
+
+static void build_crowd(PhysicsCore& physics, std::size_t n) {
+    std::size_t side = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(n))));
+    double spacing = 3 * RADIUS;
+    double middle = side * spacing / 2;
+
+    EntityID eid = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        Vector2D<double> pos{(i % side) * spacing, (i / side) * spacing};
+        Vector2D<double> to_middle{middle - pos.x, middle - pos.y};
+        double len = std::sqrt(to_middle.x * to_middle.x + to_middle.y * to_middle.y);
+        Vector2D<double> acc = (len > 0) ? to_middle * (PUSH / len) : Vector2D<double>{0, 0};
+        add(physics, eid, pos, acc, Collider{RADIUS, 1.0, 0.1});
+    }
+}
+
+static void build_pile(PhysicsCore& physics, std::size_t n) {
+    /* A bin about twice as wide as tall once everything has settled */
+    std::size_t columns = static_cast<std::size_t>(std::ceil(std::sqrt(2.0 * n)));
+    double width = columns * 2 * RADIUS;
+    double height = (n / columns + 1) * 2 * RADIUS;
+    double floor = 4 * height;
+
+    EntityID eid = 0;
+    Collider wall{RADIUS, 0.0, 0.0};
+    for (double x = -RADIUS; x <= width + RADIUS; x += RADIUS) add(physics, eid, Vector2D<double>{x, floor + RADIUS}, {0, 0}, wall);
+    for (double y = 0; y <= floor; y += RADIUS) {
+        add(physics, eid, Vector2D<double>{-RADIUS, y}, {0, 0}, wall);
+        add(physics, eid, Vector2D<double>{width + RADIUS, y}, {0, 0}, wall);
+    }
+
+    /* Dropped in loose rows, every other one shifted so they do not stack in columns */
+    double spacing = 2.5 * RADIUS;
+    std::size_t per_row = static_cast<std::size_t>(width / spacing);
+    for (std::size_t i = 0; i < n; ++i) {
+        double shift = ((i / per_row) % 2 == 0) ? 0 : RADIUS;
+        Vector2D<double> pos{RADIUS + shift + (i % per_row) * spacing, floor - RADIUS - (i / per_row) * spacing};
+        add(physics, eid, pos, Vector2D<double>{0, GRAVITY}, Collider{RADIUS, 1.0, 0.2});
+    }
+}
+
+static Result run(const std::string& scene, std::size_t n, uint32_t ticks, std::size_t workers) {
+    PhysicsCore physics;
+    physics.set_solver_workers(workers);
+    if (scene == "pile") {
+        build_pile(physics, n);
+    } else {
+        build_crowd(physics, n);
+    }
+
+    Result r;
+    r.tick_ms.reserve(ticks);
+    for (uint32_t t = 0; t < ticks; ++t) {
+        auto start = Clock::now();
+        physics.step();
+        r.tick_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    r.contacts = physics.solver().num_contacts();
+    r.islands = physics.solver().num_islands();
+
+    /* FNV-1a over the raw state, any difference in the last bit shows */
+    r.checksum = 0xcbf29ce484222325ull;
+    for (const auto& d : physics.bodies().data) {
+        double values[4] = {d.pos.x, d.pos.y, d.speed.x, d.speed.y};
+        unsigned char bytes[sizeof(values)];
+        std::memcpy(bytes, values, sizeof(values));
+        for (unsigned char b : bytes) {
+            r.checksum ^= b;
+            r.checksum *= 0x100000001b3ull;
+        }
+    }
+    return r;
+}
+
+int main(int argc, char** argv) {
+    std::string scene = (argc > 1) ? argv[1] : "crowd";
+    std::size_t n = (argc > 2) ? static_cast<std::size_t>(std::atoll(argv[2])) : 4000;
+    uint32_t ticks = (argc > 3) ? static_cast<uint32_t>(std::max(1, std::atoi(argv[3]))) : 600;
+    std::size_t workers = (argc > 4) ? static_cast<std::size_t>(std::atoi(argv[4])) : std::max(1u, std::thread::hardware_concurrency()) - 1;
+    if (scene != "crowd" && scene != "pile") {
+        std::fprintf(stderr, "Unknown scene %s, expected crowd or pile\n", scene.c_str());
+        return 1;
+    }
+
+    Result parallel = run(scene, n, ticks, workers);
+    Result serial = run(scene, n, ticks, 0);
+
+    auto report = [ticks](const char* name, Result& r) {
+        double total = 0;
+        for (double ms : r.tick_ms) total += ms;
+        std::sort(r.tick_ms.begin(), r.tick_ms.end());
+        std::printf("%-9s tick mean %8.3fms  p50 %8.3fms  p99 %8.3fms  max %8.3fms\n", name,
+                total / ticks, r.tick_ms[ticks / 2], r.tick_ms[ticks * 99 / 100], r.tick_ms.back());
+    };
+
+    std::printf("%s, %zu bodies, %u ticks, %zu solver workers\n", scene.c_str(), n, ticks, workers);
+    report("parallel", parallel);
+    report("serial", serial);
+    std::printf("last tick %zu contacts in %zu islands\n", parallel.contacts, parallel.islands);
+    std::printf("checksum %016llx %s\n", static_cast<unsigned long long>(parallel.checksum),
+            (parallel.checksum == serial.checksum) ? "matches the serial run" : "DIFFERS from the serial run");
+    return (parallel.checksum == serial.checksum) ? 0 : 1;
+}
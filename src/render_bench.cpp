@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "SDL3/SDL_surface.h"
+
+#include "RAII/SDL.hpp"
+#include "renderer.hpp"
+
+/*
+ * Usage: GameEngine_render_bench [commands [frames [dump_every [dump_prefix [particles]]]]]
+ * Drives the whole render path on the calling thread with an offscreen software
+ * renderer, no window or GPU: each frame moves every command, publishes the
+ * frame through the TripleBuffer and draws it. Half of the commands are plain
+ * rectangles, the other half sprites spread over two atlases. Every nth frame
+ * is written out as a BMP if dump_every is given. With particles, that many
+ * are kept alive on top by emitters of PARTICLES_PER_EMITTER each, stepped and
+ * drawn by the renderer itself.
+ */
+using Clock = std::chrono::steady_clock;
+
+static constexpr int WIDTH = 1280;
+static constexpr int HEIGHT = 720;
+static constexpr int SPRITES = 64;
+static constexpr int SPRITE_SIZE = 256;     // 49 fit in an atlas, so 64 take two
+static constexpr uint32_t PARTICLES_PER_EMITTER = 1000;
+static constexpr float PARTICLE_LIFE = 1.0f;
+
+static double ms_between(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = (argc > 1) ? static_cast<std::size_t>(std::atoll(argv[1])) : 20000;
+    int frames = (argc > 2) ? std::max(1, std::atoi(argv[2])) : 300;
+    uint32_t dump_every = (argc > 3) ? static_cast<uint32_t>(std::atoi(argv[3])) : 0;
+    std::string dump_prefix = (argc > 4) ? argv[4] : "frame_";
+    std::size_t particles = (argc > 5) ? static_cast<std::size_t>(std::atoll(argv[5])) : 0;
+
+    Renderer renderer(Offscreen{WIDTH, HEIGHT});
+    if (dump_every != 0) renderer.dump_frames(dump_prefix, dump_every);
+
+    for (int i = 0; i < SPRITES; ++i) {
+        SDLSurface image(SDL_CreateSurface(SPRITE_SIZE, SPRITE_SIZE, SDL_PIXELFORMAT_RGBA32));
+        if (image.get() == nullptr) {
+            std::fprintf(stderr, "SDL_CreateSurface: %s\n", SDL_GetError());
+            return 1;
+        }
+        SDL_FillSurfaceRect(image.get(), nullptr, 0xFF000000u | (static_cast<uint32_t>(i) * 0x030507u));
+        renderer.atlases().add_surface("sprite" + std::to_string(i), std::move(image));
+    }
+    renderer.atlases().pack();
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> x(0, WIDTH), y(0, HEIGHT), speed(-2, 2);
+    std::vector<RenderCommand> cmds(n);
+    std::vector<Vector2D<double>> speeds(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        Vector2D<double> pos{x(rng), y(rng)};
+        speeds[i] = Vector2D<double>{speed(rng), speed(rng)};
+        if (i % 2 == 0) {
+            cmds[i] = RenderCommand{pos, Vector2D<double>{10, 20}, Vector3D<double>{0, 255, 0}};
+        } else {
+            Sprite sprite = renderer.sprite("sprite" + std::to_string(i % SPRITES)).value();
+            cmds[i] = RenderCommand{pos, Vector2D<double>{16, 16}, Vector3D<double>{255, 255, 255}, sprite.atlas, sprite.uv};
+        }
+    }
+
+    /* Spawned as fast as they die, so the count stays at capacity once the first ones expire */
+    std::vector<EmitterState> emitters;
+    for (std::size_t i = 0; i * PARTICLES_PER_EMITTER < particles; ++i) {
+        ParticleParams params;
+        params.capacity = PARTICLES_PER_EMITTER;
+        params.rate = PARTICLES_PER_EMITTER / PARTICLE_LIFE;
+        params.life_min = PARTICLE_LIFE * 0.9f;
+        params.life_max = PARTICLE_LIFE;
+        params.gravity_y = 200;
+        params.color_start = SDL_FColor{1, 0.8f, 0.2f, 1};
+        params.color_end = SDL_FColor{1, 0.1f, 0, 0};
+        emitters.push_back(EmitterState{static_cast<EntityID>(i), Vector2D<double>{x(rng), y(rng)}, params});
+    }
+    renderer.publish_emitters(emitters);
+
+    std::vector<double> frame_ms;
+    frame_ms.reserve(frames);
+    double publish_total = 0, draw_total = 0;
+    for (int f = 0; f < frames; ++f) {
+        for (std::size_t i = 0; i < n; ++i) {
+            cmds[i].pos += speeds[i];
+            if (cmds[i].pos.x < 0 || cmds[i].pos.x > WIDTH) speeds[i].x = -speeds[i].x;
+            if (cmds[i].pos.y < 0 || cmds[i].pos.y > HEIGHT) speeds[i].y = -speeds[i].y;
+        }
+
+        auto start = Clock::now();
+        renderer.publish_frame(cmds);
+        auto published = Clock::now();
+        if (!renderer.draw()) {
+            std::fprintf(stderr, "Frame %d was not drawn\n", f);
+            return 1;
+        }
+        auto drawn = Clock::now();
+
+        publish_total += ms_between(start, published);
+        draw_total += ms_between(published, drawn);
+        frame_ms.push_back(ms_between(start, drawn));
+    }
+
+    double total = publish_total + draw_total;
+    std::sort(frame_ms.begin(), frame_ms.end());
+    std::printf("%zu commands, %zu particles, %d frames at %dx%d, software renderer\n", n, particles, frames, WIDTH, HEIGHT);
+    std::printf("frame     mean %8.3fms  p50 %8.3fms  p99 %8.3fms  max %8.3fms\n",
+            total / frames, frame_ms[frames / 2], frame_ms[frames * 99 / 100], frame_ms.back());
+    std::printf("publish   mean %8.3fms\n", publish_total / frames);
+    std::printf("draw      mean %8.3fms\n", draw_total / frames);
+    std::printf("throughput %.0f commands/s, %.1f frames/s\n", n * frames / (total / 1000.0), frames / (total / 1000.0));
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include <chrono>
+#include <cstdio>
+#include <optional>
+
+#include "world.hpp"
+
+#include "entity.hpp"
+
+std::atomic<EntityID> EntityManager::s_entity_counter{0};
+
+/*
+ * Usage: GameEngine_replay recording [save_file]
+ * Re-simulates a session recorded by GameEngine_server without any pacing and
+ * reports how fast it went. The final world is written to save_file if given,
+ * it matches the save the recorded server wrote on exit.
+ */
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s recording [save_file]\n", argv[0]);
+        return 1;
+    }
+
+    World world;
+
+    auto start = std::chrono::steady_clock::now();
+    std::optional<uint32_t> ticks = world.replay(argv[1]);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!ticks.has_value()) {
+        std::fprintf(stderr, "Replay of %s failed\n", argv[1]);
+        return 1;
+    }
+
+    double simulated = ticks.value() / 60.0;
+    std::printf("%u ticks (%.1f s of play) in %.3f s, %.0f ticks/s, %.1fx real time\n",
+            ticks.value(), simulated, secs, secs > 0 ? ticks.value() / secs : 0.0, secs > 0 ? simulated / secs : 0.0);
+
+    if (argc > 2 && !world.save(argv[2])) return 1;
+    return 0;
+}
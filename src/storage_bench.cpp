@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "containers/archetype.hpp"
+#include "containers/component_pool.hpp"
+#include "containers/registry.hpp"
+#include "containers/typemap.hpp"
+
+#include "components/drawable_rect.hpp"
+#include "components/physics_body.hpp"
+#include "components/transform.hpp"
+
+#include "entity.hpp"
+#include "physics.hpp"
+
+std::atomic<EntityID> EntityManager::s_entity_counter{0};
+
+/*
+ * Usage: GameEngine_storage_bench [entities [passes]]
+ * Runs the same workload against the per-type pools the World uses and against
+ * ArchetypeStorage: spawn, the Transform joins of rendering and of physics
+ * snapshots, then a despawn of a random half. Two thirds of the entities have
+ * a PhysicsBody and half a RectangleDrawable, like a mixed scene. Physics is
+ * never run, bodies only queue their messages.
+ */
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct Results {
+    double  spawn{0};
+    double  render_join{0};
+    double  physics_join{0};
+    double  despawn{0};
+    double  checksum{0};
+};
+
+static Results run_pools(PhysicsCore& physics, std::size_t n, int passes, std::span<const EntityID> despawn) {
+    PhysicsRegistry physics_reg;
+    RenderRegistry render_reg;
+    TypeMap<
+        ComponentPool<Transform, void>,
+        ComponentPool<PhysicsBody, PhysicsRegistry>,
+        ComponentPool<RectangleDrawable, RenderRegistry>
+    > pools{
+        ComponentPool<Transform, void>{},
+        ComponentPool<PhysicsBody, PhysicsRegistry>{&physics_reg},
+        ComponentPool<RectangleDrawable, RenderRegistry>{&render_reg}
+    };
+    pools.for_each([&pools](auto& pool) { pool.init(pools); });
+
+    auto& transforms = pools.get<Transform>();
+    auto& bodies = pools.get<PhysicsBody>();
+    auto& drawables = pools.get<RectangleDrawable>();
+    Results r;
+
+    auto start = Clock::now();
+    for (EntityID eid = 0; eid < n; ++eid) {
+        Vector2D<double> pos{static_cast<double>(eid), 0};
+        std::size_t t = transforms.add(eid, Transform{pos});
+        if (eid % 3 != 0) bodies.add(eid, PhysicsBody(physics, eid, t, pos, {1, 0}));
+        if (eid % 2 != 0) drawables.add(eid, RectangleDrawable(t));
+    }
+    r.spawn = ms_since(start);
+
+    start = Clock::now();
+    for (int p = 0; p < passes; ++p) {
+        const auto& entries = drawables.entries();
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            r.checksum += transforms.entries()[entries[i].data.transform_idx].data.value.x;
+        }
+    }
+    r.render_join = ms_since(start) / passes;
+
+    start = Clock::now();
+    for (int p = 0; p < passes; ++p) {
+        const auto& entries = bodies.entries();
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            transforms.entry_at(entries[i].data.transform_idx).data.value += entries[i].data.speed;
+        }
+    }
+    r.physics_join = ms_since(start) / passes;
+
+    start = Clock::now();
+    remove_cascade<Transform>(pools, despawn);
+    r.despawn = ms_since(start);
+    return r;
+}
+
+static Results run_archetypes(PhysicsCore& physics, std::size_t n, int passes, std::span<const EntityID> despawn) {
+    ArchetypeStorage<Transform, PhysicsBody, RectangleDrawable> storage;
+    Results r;
+
+    auto start = Clock::now();
+    for (EntityID eid = 0; eid < n; ++eid) {
+        Vector2D<double> pos{static_cast<double>(eid), 0};
+        storage.add_component(eid, Transform{pos});
+        if (eid % 3 != 0) {
+            /* The pools attach a body as it enters them, do the same here so both queue the same messages */
+            PhysicsBody body(physics, eid, 0, pos, {1, 0});
+            body.attach();
+            storage.add_component(eid, std::move(body));
+        }
+        if (eid % 2 != 0) storage.add_component(eid, RectangleDrawable(0));
+    }
+    r.spawn = ms_since(start);
+
+    start = Clock::now();
+    for (int p = 0; p < passes; ++p) {
+        storage.query<Transform, RectangleDrawable>([&r](EntityID, Transform& t, RectangleDrawable&) {
+            r.checksum += t.value.x;
+        });
+    }
+    r.render_join = ms_since(start) / passes;
+
+    start = Clock::now();
+    for (int p = 0; p < passes; ++p) {
+        storage.query<Transform, PhysicsBody>([](EntityID, Transform& t, PhysicsBody& body) {
+            t.value += body.speed;
+        });
+    }
+    r.physics_join = ms_since(start) / passes;
+
+    start = Clock::now();
+    for (EntityID eid : despawn) storage.destroy(eid);
+    r.despawn = ms_since(start);
+    return r;
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = (argc > 1) ? static_cast<std::size_t>(std::atoll(argv[1])) : 200000;
+    int passes = (argc > 2) ? std::max(1, std::atoi(argv[2])) : 20;
+
+    std::vector<EntityID> despawn(n);
+    std::iota(despawn.begin(), despawn.end(), EntityID{0});
+    std::shuffle(despawn.begin(), despawn.end(), std::mt19937(42));
+    despawn.resize(n / 2);
+
+    Results pools, archetypes;
+    {
+        PhysicsCore physics;
+        pools = run_pools(physics, n, passes, despawn);
+    }
+    {
+        PhysicsCore physics;
+        archetypes = run_archetypes(physics, n, passes, despawn);
+    }
+
+    std::printf("%zu entities, %d passes per join\n", n, passes);
+    std::printf("%-12s %10s %12s %13s %10s\n", "storage", "spawn", "render join", "physics join", "despawn");
+    std::printf("%-12s %8.2fms %10.3fms %11.3fms %8.2fms\n", "pools",
+            pools.spawn, pools.render_join, pools.physics_join, pools.despawn);
+    std::printf("%-12s %8.2fms %10.3fms %11.3fms %8.2fms\n", "archetypes",
+            archetypes.spawn, archetypes.render_join, archetypes.physics_join, archetypes.despawn);
+
+    if (pools.checksum != archetypes.checksum) {
+        std::fprintf(stderr, "Checksums differ: %f vs %f\n", pools.checksum, archetypes.checksum);
+        return 1;
+    }
+    return 0;
+}